@@ -33,17 +33,45 @@ DEFINES += SCREWS_EXPORTS
 # Enable ML deprecated API warnings. To completely disable the deprecated API, change WARN to DISABLE.
 DEFINES += ML_DISABLE_DEPRECATED
 
+# AVX2/AVX-512 variants of the batch kernels, chosen at run time (GCC/Clang on x86).
+DEFINES += SCREWS_RUNTIME_DISPATCH
+
+# Per-thread call and time counters of the hot primitives, see instrumentation.hpp.
+# DEFINES += SCREWS_INSTRUMENTATION
+
+# Timeline spans of the chain kinematics and batch jobs, see trace.hpp.
+# DEFINES += SCREWS_TRACE
+
 HEADERS += \
   src/screws.hpp \
+  src/numericTraits.hpp \
+  src/fastMath.hpp \
   src/translation.hpp \
   src/rotation.hpp \
+  src/rotationBatch.hpp \
+  src/batchKernels.hpp \
   src/homogeneousTransform.hpp \
+  src/instrumentation.hpp \
+  src/mixedPrecision.hpp \
   src/skew.hpp \
   src/twist.hpp \
+  src/twistExpCache.hpp \
+  src/transformExpression.hpp \
+  src/transformBatch.hpp \
+  src/trace.hpp \
+  src/chain.hpp \
+  src/concentricTubeRobot.hpp \
+  src/constantCurvatureSegment.hpp \
+  src/cosseratRod.hpp \
+  src/wrench.hpp \
   src/adjoint.hpp \
+  src/spatialInertia.hpp \
+  src/dynamics.hpp \
+  src/lieIntegrator.hpp \
   src/screwException.hpp \
   src/screwsInitLibrary.hpp \
   src/vector6.hpp
 
 SOURCES += \
-  src/screwException.cpp
+  src/screwException.cpp \
+  src/batchKernels.cpp
@@ -1,4 +1,4 @@
-//  Copyright (c) 2013  Christos Bergeles and Imperial College London
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
 
 //  This program is free software: you can redistribute it and/or modify
 //  it under the terms of the GNU General Public License as published by
@@ -13,84 +13,261 @@
 //  You should have received a copy of the GNU General Public License
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
-#ifndef ADJOINT_H
-#define ADJOINT_H
-
-#include "screwsInitLibrary.h"
-
-#include "armadillo"
-
-class Translation;
-class Rotation;
-class HomogeneousTransform;
-class Skew;
-class Twist;
-
-/*!
- * \class Adjoint
- * \ingroup libScrews
- * \brief Implements a 6x6 adjoint matrix with basic functionality.
- * \note Author: Christos Bergeles
- * \date 2013-07-02
- */
-class SCREWS_EXPORT Adjoint
+
+#ifndef ADJOINT_HPP
+#define ADJOINT_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "numericTraits.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+
+namespace screws
 {
-public:
+  template<class NumType>
+  class Wrench;
+  template<class NumType>
+  class SpatialInertia;
 
   /*!
-   * \brief Create a zero 6x6 matrix for the Adjoint.
-   */
-  explicit Adjoint();
-  /*!
-   * \brief Create an adjoint matrix from a Rotation and a Translation.
-   * @param R the rotational component.
-   * @param T the translational component.
-   */
-  explicit Adjoint(const Rotation& R, const Translation& T);
-  /*!
-   * \brief Create an adjoint for the given homogeneous transformation matrix.
-   * @param H the homogeneous transformation matrix.
+   * \class Adjoint
+   * \ingroup libScrews
+   * \brief The 6x6 adjoint Ad_g of a homogeneous transform g = (R, p), which changes the frame of twists.
+   *
+   * With twist coordinates (v; w), Ad_g = [R, p^R; 0, R], so Ad_g (v; w) = (R v + p x R w; R w),
+   * and wrenches change frame with the transpose, Ad_g^T (f; m) = (R^T f; R^T (m - p x f)).
+   * Only R and p are stored and the products are formed without the 6x6 matrix. The Coordinates
+   * overloads work on plain Eigen vectors, for the inner loops of the dynamics.
    */
-  explicit Adjoint(const HomogeneousTransform& H);
+  template<class NumType>
+  class SCREWS_EXPORT Adjoint
+  {
+  public:
+    template<class NumTypeInertia> friend class SpatialInertia;
 
-  /// Default destructor.
-  ~Adjoint();
+    /// @brief 6x1 twist or wrench coordinates, linear part first.
+    typedef Eigen::Matrix<NumType, 6, 1> Coordinates;
+    /// @brief The 6x6 matrix form.
+    typedef Eigen::Matrix<NumType, 6, 6> Matrix;
 
-  /*!
-   * \brief Accessor function for ease of use.
-   * @param i the i-th row of the matrix.
-   * @param j the j-th row of the matrix.
-   * \note No boundary check is performed.
-   */
-  double at(const int& i, const int& j);
+    /// @brief The adjoint of the identity transform.
+    Adjoint()
+      : _R(Eigen::Matrix<NumType, 3, 3>::Identity()), _p(Eigen::Matrix<NumType, 3, 1>::Zero())
+    {
 
-  /*!
-   * \brief Calculates the inverse of the adjoint in a computationally efficient way.
-   */
-  Adjoint inv() const;
+    }
 
-  /*!
-   * \brief Handle multiplication with a twist coordinates vector (6x1).
-   * @param ksi the 6x1 coordinates vector.
-   * \note No dimension check for ksi is performed.
-   */
-  arma::colvec::fixed<6> operator *(const arma::vec::fixed<6>& ksi);
-  /*!
-   * \brief Handle multiplication with a jacobian.
-   * @param jacobian the 6xN jacobian matrix.
-   * \note No dimension check for jacobian is performed.
-   */
-  arma::mat operator *(const arma::mat& jacobian);
+    /// @brief The adjoint of a homogeneous transform.
+    explicit Adjoint(const HomogeneousTransform<NumType>& H)
+      : _R(H.rotation().matrix()), _p(H.translation().vector())
+    {
+
+    }
+
+    /// @brief The adjoint of the transform (R, T).
+    explicit Adjoint(const Rotation<NumType>& R, const Translation<NumType>& T)
+      : _R(R.matrix()), _p(T.vector())
+    {
+
+    }
+
+    /// Default destructor.
+    ~Adjoint() = default;
+
+    /// @brief Copy and move constructors and assignment.
+    Adjoint(const Adjoint<NumType>&) = default;
+    Adjoint(Adjoint<NumType>&&) = default;
+    Adjoint<NumType>& operator=(const Adjoint<NumType>&) = default;
+    Adjoint<NumType>& operator=(Adjoint<NumType>&&) = default;
+
+    /// @return the transform g.
+    HomogeneousTransform<NumType> transform() const
+    {
+      HomogeneousTransform<NumType> H;
+      H.setUnchecked(_R, _p);
+
+      return H;
+    }
+
+    /// @return the 6x6 matrix [R, p^R; 0, R].
+    Matrix matrix() const
+    {
+      Matrix A;
+      A.template topLeftCorner<3, 3>() = _R;
+      A.template topRightCorner<3, 3>() = hat(_p)*_R;
+      A.template bottomLeftCorner<3, 3>().setZero();
+      A.template bottomRightCorner<3, 3>() = _R;
+
+      return A;
+    }
+
+    /// @brief Inverse, Ad_g^-1 = Ad_(g^-1), without inverting the 6x6 matrix.
+    Adjoint<NumType> inv() const
+    {
+      Adjoint<NumType> A;
+      A._R = _R.transpose();
+      A._p = -(A._R*_p);
+
+      return A;
+    }
+
+    /// @brief Composition, Ad_g Ad_h = Ad_gh.
+    Adjoint<NumType> operator*(const Adjoint<NumType>& A) const
+    {
+      Adjoint<NumType> product;
+      product._R.noalias() = _R*A._R;
+      product._p.noalias() = _R*A._p;
+      product._p += _p;
+
+      return product;
+    }
+
+    /// @brief Change the frame of twist coordinates.
+    TwistCoordinates<NumType> operator*(const TwistCoordinates<NumType>& xi) const
+    {
+      const Eigen::Matrix<NumType, 3, 1> v(xi(0), xi(1), xi(2)), w(xi(3), xi(4), xi(5));
+      Eigen::Matrix<NumType, 3, 1> vOut, wOut;
+      apply(v, w, vOut, wOut);
+
+      return TwistCoordinates<NumType>(vOut(0), vOut(1), vOut(2), wOut(0), wOut(1), wOut(2));
+    }
+
+    /// @brief Change the frame of a twist.
+    Twist<NumType> operator*(const Twist<NumType>& xi) const
+    {
+      return Twist<NumType>((*this)*xi.coordinates());
+    }
+
+    /// @brief Change the frame of each column of a 6xn matrix, e.g. a Jacobian.
+    template<int Cols>
+    Eigen::Matrix<NumType, 6, Cols> operator*(const Eigen::Matrix<NumType, 6, Cols>& J) const
+    {
+      Eigen::Matrix<NumType, 6, Cols> out(6, J.cols());
+      for (int i = 0; i < J.cols(); ++i)
+      {
+        Coordinates c;
+        apply(J.col(i), c);
+        out.col(i) = c;
+      }
+
+      return out;
+    }
+
+    /// @brief Ad_g^T F: with g the pose of frame a in frame b, the wrench F given in frame b, in frame a.
+    Wrench<NumType> transposeTimes(const Wrench<NumType>& F) const
+    {
+      Eigen::Matrix<NumType, 3, 1> f, m;
+      applyTranspose(F.force().vector(), F.moment().vector(), f, m);
+
+      return Wrench<NumType>(f(0), f(1), f(2), m(0), m(1), m(2));
+    }
+
+    /// @brief Ad_g^T of n wrenches, e.g. sensor readings moved to another frame.
+    /// @param F the wrenches.
+    /// @param n the number of wrenches.
+    /// @param out the results; may be F.
+    void transposeTimes(const Wrench<NumType>* F, const size_t& n, Wrench<NumType>* out) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Adjoint::transposeTimes", n);
+      // Ad_g^T = [R^T, 0; B, R^T] with B = -R^T p^ formed once.
+      const Eigen::Matrix<NumType, 3, 3> Rt = _R.transpose();
+      const Eigen::Matrix<NumType, 3, 3> B = -Rt*hat(_p);
+      for (size_t i = 0; i < n; ++i)
+      {
+        // Loaded into scalars first, as out may be F.
+        const NumType f0 = F[i](0), f1 = F[i](1), f2 = F[i](2);
+        const NumType m0 = F[i](3), m1 = F[i](4), m2 = F[i](5);
+        for (int r = 0; r < 3; ++r)
+        {
+          out[i](r) = Rt(r, 0)*f0 + Rt(r, 1)*f1 + Rt(r, 2)*f2;
+          out[i](r + 3) = Rt(r, 0)*m0 + Rt(r, 1)*m1 + Rt(r, 2)*m2 + B(r, 0)*f0 + B(r, 1)*f1 + B(r, 2)*f2;
+        }
+      }
+    }
+
+    /// @brief out = Ad_g xi.
+    void apply(const Coordinates& xi, Coordinates& out) const
+    {
+      Eigen::Matrix<NumType, 3, 1> v, w;
+      apply(xi.template head<3>(), xi.template tail<3>(), v, w);
+      out.template head<3>() = v;
+      out.template tail<3>() = w;
+    }
+
+    /// @brief out = Ad_g^T F.
+    void applyTranspose(const Coordinates& F, Coordinates& out) const
+    {
+      Eigen::Matrix<NumType, 3, 1> f, m;
+      applyTranspose(F.template head<3>(), F.template tail<3>(), f, m);
+      out.template head<3>() = f;
+      out.template tail<3>() = m;
+    }
+
+    /// @brief Lie bracket, out = ad_V xi = (w x v' + v x w'; w x w') for V = (v; w) and xi = (v'; w').
+    static void ad(const Coordinates& V, const Coordinates& xi, Coordinates& out)
+    {
+      const Eigen::Matrix<NumType, 3, 1> v = V.template head<3>(), w = V.template tail<3>();
+      const Eigen::Matrix<NumType, 3, 1> v1 = xi.template head<3>(), w1 = xi.template tail<3>();
+      out.template head<3>() = w.cross(v1) + v.cross(w1);
+      out.template tail<3>() = w.cross(w1);
+    }
+
+    /// @brief Dual of the bracket, out = ad_V^T F = (-w x f; -v x f - w x m) for V = (v; w) and F = (f; m).
+    static void adTranspose(const Coordinates& V, const Coordinates& F, Coordinates& out)
+    {
+      const Eigen::Matrix<NumType, 3, 1> v = V.template head<3>(), w = V.template tail<3>();
+      const Eigen::Matrix<NumType, 3, 1> f = F.template head<3>(), m = F.template tail<3>();
+      out.template head<3>() = f.cross(w);
+      out.template tail<3>() = f.cross(v) + m.cross(w);
+    }
+
+    /// @brief Approximate equality of the rotation and translation parts.
+    bool approxEq(const Adjoint<NumType>& A,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
+    {
+      return ((_R - A._R).cwiseAbs().maxCoeff() < eps && (_p - A._p).cwiseAbs().maxCoeff() < eps);
+    }
+
+  protected:
+
+    template<class In, class Out>
+    void apply(const In& v, const In& w, Out& vOut, Out& wOut) const
+    {
+      wOut.noalias() = _R*w;
+      vOut.noalias() = _R*v;
+      vOut += _p.cross(wOut);
+    }
+
+    template<class In, class Out>
+    void applyTranspose(const In& f, const In& m, Out& fOut, Out& mOut) const
+    {
+      const Eigen::Matrix<NumType, 3, 1> moment = m - _p.cross(f);
+      fOut.noalias() = _R.transpose()*f;
+      mOut.noalias() = _R.transpose()*moment;
+    }
+
+    static Eigen::Matrix<NumType, 3, 3> hat(const Eigen::Matrix<NumType, 3, 1>& p)
+    {
+      Eigen::Matrix<NumType, 3, 3> S;
+      S << 0, -p(2), p(1),
+           p(2), 0, -p(0),
+           -p(1), p(0), 0;
 
-  bool operator ==(const Adjoint& A);
+      return S;
+    }
 
-  void print() const;
+    Eigen::Matrix<NumType, 3, 3> _R;
+    Eigen::Matrix<NumType, 3, 1> _p;
+  };
 
-private:
-  void construct(const Rotation& R, const Translation& T);
-  arma::mat::fixed<6, 6> _data;
-  Translation _T;
-  Rotation _R;
+  // Convenience names
+  using Adjointd = Adjoint < double >;
+  using Adjointf = Adjoint < float >;
 };
 
-#endif // ADJOINT_H
+#endif // ADJOINT_HPP
@@ -0,0 +1,388 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Allocation and exception audit.
+// The hot paths (exponentials, logarithms, products, inverses, chain kinematics, the batch kernels
+// into presized outputs) must not touch the heap and must not throw for valid inputs, so that they
+// can run in a real-time loop. This executable counts every malloc/calloc/realloc/free (operator
+// new/delete where the C library cannot be interposed) and every __cxa_throw while an audited
+// block runs, and exits with a nonzero status if any block allocated or threw. It is registered
+// with CTest; run it directly to see the per-operation counts.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <typeinfo>
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "rotationBatch.hpp"
+#include "batchKernels.hpp"
+#include "transformExpression.hpp"
+#include "transformBatch.hpp"
+#include "twistExpCache.hpp"
+#include "chain.hpp"
+#include "wrench.hpp"
+#include "dynamics.hpp"
+#include "lieIntegrator.hpp"
+#include "cosseratRod.hpp"
+#include "constantCurvatureSegment.hpp"
+#include "concentricTubeRobot.hpp"
+
+using namespace screws;
+
+namespace
+{
+  // Counters, only updated while armed so that the harness itself (iostream, vectors) is free to allocate.
+  bool armed = false;
+  size_t allocations = 0;
+  size_t frees = 0;
+  size_t throws = 0;
+
+  typedef void (*ThrowFunction)(void*, std::type_info*, void (*)(void*));
+  ThrowFunction nextThrow = 0;
+
+  void countAllocation()
+  {
+    if (armed)
+    {
+      ++allocations;
+    }
+  }
+
+  void countFree(void* p)
+  {
+    if (armed && p != 0)
+    {
+      ++frees;
+    }
+  }
+}
+
+// The C library allocator is interposed where glibc exposes its internal entry points; elsewhere
+// only operator new/delete are counted, which misses Eigen's aligned_malloc.
+#if defined(__GLIBC__)
+extern "C"
+{
+  void* __libc_malloc(size_t);
+  void* __libc_calloc(size_t, size_t);
+  void* __libc_realloc(void*, size_t);
+  void* __libc_memalign(size_t, size_t);
+  void __libc_free(void*);
+
+  void* malloc(size_t size)
+  {
+    countAllocation();
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t n, size_t size)
+  {
+    countAllocation();
+    return __libc_calloc(n, size);
+  }
+
+  void* realloc(void* p, size_t size)
+  {
+    countAllocation();
+    return __libc_realloc(p, size);
+  }
+
+  void* memalign(size_t alignment, size_t size)
+  {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size)
+  {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+  }
+
+  int posix_memalign(void** p, size_t alignment, size_t size)
+  {
+    countAllocation();
+    *p = __libc_memalign(alignment, size);
+    return (*p == 0) ? 12 /* ENOMEM */ : 0;
+  }
+
+  void free(void* p)
+  {
+    countFree(p);
+    __libc_free(p);
+  }
+}
+#else
+void* operator new(size_t size)
+{
+  countAllocation();
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == 0)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  countFree(p);
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  operator delete(p);
+}
+#endif
+
+// Every throw expression goes through __cxa_throw; count it and forward to the runtime.
+namespace __cxxabiv1
+{
+  extern "C" void __cxa_throw(void* exception, std::type_info* type, void (*destructor)(void*))
+  {
+    if (armed)
+    {
+      ++throws;
+    }
+    nextThrow(exception, type, destructor);
+    std::abort();
+  }
+}
+
+namespace
+{
+  int failures = 0;
+
+  // Run f() a few times with the counters armed and report. expectClean is false for the
+  // self-tests, which must be detected.
+  template<class Function>
+  void audit(const char* name, Function f, const bool& expectClean = true)
+  {
+    // Warm up first: one-time initialisation (dispatch tables, static locals) is not a hot path.
+    f();
+
+    allocations = frees = throws = 0;
+    armed = true;
+    for (int i = 0; i < 100; ++i)
+    {
+      f();
+    }
+    armed = false;
+
+    bool clean = (allocations == 0 && frees == 0 && throws == 0);
+    bool pass = (clean == expectClean);
+    if (!pass)
+    {
+      ++failures;
+    }
+
+    std::cout << std::left << std::setw(44) << name << std::right
+              << " allocations " << std::setw(6) << allocations
+              << " frees " << std::setw(6) << frees
+              << " throws " << std::setw(6) << throws
+              << (pass ? "  ok" : "  FAIL") << std::endl;
+  }
+
+  volatile double sink = 0;
+}
+
+int main(void)
+{
+  nextThrow = (ThrowFunction)dlsym(RTLD_NEXT, "__cxa_throw");
+  if (nextThrow == 0)
+  {
+    std::cerr << "Cannot find the runtime __cxa_throw." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Allocation and exception audit, 100 calls per operation." << std::endl;
+  std::cout << "Self-tests (must be detected):" << std::endl;
+
+  audit("malloc", []()
+  {
+    void* volatile p = std::malloc(16);
+    std::free(p);
+  }, false);
+
+  audit("throw", []()
+  {
+    try
+    {
+      throw 1;
+    }
+    catch (int)
+    {
+    }
+  }, false);
+
+  // Invalid input is allowed to throw, and the throw is seen.
+  Chaind invalidChain;
+  invalidChain.addJoint(Twistd(0, 0, 0, 0, 0, 1));
+  audit("Chain::forwardKinematics, wrong size", [&]()
+  {
+    try
+    {
+      std::vector<double> q(3, 0.0);
+      sink = sink + invalidChain.forwardKinematics(q)(0, 3);
+    }
+    catch (ScrewException&)
+    {
+    }
+  }, false);
+
+  std::cout << "Hot paths (must be clean):" << std::endl;
+
+  Rotationd R1(Translationd(1, 2, 3).normalised(), 0.7);
+  Rotationd R2(Translationd(-1, 0.5, 2).normalised(), 2.1);
+  HomogeneousTransformd H1(R1, Translationd(0.1, -0.2, 0.3));
+  HomogeneousTransformd H2(R2, Translationd(-1, 2, 0.5));
+  HomogeneousTransformd H3;
+  Translationd p(0.3, 0.2, 0.1);
+  Skewd S(Translationd(0.3, -0.4, 1.2));
+  Twistd xi(0.1, 0.2, -0.3, 0.3, -0.4, 1.2);
+  Twistd pure(0.1, 0.2, -0.3, 0, 0, 0);
+
+  audit("Skew::exp", [&]() { sink = sink + S.exp(0.8)(0, 1); });
+  audit("Rotation::log", [&]() { sink = sink + R2.log()(0, 1); });
+  audit("Rotation::operator*", [&]() { sink = sink + (R1*R2)(0, 1); });
+  audit("Rotation::inv", [&]() { sink = sink + R1.inv()(0, 1); });
+  audit("Twist::exp", [&]() { sink = sink + xi.exp(0.8)(0, 3); });
+  audit("Twist::exp, pure translation", [&]() { sink = sink + pure.exp(0.8)(0, 3); });
+  audit("HomogeneousTransform::log", [&]() { sink = sink + H2.log().coordinates()(0); });
+  audit("HomogeneousTransform::operator*", [&]() { sink = sink + (H1*H2)(0, 3); });
+  audit("HomogeneousTransform::operator*=", [&]() { H3 = H1; H3 *= H2; sink = sink + H3(0, 3); });
+  audit("HomogeneousTransform::operator*, point", [&]() { sink = sink + (H1*p)(0); });
+  audit("HomogeneousTransform::inv", [&]() { sink = sink + H1.inv()(0, 3); });
+  audit("HomogeneousTransform::mulInto", [&]() { HomogeneousTransformd::mulInto(H3, H1, H2); sink = sink + H3(0, 3); });
+  audit("HomogeneousTransform::invInto", [&]() { HomogeneousTransformd::invInto(H3, H2); sink = sink + H3(0, 3); });
+  audit("HomogeneousTransform::relative", [&]() { sink = sink + H1.relative(H2)(0, 3); });
+  audit("HomogeneousTransform::relativeLog", [&]() { sink = sink + H1.relativeLog(H2).coordinates()(0); });
+  audit("lazy expression eval", [&]() { sink = sink + (lazy(H1)*H2*lazy(H1).inv()*p)(0); });
+
+  // Chain: a 6 joint arm, with the Jacobian presized by the caller.
+  std::vector<Twistd> twists;
+  twists.push_back(Twistd(0, 0, 0, 0, 0, 1));
+  twists.push_back(Twistd(0, -0.3, 0, 1, 0, 0));
+  twists.push_back(Twistd(0, -0.7, 0, 1, 0, 0));
+  twists.push_back(Twistd(0, 0, 0, 0, 0, 1));
+  twists.push_back(Twistd(0, -1.0, 0, 1, 0, 0));
+  twists.push_back(Twistd(0, 0, 0, 0, 0, 1));
+  Chaind chain(twists, HomogeneousTransformd(Rotationd(), Translationd(0, 0, 1.1)));
+  std::vector<double> q(6);
+  for (size_t i = 0; i < q.size(); ++i)
+  {
+    q[i] = 0.3*(double)i - 0.7;
+  }
+  Chaind::Jacobian J(6, chain.joints());
+
+  audit("Chain::forwardKinematics", [&]() { chain.forwardKinematics(&q[0], H3); sink = sink + H3(0, 3); });
+  audit("Chain::forwardKinematics, vector", [&]() { sink = sink + chain.forwardKinematics(q)(0, 3); });
+  audit("Chain::spatialJacobian", [&]() { chain.spatialJacobian(&q[0], J); sink = sink + J(0, 1); });
+  Chaind::Jacobian Jdot(6, chain.joints());
+  std::vector<double> qdJ(chain.joints(), 0.4);
+  audit("Chain::spatialJacobian, derivative", [&]() { chain.spatialJacobian(&q[0], &qdJ[0], J, Jdot); sink = sink + Jdot(0, 1); });
+
+  // Inverse dynamics of the same arm with unit links, into a sized workspace.
+  Dynamicsd dynamics(chain);
+  for (size_t i = 0; i < chain.joints(); ++i)
+  {
+    dynamics.setLink(i, HomogeneousTransformd(), SpatialInertiad(1.0, Translationd(0, 0, 0.1), 0.01, 0.01, 0.01));
+  }
+  std::vector<double> qd(6, 0.5), qdd(6, -0.2), tau(6);
+  Dynamicsd::Workspace ws(dynamics.joints());
+  audit("Dynamics::inverseDynamics", [&]() { dynamics.inverseDynamics(&q[0], &qd[0], &qdd[0], &tau[0], ws); sink = sink + tau[0]; });
+  audit("Dynamics::forwardDynamics", [&]() { dynamics.forwardDynamics(&q[0], &qd[0], &tau[0], &qdd[0], ws); sink = sink + qdd[0]; });
+  Dynamicsd::MassMatrix M(dynamics.joints(), dynamics.joints());
+  audit("Dynamics::massMatrix", [&]() { dynamics.massMatrix(&q[0], M, ws); sink = sink + M(0, 1); });
+  audit("Dynamics::biasForces", [&]() { dynamics.biasForces(&q[0], &qd[0], &tau[0], ws); sink = sink + tau[0]; });
+  audit("Dynamics::gravityTorques", [&]() { dynamics.gravityTorques(&q[0], &tau[0], ws); sink = sink + tau[0]; });
+  audit("Dynamics::massMatrixAndBias", [&]() { dynamics.massMatrixAndBias(&q[0], &qd[0], M, &tau[0], ws); sink = sink + M(0, 1); });
+
+  // The lookup table allocates its pages on first use; build() moves that out of the loop.
+  TwistExpCached cache(xi, 12);
+  cache.build();
+  audit("TwistExpCache::exp, built", [&]() { sink = sink + cache.exp(1234)(0, 3); });
+
+  // Batch kernels into presized outputs.
+  const size_t n = 1000;
+  std::vector<double> theta(n), wx(n), wy(n), wz(n), x(n), y(n), z(n), ox(n), oy(n), oz(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    theta[i] = 6.0*(double)i/(double)n;
+    wx[i] = 0.3; wy[i] = -0.4; wz[i] = 1.2;
+    x[i] = (double)i; y[i] = 1.0; z[i] = -(double)i;
+  }
+  RotationBatchd batch(n);
+  TransformBatchd poses(n), relative(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    poses.set(i, xi.exp(theta[i]));
+  }
+
+  audit("BatchKernels::exp", [&]() { BatchKernels::exp(S, &theta[0], n, batch); sink = sink + batch(0, 1, 7); });
+  audit("BatchKernels::exp, many skews", [&]() { BatchKernels::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batch); sink = sink + batch(0, 1, 7); });
+  audit("BatchKernels::log", [&]() { BatchKernels::log(batch, &ox[0], &oy[0], &oz[0]); sink = sink + ox[7]; });
+  audit("BatchKernels::transform", [&]() { BatchKernels::transform(H1, &x[0], &y[0], &z[0], n, &ox[0], &oy[0], &oz[0]); sink = sink + ox[7]; });
+  std::vector<Wrenchd> wrenches(n, Wrenchd(0.1, 0.2, 9.81, 0.01, -0.02, 0.0)), movedWrenches(n);
+  audit("Wrench::changeFrame, batch", [&]() { Wrenchd::changeFrame(H1, &wrenches[0], n, &movedWrenches[0]); sink = sink + movedWrenches[7](2); });
+  std::vector<HomogeneousTransformd> bodies(n, H1);
+  auto drift = [](const size_t& i, const double& t, const HomogeneousTransformd&) { return TwistCoordinatesd(0.1*i, 0.2, t, 0.3, -0.1, 0.5); };
+  audit("LieIntegrator::step, batch", [&]() { LieIntegratord::step(drift, 0.0, &bodies[0], n, 0.01); sink = sink + bodies[7](0, 3); });
+  CosseratRodd rod(0.2, 60e9, 60e9/2.6, 0.5e-3, 0.35e-3, 16);
+  CosseratRodd::Workspace rodWorkspace;
+  const Wrenchd rodLoads[2] = { Wrenchd(0.02, -0.01, 0.0, 0.001, 0.0, 0.0), Wrenchd(0.021, -0.01, 0.0, 0.001, 0.0, 0.0) };
+  size_t rodSample = 0;
+  audit("CosseratRod::solve, warm", [&]() { rod.solve(H1, rodLoads[++rodSample % 2], rodWorkspace); sink = sink + rodWorkspace.tipPose()(0, 3); });
+  std::vector<double> kappas(n, 12.0), phis(theta), lengths(n, 0.04);
+  std::vector<HomogeneousTransformd> arcs(n);
+  audit("ConstantCurvatureSegment::transform, batch", [&]() { ConstantCurvatureSegmentd::transform(&kappas[0], &phis[0], &lengths[0], n, &arcs[0]); sink = sink + arcs[7](0, 3); });
+  const ConstantCurvatureSegmentd robot[3] = { ConstantCurvatureSegmentd(10, 0.3, 0.05), ConstantCurvatureSegmentd(-4, 2.0, 0.04), ConstantCurvatureSegmentd(0, 1.0, 0.02) };
+  ConstantCurvatureSegmentd::RobotJacobian robotJacobian(6, 9);
+  audit("ConstantCurvatureSegment::spatialJacobian", [&]() { ConstantCurvatureSegmentd::spatialJacobian(robot, 3, robotJacobian); sink = sink + robotJacobian(0, 4); });
+  ConcentricTubeRobotd tubes;
+  tubes.addTube(0.10, 0.05, 8, 60e9, 60e9/2.6, 1.0e-3, 0.85e-3);
+  tubes.addTube(0.16, 0.06, 12, 60e9, 60e9/2.6, 0.8e-3, 0.65e-3);
+  tubes.addTube(0.22, 0.04, 15, 60e9, 60e9/2.6, 0.55e-3, 0.4e-3);
+  tubes.setTranslation(1, -0.03);
+  tubes.setTranslation(2, -0.05);
+  size_t turn = 0;
+  audit("ConcentricTubeRobot::update, turn", [&]() { tubes.setRotation(1, 0.01*(double)(++turn % 4)); tubes.update(); sink = sink + tubes.tipPose()(0, 3); });
+  audit("TransformBatch::relative", [&]() { TransformBatchd::relative(poses, poses, relative); sink = sink + relative(0, 3, 7); });
+
+  if (failures != 0)
+  {
+    std::cout << failures << " audited operation(s) failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "All audited operations are allocation and exception free." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "batchKernels.hpp"
+#include "trace.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+using namespace screws;
+
+// The variants are the same template code compiled with different target attributes. The target
+// attribute only applies to the function it is on, so flatten inlines the header kernels into each
+// variant; anything left out of line (allocation, exceptions) is the ordinary baseline code. Unlike
+// compiling the file with -mavx2, no inline function shared with other translation units is emitted
+// with instructions the host may lack.
+#if defined(SCREWS_RUNTIME_DISPATCH) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCREWS_HAS_DISPATCH
+#endif
+
+namespace
+{
+  template<class NumType>
+  struct Kernels
+  {
+    typedef void (*ExpOne)(const Skew<NumType>&, const NumType*, const size_t&, RotationBatch<NumType>&);
+    typedef void (*ExpMany)(const NumType*, const NumType*, const NumType*, const NumType*,
+                            const size_t&, RotationBatch<NumType>&);
+    typedef void (*Log)(const RotationBatch<NumType>&, NumType*, NumType*, NumType*);
+    typedef void (*Transform)(const HomogeneousTransform<NumType>&, const NumType*, const NumType*, const NumType*,
+                              const size_t&, NumType*, NumType*, NumType*);
+
+    ExpOne expOne;
+    ExpMany expMany;
+    Log log;
+    Transform transform;
+  };
+
+  struct KernelTable
+  {
+    BatchKernels::Isa isa;
+    const char* name;
+    Kernels<double> d;
+    Kernels<float> f;
+  };
+
+#define SCREWS_BATCH_VARIANT(SUFFIX, ATTRIBUTES) \
+  template<class NumType> ATTRIBUTES \
+  void expOne##SUFFIX(const Skew<NumType>& S, const NumType* theta, const size_t& n, RotationBatch<NumType>& out) \
+  { \
+    S.exp(theta, n, out); \
+  } \
+  template<class NumType> ATTRIBUTES \
+  void expMany##SUFFIX(const NumType* wx, const NumType* wy, const NumType* wz, const NumType* theta, \
+                       const size_t& n, RotationBatch<NumType>& out) \
+  { \
+    Skew<NumType>::exp(wx, wy, wz, theta, n, out); \
+  } \
+  template<class NumType> ATTRIBUTES \
+  void log##SUFFIX(const RotationBatch<NumType>& R, NumType* wx, NumType* wy, NumType* wz) \
+  { \
+    R.log(wx, wy, wz); \
+  } \
+  template<class NumType> ATTRIBUTES \
+  void transform##SUFFIX(const HomogeneousTransform<NumType>& H, const NumType* x, const NumType* y, const NumType* z, \
+                         const size_t& n, NumType* ox, NumType* oy, NumType* oz) \
+  { \
+    H.transform(x, y, z, n, ox, oy, oz); \
+  } \
+  template<class NumType> \
+  Kernels<NumType> kernels##SUFFIX() \
+  { \
+    Kernels<NumType> k; \
+    k.expOne = &expOne##SUFFIX<NumType>; \
+    k.expMany = &expMany##SUFFIX<NumType>; \
+    k.log = &log##SUFFIX<NumType>; \
+    k.transform = &transform##SUFFIX<NumType>; \
+    return k; \
+  }
+
+  SCREWS_BATCH_VARIANT(Baseline, )
+#ifdef SCREWS_HAS_DISPATCH
+  SCREWS_BATCH_VARIANT(Avx2, __attribute__((target("avx2,fma"), flatten)))
+  SCREWS_BATCH_VARIANT(Avx512, __attribute__((target("avx512f,avx512dq,avx2,fma"), flatten)))
+#endif
+
+#undef SCREWS_BATCH_VARIANT
+
+  const KernelTable& table(const BatchKernels::Isa& isa)
+  {
+    static const KernelTable baseline = { BatchKernels::BASELINE, "baseline",
+                                          kernelsBaseline<double>(), kernelsBaseline<float>() };
+#ifdef SCREWS_HAS_DISPATCH
+    static const KernelTable avx2 = { BatchKernels::AVX2, "avx2",
+                                      kernelsAvx2<double>(), kernelsAvx2<float>() };
+    static const KernelTable avx512 = { BatchKernels::AVX512, "avx512",
+                                        kernelsAvx512<double>(), kernelsAvx512<float>() };
+    switch (isa)
+    {
+    case BatchKernels::AVX2:
+      return avx2;
+    case BatchKernels::AVX512:
+      return avx512;
+    default:
+      break;
+    }
+#else
+    (void)isa;
+#endif
+    return baseline;
+  }
+
+  bool hostSupports(const BatchKernels::Isa& isa)
+  {
+    switch (isa)
+    {
+    case BatchKernels::BASELINE:
+      return true;
+#ifdef SCREWS_HAS_DISPATCH
+    case BatchKernels::AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case BatchKernels::AVX512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+             __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    default:
+      return false;
+    }
+  }
+
+  // The best supported variant, or the one named by SCREWS_BATCH_ISA if the host supports it.
+  const KernelTable* select()
+  {
+    const char* env = std::getenv("SCREWS_BATCH_ISA");
+    if (env != 0)
+    {
+      const BatchKernels::Isa all[] = { BatchKernels::BASELINE, BatchKernels::AVX2, BatchKernels::AVX512 };
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        if (std::strcmp(env, table(all[i]).name) == 0 && hostSupports(all[i]))
+        {
+          return &table(all[i]);
+        }
+      }
+    }
+
+    if (hostSupports(BatchKernels::AVX512))
+    {
+      return &table(BatchKernels::AVX512);
+    }
+    if (hostSupports(BatchKernels::AVX2))
+    {
+      return &table(BatchKernels::AVX2);
+    }
+    return &table(BatchKernels::BASELINE);
+  }
+
+  std::atomic<const KernelTable*> active(0);
+
+  const KernelTable& current()
+  {
+    const KernelTable* t = active.load(std::memory_order_acquire);
+    if (t == 0)
+    {
+      // Concurrent first calls all select the same table, so the race is harmless.
+      t = select();
+      active.store(t, std::memory_order_release);
+    }
+    return *t;
+  }
+
+  template<class NumType>
+  const Kernels<NumType>& kernels();
+
+  template<>
+  const Kernels<double>& kernels<double>()
+  {
+    return current().d;
+  }
+
+  template<>
+  const Kernels<float>& kernels<float>()
+  {
+    return current().f;
+  }
+}
+
+BatchKernels::Isa BatchKernels::isa()
+{
+  return current().isa;
+}
+
+const char* BatchKernels::isaName()
+{
+  return current().name;
+}
+
+bool BatchKernels::isSupported(const Isa& variant)
+{
+  return hostSupports(variant);
+}
+
+void BatchKernels::setIsa(const Isa& variant)
+{
+  if (!hostSupports(variant))
+  {
+    ScrewException e("Instruction set not compiled in or not supported by this processor.", __FILE__, __FUNCTION__, __LINE__);
+    throw e;
+  }
+
+  active.store(&table(variant), std::memory_order_release);
+}
+
+void BatchKernels::exp(const Skew<double>& S, const double* theta, const size_t& n, RotationBatch<double>& out)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::exp", n);
+  kernels<double>().expOne(S, theta, n, out);
+}
+
+void BatchKernels::exp(const Skew<float>& S, const float* theta, const size_t& n, RotationBatch<float>& out)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::exp", n);
+  kernels<float>().expOne(S, theta, n, out);
+}
+
+void BatchKernels::exp(const double* wx, const double* wy, const double* wz, const double* theta,
+                       const size_t& n, RotationBatch<double>& out)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::exp", n);
+  kernels<double>().expMany(wx, wy, wz, theta, n, out);
+}
+
+void BatchKernels::exp(const float* wx, const float* wy, const float* wz, const float* theta,
+                       const size_t& n, RotationBatch<float>& out)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::exp", n);
+  kernels<float>().expMany(wx, wy, wz, theta, n, out);
+}
+
+void BatchKernels::log(const RotationBatch<double>& R, double* wx, double* wy, double* wz)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::log", R.size());
+  kernels<double>().log(R, wx, wy, wz);
+}
+
+void BatchKernels::log(const RotationBatch<float>& R, float* wx, float* wy, float* wz)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::log", R.size());
+  kernels<float>().log(R, wx, wy, wz);
+}
+
+void BatchKernels::transform(const HomogeneousTransform<double>& H, const double* x, const double* y, const double* z,
+                             const size_t& n, double* ox, double* oy, double* oz)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::transform", n);
+  kernels<double>().transform(H, x, y, z, n, ox, oy, oz);
+}
+
+void BatchKernels::transform(const HomogeneousTransform<float>& H, const float* x, const float* y, const float* z,
+                             const size_t& n, float* ox, float* oy, float* oz)
+{
+  SCREWS_TRACE_SCOPE_SIZE("BatchKernels::transform", n);
+  kernels<float>().transform(H, x, y, z, n, ox, oy, oz);
+}
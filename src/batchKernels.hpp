@@ -0,0 +1,92 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef BATCHKERNELS_HPP
+#define BATCHKERNELS_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "rotationBatch.hpp"
+
+namespace screws
+{
+  /*!
+   * \class BatchKernels
+   * \ingroup libScrews
+   * \brief Compiled batch exp/log/transform kernels, with a variant per instruction set chosen at run time.
+   *
+   * The kernels are the header batch functions (Skew::exp, RotationBatch::log,
+   * HomogeneousTransform::transform) compiled into the library once per instruction set: the
+   * compiler's baseline (SSE2 on x86-64), AVX2 and AVX-512. The first call picks the best variant
+   * the host supports, unless the SCREWS_BATCH_ISA environment variable names one (baseline,
+   * avx2, avx512). Only the baseline variant exists without the SCREWS_RUNTIME_DISPATCH CMake
+   * option or on compilers other than GCC/Clang for x86.
+   * The kernels use the math policy the library was built with. With the standard library policy,
+   * exp() and log() are bound by the sin/cos/atan2 calls and gain little from wider vectors; with
+   * SCREWS_FAST_MATH, benchScrews measures about 1.4x (exp) and 2.8x (log) from baseline to AVX-512
+   * in double precision.
+   */
+  class SCREWS_EXPORT BatchKernels
+  {
+  public:
+    /// @brief The instruction set variants.
+    enum Isa
+    {
+      BASELINE,
+      AVX2,
+      AVX512
+    };
+
+    /// @return the variant in use.
+    static Isa isa();
+
+    /// @return the name of the variant in use, e.g. for logs.
+    static const char* isaName();
+
+    /// @return true if the variant is compiled in and the host can run it.
+    static bool isSupported(const Isa& variant);
+
+    /// @brief Switch to another variant, e.g. to benchmark them. Not thread-safe with respect to
+    /// kernels running in other threads.
+    /// @throw screws::ScrewException if the variant is not supported.
+    static void setIsa(const Isa& variant);
+
+    /// @brief out[i] = exp(S*theta[i]), see Skew::exp().
+    static void exp(const Skew<double>& S, const double* theta, const size_t& n, RotationBatch<double>& out);
+    static void exp(const Skew<float>& S, const float* theta, const size_t& n, RotationBatch<float>& out);
+
+    /// @brief out[i] = exp(S_i*theta[i]) for skews in structure of arrays, see Skew::exp().
+    static void exp(const double* wx, const double* wy, const double* wz, const double* theta,
+                    const size_t& n, RotationBatch<double>& out);
+    static void exp(const float* wx, const float* wy, const float* wz, const float* theta,
+                    const size_t& n, RotationBatch<float>& out);
+
+    /// @brief Logarithms of a batch of rotations, see RotationBatch::log().
+    static void log(const RotationBatch<double>& R, double* wx, double* wy, double* wz);
+    static void log(const RotationBatch<float>& R, float* wx, float* wy, float* wz);
+
+    /// @brief Transform points in structure of arrays, see HomogeneousTransform::transform().
+    static void transform(const HomogeneousTransform<double>& H, const double* x, const double* y, const double* z,
+                          const size_t& n, double* ox, double* oy, double* oz);
+    static void transform(const HomogeneousTransform<float>& H, const float* x, const float* y, const float* z,
+                          const size_t& n, float* ox, float* oy, float* oz);
+  };
+};
+
+#endif // BATCHKERNELS_HPP
@@ -0,0 +1,1267 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Benchmark and accuracy harness.
+// Reports, for every kernel, the time per call of the standard library and of the fast math policy,
+// the speedup, and the maximum absolute error against the double precision library. The library
+// functions (exp, log, rpy) are then timed with the policy this executable was compiled with, so
+// run both benchScrews and benchScrewsFastMath to choose the mode for a deployment.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful timings.
+// On Linux, every timed operation is also measured with the hardware counters of perf_event_open
+// (cycles, instructions, L1D and last level cache misses, branches and branch misses), printed in a
+// table at the end. If the kernel does not allow them (see /proc/sys/kernel/perf_event_paranoid),
+// only the timings are reported.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "fastMath.hpp"
+#include "rotationBatch.hpp"
+#include "batchKernels.hpp"
+#include "transformExpression.hpp"
+#include "transformBatch.hpp"
+#include "chain.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include "dynamics.hpp"
+#include "lieIntegrator.hpp"
+#include "cosseratRod.hpp"
+#include "constantCurvatureSegment.hpp"
+#include "concentricTubeRobot.hpp"
+
+static const int reps = 5;
+static volatile double sink = 0;
+
+// Hardware counters of the calling thread, user space only. Each event is opened on its own rather
+// than as a group, so that the kernel can multiplex them when there are fewer counters than events;
+// the counts are scaled by the fraction of the time each event was scheduled.
+class PerfCounters
+{
+public:
+  enum Event
+  {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCHES,
+    BRANCH_MISSES,
+    EVENTS
+  };
+
+  PerfCounters()
+  {
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      _fd[e] = -1;
+      _count[e] = -1;
+    }
+#ifdef __linux__
+    const uint32_t types[EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                     PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+    const uint64_t configs[EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES };
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[e];
+      attr.config = configs[e];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      _fd[e] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      if (_fd[e] < 0 && _error.empty())
+      {
+        _error = std::strerror(errno);
+      }
+    }
+#else
+    _error = "perf_event_open is only available on Linux";
+#endif
+  }
+
+  ~PerfCounters()
+  {
+#ifdef __linux__
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      if (_fd[e] >= 0)
+      {
+        close(_fd[e]);
+      }
+    }
+#endif
+  }
+
+  // True if at least the cycle and instruction counters could be opened.
+  bool available() const
+  {
+    return _fd[CYCLES] >= 0 && _fd[INSTRUCTIONS] >= 0;
+  }
+
+  // Why an event could not be opened, empty if all could.
+  const std::string& error() const
+  {
+    return _error;
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      if (_fd[e] >= 0)
+      {
+        ioctl(_fd[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd[e], PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  void stop()
+  {
+#ifdef __linux__
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      if (_fd[e] >= 0)
+      {
+        ioctl(_fd[e], PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+    for (int e = 0; e < EVENTS; ++e)
+    {
+      // value, time enabled, time running
+      uint64_t values[3] = { 0, 0, 0 };
+      _count[e] = -1;
+      if (_fd[e] >= 0 && read(_fd[e], values, sizeof(values)) == (ssize_t)sizeof(values) && values[2] > 0)
+      {
+        _count[e] = (double)values[0]*(double)values[1]/(double)values[2];
+      }
+    }
+#endif
+  }
+
+  // The count of the last start()/stop(), or -1 if the event is not available.
+  double count(const Event& e) const
+  {
+    return _count[e];
+  }
+
+private:
+  int _fd[EVENTS];
+  double _count[EVENTS];
+  std::string _error;
+};
+
+static PerfCounters perf;
+
+// Counters per element of the fastest repetition of every timed operation.
+struct CounterRow
+{
+  std::string label;
+  double ns;
+  double count[PerfCounters::EVENTS];
+};
+static std::vector<CounterRow> counterRows;
+
+// Best of reps, in nanoseconds per element. The hardware counters of the best repetition are kept
+// under the label.
+template<class Function>
+double timePerCall(Function f, const size_t& n, const std::string& label)
+{
+  double best = 1e300;
+  CounterRow row;
+  row.label = label;
+  for (int r = 0; r < reps; ++r)
+  {
+    perf.start();
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    f();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    perf.stop();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count()/n;
+    if (ns < best)
+    {
+      best = ns;
+      row.ns = ns;
+      for (int e = 0; e < PerfCounters::EVENTS; ++e)
+      {
+        row.count[e] = perf.count((PerfCounters::Event)e)/n;
+      }
+    }
+  }
+  if (perf.available())
+  {
+    counterRows.push_back(row);
+  }
+  return best;
+}
+
+// The counter table: per element cycles, instructions per cycle, cache misses and the branch miss rate.
+void printCounters()
+{
+  std::cout << "\n == HARDWARE COUNTERS (per element, fastest repetition) == " << std::endl;
+  if (!perf.available())
+  {
+    std::cout << "Hardware counters unavailable (" << perf.error()
+              << "); see /proc/sys/kernel/perf_event_paranoid. Timings only." << std::endl;
+    return;
+  }
+  if (!perf.error().empty())
+  {
+    std::cout << "Some counters unavailable (" << perf.error() << "), shown as -." << std::endl;
+  }
+
+  std::cout << std::left << std::setw(44) << "operation" << std::right << std::setw(10) << "ns"
+            << std::setw(10) << "cycles" << std::setw(8) << "IPC" << std::setw(10) << "L1D miss"
+            << std::setw(10) << "LLC miss" << std::setw(10) << "branches" << std::setw(10) << "br miss%" << std::endl;
+  for (size_t k = 0; k < counterRows.size(); ++k)
+  {
+    const CounterRow& r = counterRows[k];
+    std::cout << std::left << std::setw(44) << r.label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << r.ns << std::setw(10) << r.count[PerfCounters::CYCLES];
+    if (r.count[PerfCounters::CYCLES] > 0)
+    {
+      std::cout << std::setw(8) << r.count[PerfCounters::INSTRUCTIONS]/r.count[PerfCounters::CYCLES];
+    }
+    else
+    {
+      std::cout << std::setw(8) << "-";
+    }
+    const PerfCounters::Event shown[] = { PerfCounters::L1D_MISSES, PerfCounters::LLC_MISSES, PerfCounters::BRANCHES };
+    for (int e = 0; e < 3; ++e)
+    {
+      if (r.count[shown[e]] >= 0)
+      {
+        std::cout << std::setw(10) << std::setprecision(3) << r.count[shown[e]];
+      }
+      else
+      {
+        std::cout << std::setw(10) << "-";
+      }
+    }
+    if (r.count[PerfCounters::BRANCHES] > 0 && r.count[PerfCounters::BRANCH_MISSES] >= 0)
+    {
+      std::cout << std::setw(10) << std::setprecision(2) << 100*r.count[PerfCounters::BRANCH_MISSES]/r.count[PerfCounters::BRANCHES];
+    }
+    else
+    {
+      std::cout << std::setw(10) << "-";
+    }
+    std::cout << std::endl;
+  }
+}
+
+// Angle error modulo 2pi and up to the sign convention of the axis.
+double wrappedError(const double& a, const double& b)
+{
+  double d = std::fmod(std::fabs(a - b), 2*M_PI);
+  double e = std::fmod(std::fabs(a + b), 2*M_PI);
+  return std::min(std::min(d, 2*M_PI - d), std::min(e, 2*M_PI - e));
+}
+
+void printRow(const std::string& name, const std::string& type,
+              const double& stdNs, const double& fastNs, const double& err)
+{
+  std::cout << std::left << std::setw(10) << name << std::setw(8) << type
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << stdNs << std::setw(10) << fastNs
+            << std::setw(9) << stdNs/fastNs << "x"
+            << std::scientific << std::setprecision(2) << std::setw(12) << err << std::endl;
+}
+
+template<class NumType>
+void benchKernels(const std::string& type)
+{
+  const size_t n = 1 << 16;
+  std::vector<NumType> x(n), y(n), s(n), c(n), out(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i] = (NumType)(-20 + 40*(double)i/n);
+    y[i] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+  }
+
+  // sin/cos
+  double stdNs = timePerCall([&]() { screws::StdMath<NumType>::sinCos(&x[0], &s[0], &c[0], n); sink += s[n/2]; }, n, "sincos std " + type);
+  double fastNs = timePerCall([&]() { screws::FastMath<NumType>::sinCos(&x[0], &s[0], &c[0], n); sink += s[n/2]; }, n, "sincos fast " + type);
+  double err = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    err = std::max(err, std::fabs((double)s[i] - std::sin((double)x[i])));
+    err = std::max(err, std::fabs((double)c[i] - std::cos((double)x[i])));
+  }
+  printRow("sincos", type, stdNs, fastNs, err);
+
+  // atan2
+  stdNs = timePerCall([&]() { screws::StdMath<NumType>::atan2(&y[0], &x[0], &out[0], n); sink += out[n/2]; }, n, "atan2 std " + type);
+  fastNs = timePerCall([&]() { screws::FastMath<NumType>::atan2(&y[0], &x[0], &out[0], n); sink += out[n/2]; }, n, "atan2 fast " + type);
+  err = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    err = std::max(err, std::fabs((double)out[i] - std::atan2((double)y[i], (double)x[i])));
+  }
+  printRow("atan2", type, stdNs, fastNs, err);
+
+  // acos
+  stdNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) out[i] = screws::StdMath<NumType>::acos(y[i]); sink += out[n/2]; }, n, "acos std " + type);
+  fastNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) out[i] = screws::FastMath<NumType>::acos(y[i]); sink += out[n/2]; }, n, "acos fast " + type);
+  err = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    err = std::max(err, std::fabs((double)out[i] - std::acos((double)y[i])));
+  }
+  printRow("acos", type, stdNs, fastNs, err);
+}
+
+template<class NumType>
+void benchLibrary(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  std::vector< screws::Skew<NumType> > S(n);
+  std::vector< screws::Twist<NumType> > Tw(n);
+  std::vector< screws::Rotation<NumType> > R(n);
+  std::vector<NumType> theta(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    screws::Vector3<NumType> w((NumType)((double)rand()/RAND_MAX + 0.1),
+                               (NumType)((double)rand()/RAND_MAX),
+                               (NumType)((double)rand()/RAND_MAX));
+    w = w/w.norm();
+    theta[i] = (NumType)(6*(double)rand()/RAND_MAX);
+    S[i] = screws::Skew<NumType>(w);
+    Tw[i] = screws::Twist<NumType>(screws::TwistCoordinates<NumType>((NumType)1, (NumType)2, (NumType)3, w(0), w(1), w(2)));
+    R[i] = S[i].exp(theta[i]);
+  }
+
+  // Errors against the closed forms evaluated with the double precision library.
+  double errExp = 0, errTwist = 0, errLog = 0, errRpy = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    Eigen::Matrix3d K = Eigen::Matrix3d::Zero();
+    for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c)
+        K(r, c) = (double)S[i](r, c);
+    double t = (double)theta[i];
+    Eigen::Matrix3d ref = Eigen::Matrix3d::Identity() + K*std::sin(t) + K*K*(1 - std::cos(t));
+    screws::Rotation<NumType> Ri = S[i].exp(theta[i]);
+    for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c)
+        errExp = std::max(errExp, std::fabs((double)Ri(r, c) - ref(r, c)));
+
+    // Unit axis w and v = (1, 2, 3): p = (I - R)(w x v) + w*(w.v)*theta.
+    Eigen::Vector3d w(K(2, 1), K(0, 2), K(1, 0));
+    Eigen::Vector3d v(1, 2, 3);
+    Eigen::Vector3d p = (Eigen::Matrix3d::Identity() - ref)*w.cross(v) + w*w.dot(v)*t;
+    screws::HomogeneousTransform<NumType> Hi = Tw[i].exp(theta[i]);
+    for (int r = 0; r < 3; ++r)
+      errTwist = std::max(errTwist, std::fabs((double)Hi(r, 3) - p(r)));
+
+    double tr = (double)R[i](0, 0) + (double)R[i](1, 1) + (double)R[i](2, 2) - 1;
+    double sn = std::sqrt(std::pow((double)R[i](2, 1) - (double)R[i](1, 2), 2) +
+                          std::pow((double)R[i](0, 2) - (double)R[i](2, 0), 2) +
+                          std::pow((double)R[i](1, 0) - (double)R[i](0, 1), 2));
+    errLog = std::max(errLog, wrappedError((double)R[i].angle(), std::atan2(sn, tr)));
+
+    double beta = std::atan2(-(double)R[i](2, 0), std::sqrt(std::pow((double)R[i](0, 0), 2) + std::pow((double)R[i](1, 0), 2)));
+    errRpy = std::max(errRpy, wrappedError((double)R[i].rpy()(1), beta));
+  }
+
+  double expNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) sink += S[i].exp(theta[i])(0, 0); }, n, "Skew::exp " + type);
+  double twistNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) sink += Tw[i].exp(theta[i])(0, 3); }, n, "Twist::exp " + type);
+  double logNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) sink += R[i].angle(); }, n, "angle " + type);
+  double rpyNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) sink += R[i].rpy()(0); }, n, "rpy " + type);
+
+  std::cout << std::left << std::setw(16) << ("Skew::exp " + type) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << expNs << std::scientific << std::setw(12) << errExp << std::endl;
+  std::cout << std::left << std::setw(16) << ("Twist::exp " + type) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << twistNs << std::scientific << std::setw(12) << errTwist << std::endl;
+  std::cout << std::left << std::setw(16) << ("angle " + type) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << logNs << std::scientific << std::setw(12) << errLog << std::endl;
+  std::cout << std::left << std::setw(16) << ("rpy " + type) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << rpyNs << std::scientific << std::setw(12) << errRpy << std::endl;
+}
+
+template<class NumType>
+void benchBatchExp(const std::string& type)
+{
+  const size_t n = 1 << 14;
+  std::vector< screws::Skew<NumType> > S(n);
+  std::vector<NumType> wx(n), wy(n), wz(n), theta(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    wx[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    wy[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    wz[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    theta[i] = (NumType)(6*(double)rand()/RAND_MAX);
+    S[i] = screws::Skew<NumType>(screws::Vector3<NumType>(wx[i], wy[i], wz[i]));
+  }
+
+  std::vector< screws::Rotation<NumType> > R(n);
+  screws::RotationBatch<NumType> batchOne(n), batchMany(n);
+  double scalarNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) R[i] = S[0].exp(theta[i]); sink += R[n/2](0, 0); }, n, "Skew::exp scalar " + type);
+  double oneNs = timePerCall([&]() { S[0].exp(&theta[0], n, batchOne); sink += batchOne(0, 0, n/2); }, n, "Skew::exp one skew " + type);
+  double manyNs = timePerCall([&]() { screws::Skew<NumType>::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batchMany); sink += batchMany(0, 0, n/2); }, n, "Skew::exp n skews " + type);
+
+  double errOne = 0, errMany = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    screws::Rotation<NumType> Rone = S[0].exp(theta[i]);
+    screws::Rotation<NumType> Rmany = S[i].exp(theta[i]);
+    for (unsigned int r = 0; r < 3; ++r)
+    {
+      for (unsigned int c = 0; c < 3; ++c)
+      {
+        errOne = std::max(errOne, std::fabs((double)batchOne(r, c, i) - (double)Rone(r, c)));
+        errMany = std::max(errMany, std::fabs((double)batchMany(r, c, i) - (double)Rmany(r, c)));
+      }
+    }
+  }
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << scalarNs
+            << std::setw(10) << oneNs << std::setw(9) << scalarNs/oneNs << "x"
+            << std::setw(10) << manyNs << std::setw(9) << scalarNs/manyNs << "x"
+            << std::setw(10) << 1e3/manyNs << std::scientific << std::setw(12) << std::max(errOne, errMany) << std::endl;
+}
+
+// H1*H2*H3.inv() and H1*H2*H3.inv()*p, eager operators against the lazy expressions.
+template<class NumType>
+void benchExpression(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  std::vector< screws::HomogeneousTransform<NumType> > H(n + 2);
+  std::vector< screws::Translation<NumType> > p(n);
+  for (size_t i = 0; i < n + 2; ++i)
+  {
+    screws::Skew<NumType> S(screws::Vector3<NumType>((NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5)));
+    H[i] = screws::HomogeneousTransform<NumType>(S.exp((NumType)1), screws::Translation<NumType>((NumType)1, (NumType)2, (NumType)3));
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    p[i] = screws::Translation<NumType>((NumType)((double)rand()/RAND_MAX), (NumType)1, (NumType)2);
+  }
+
+  screws::HomogeneousTransform<NumType> out;
+  screws::Translation<NumType> q;
+  double eagerNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) { out = H[i]*H[i + 1]*H[i + 2].inv(); sink += out(0, 3); } }, n, "eager H1*H2*H3.inv() " + type);
+  double lazyNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) { out = screws::lazy(H[i])*H[i + 1]*screws::lazy(H[i + 2]).inv(); sink += out(0, 3); } }, n, "lazy H1*H2*H3.inv() " + type);
+  double eagerPointNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) { q = H[i]*H[i + 1]*H[i + 2].inv()*p[i]; sink += q(0); } }, n, "eager H1*H2*H3.inv()*p " + type);
+  double lazyPointNs = timePerCall([&]() { for (size_t i = 0; i < n; ++i) { q = screws::lazy(H[i])*H[i + 1]*screws::lazy(H[i + 2]).inv()*p[i]; sink += q(0); } }, n, "lazy H1*H2*H3.inv()*p " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << eagerNs << std::setw(10) << lazyNs << std::setw(9) << eagerNs/lazyNs << "x"
+            << std::setw(10) << eagerPointNs << std::setw(10) << lazyPointNs << std::setw(9) << eagerPointNs/lazyPointNs << "x" << std::endl;
+}
+
+// Forward kinematics of a 6 joint chain: a product of 6 transforms, eager against storage reuse.
+template<class NumType>
+void benchChain(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  std::vector< screws::HomogeneousTransform<NumType> > H(n + 6);
+  for (size_t k = 0; k < n + 6; ++k)
+  {
+    screws::Skew<NumType> S(screws::Vector3<NumType>((NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5)));
+    H[k] = screws::HomogeneousTransform<NumType>(S.exp((NumType)1), screws::Translation<NumType>((NumType)1, (NumType)2, (NumType)3));
+  }
+
+  screws::HomogeneousTransform<NumType> out, buffer[2];
+  double eagerNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) { out = H[k]*H[k + 1]*H[k + 2]*H[k + 3]*H[k + 4]*H[k + 5]; sink += out(0, 3); } }, n, "chain eager " + type);
+  // Two buffers used in turn, so that each product is written directly into its output.
+  double intoNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      screws::HomogeneousTransform<NumType>::mulInto(buffer[1], H[k], H[k + 1]);
+      for (size_t j = 2; j < 6; ++j)
+      {
+        screws::HomogeneousTransform<NumType>::mulInto(buffer[j % 2], buffer[(j + 1) % 2], H[k + j]);
+      }
+      sink += buffer[1](0, 3);
+    }
+  }, n, "chain mulInto " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << eagerNs << std::setw(10) << intoNs << std::endl;
+}
+
+// Relative poses inv(Hi)*Hj and their logs over random index pairs.
+template<class NumType>
+void benchRelative(const std::string& type)
+{
+  const size_t nPoses = 1 << 10;
+  const size_t n = 1 << 14;
+  std::vector< screws::HomogeneousTransform<NumType> > P(nPoses);
+  for (size_t k = 0; k < nPoses; ++k)
+  {
+    screws::Skew<NumType> S(screws::Vector3<NumType>((NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5)));
+    P[k] = screws::HomogeneousTransform<NumType>(S.exp((NumType)2), screws::Translation<NumType>((NumType)1, (NumType)2, (NumType)3));
+  }
+  std::vector<size_t> I(n), J(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    I[k] = (size_t)rand() % nPoses;
+    J[k] = (size_t)rand() % nPoses;
+  }
+  screws::TransformBatch<NumType> Hi(n), Hj(n), rel;
+  for (size_t k = 0; k < n; ++k)
+  {
+    Hi.set(k, P[I[k]]);
+    Hj.set(k, P[J[k]]);
+  }
+  std::vector<NumType> v[6];
+  for (int q = 0; q < 6; ++q)
+  {
+    v[q].resize(n);
+  }
+
+  screws::HomogeneousTransform<NumType> H;
+  double eagerNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) { H = P[I[k]].inv()*P[J[k]]; sink += H(0, 3); } }, n, "relative eager " + type);
+  double relativeNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) { H = P[I[k]].relative(P[J[k]]); sink += H(0, 3); } }, n, "relative " + type);
+  double gatherNs = timePerCall([&]() { screws::TransformBatch<NumType>::relative(P, &I[0], &J[0], n, rel); sink += rel(0, 3, n/2); }, n, "relative gather " + type);
+  double soaNs = timePerCall([&]() { screws::TransformBatch<NumType>::relative(Hi, Hj, rel); sink += rel(0, 3, n/2); }, n, "relative SoA " + type);
+  double eagerLogNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) sink += screws::Twist<NumType>(P[I[k]].inv()*P[J[k]]).velocity()(0); }, n, "relative eager log " + type);
+  double logNs = timePerCall([&]() { screws::TransformBatch<NumType>::relativeLog(P, &I[0], &J[0], n, &v[0][0], &v[1][0], &v[2][0], &v[3][0], &v[4][0], &v[5][0]); sink += v[0][n/2]; }, n, "relative batch log " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << eagerNs << std::setw(10) << relativeNs << std::setw(10) << gatherNs << std::setw(10) << soaNs
+            << std::setw(12) << eagerLogNs << std::setw(12) << logNs << std::endl;
+}
+
+// The compiled kernels of BatchKernels, for each instruction set the host supports.
+template<class NumType>
+void benchDispatch(const std::string& type)
+{
+  const size_t n = 1 << 14;
+  std::vector<NumType> wx(n), wy(n), wz(n), theta(n), ox(n), oy(n), oz(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    wx[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    wy[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    wz[i] = (NumType)((double)rand()/RAND_MAX - 0.5);
+    theta[i] = (NumType)(6*(double)rand()/RAND_MAX);
+  }
+  screws::RotationBatch<NumType> batch(n);
+  screws::Skew<NumType>::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batch);
+  screws::HomogeneousTransform<NumType> H(batch.rotation(0), screws::Translation<NumType>(1, 2, 3));
+
+  const screws::BatchKernels::Isa initial = screws::BatchKernels::isa();
+  const screws::BatchKernels::Isa all[] = { screws::BatchKernels::BASELINE, screws::BatchKernels::AVX2, screws::BatchKernels::AVX512 };
+  for (unsigned int k = 0; k < 3; ++k)
+  {
+    if (!screws::BatchKernels::isSupported(all[k]))
+    {
+      continue;
+    }
+    screws::BatchKernels::setIsa(all[k]);
+    double expNs = timePerCall([&]() { screws::BatchKernels::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batch); sink += batch(0, 0, n/2); }, n, "BatchKernels::exp " + type + " " + screws::BatchKernels::isaName());
+    double logNs = timePerCall([&]() { screws::BatchKernels::log(batch, &ox[0], &oy[0], &oz[0]); sink += ox[n/2]; }, n, "BatchKernels::log " + type + " " + screws::BatchKernels::isaName());
+    double transformNs = timePerCall([&]() { screws::BatchKernels::transform(H, &wx[0], &wy[0], &wz[0], n, &ox[0], &oy[0], &oz[0]); sink += ox[n/2]; }, n, "BatchKernels::transform " + type + " " + screws::BatchKernels::isaName());
+
+    std::cout << std::left << std::setw(10) << type << std::setw(10) << screws::BatchKernels::isaName()
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << expNs << std::setw(10) << logNs << std::setw(12) << transformNs << std::endl;
+  }
+  screws::BatchKernels::setIsa(initial);
+}
+
+// Element access through the branching accessors, HomogeneousTransform::operator() and Vector6::operator().
+template<class NumType>
+void benchAccess(const std::string& type)
+{
+  const size_t n = 1 << 10;
+  std::vector< screws::HomogeneousTransform<NumType> > H(n);
+  std::vector< screws::Vector6<NumType> > V(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    screws::Skew<NumType> S(screws::Vector3<NumType>((NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5),
+                                                     (NumType)((double)rand()/RAND_MAX - 0.5)));
+    H[k] = screws::HomogeneousTransform<NumType>(S.exp((NumType)1), screws::Translation<NumType>((NumType)1, (NumType)2, (NumType)3));
+    V[k] = screws::Vector6<NumType>((NumType)k, (NumType)1, (NumType)2, (NumType)3, (NumType)4, (NumType)5);
+  }
+
+  double transformNs = timePerCall([&]()
+  {
+    NumType sum = 0;
+    for (size_t k = 0; k < n; ++k)
+      for (unsigned int i = 0; i < 4; ++i)
+        for (unsigned int j = 0; j < 4; ++j)
+          sum += H[k](i, j);
+    sink += sum;
+  }, 16*n, "HomogeneousTransform::operator() " + type);
+  double vectorNs = timePerCall([&]()
+  {
+    NumType sum = 0;
+    for (size_t k = 0; k < n; ++k)
+      for (unsigned int i = 0; i < 6; ++i)
+        sum += V[k](i);
+    sink += sum;
+  }, 6*n, "Vector6::operator() " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << transformNs << std::setw(10) << vectorNs << std::endl;
+}
+
+// Force/torque readings moved to another frame: the transposed 6x6 adjoint matrix against the
+// compact Ad^T of Wrench::changeFrame, one at a time and in a batch through one pose.
+template<class NumType>
+void benchWrench(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  std::vector< screws::Wrench<NumType> > F(n), out(n);
+  std::vector< Eigen::Matrix<NumType, 6, 1>, Eigen::aligned_allocator< Eigen::Matrix<NumType, 6, 1> > > raw(n), rawOut(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    F[k] = screws::Wrench<NumType>((NumType)((double)rand()/RAND_MAX), (NumType)((double)rand()/RAND_MAX), (NumType)((double)rand()/RAND_MAX),
+                                   (NumType)((double)rand()/RAND_MAX), (NumType)((double)rand()/RAND_MAX), (NumType)((double)rand()/RAND_MAX));
+    raw[k] << F[k](0), F[k](1), F[k](2), F[k](3), F[k](4), F[k](5);
+  }
+  screws::Skew<NumType> S(screws::Vector3<NumType>((NumType)0.3, (NumType)-0.2, (NumType)0.9));
+  screws::HomogeneousTransform<NumType> g(S.exp((NumType)1), screws::Translation<NumType>((NumType)0.1, (NumType)0.2, (NumType)0.3));
+
+  const Eigen::Matrix<NumType, 6, 6> AdT = screws::Adjoint<NumType>(g).matrix().transpose();
+  double matrixNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) rawOut[k].noalias() = AdT*raw[k]; sink += rawOut[n/2](0); }, n, "wrench 6x6 " + type);
+  double singleNs = timePerCall([&]() { for (size_t k = 0; k < n; ++k) out[k] = F[k].changeFrame(g); sink += out[n/2](0); }, n, "wrench changeFrame " + type);
+  double batchNs = timePerCall([&]() { screws::Wrench<NumType>::changeFrame(g, &F[0], n, &out[0]); sink += out[n/2](0); }, n, "wrench batch " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << matrixNs << std::setw(10) << singleNs << std::setw(10) << batchNs << std::endl;
+}
+
+// A 7 joint arm, revolute joints alternating between z and y, with 1-3 kg links at the joints.
+template<class NumType>
+screws::Dynamics<NumType> sevenJointArm()
+{
+  const NumType heights[7] = { (NumType)0.34, (NumType)0.34, (NumType)0.74, (NumType)0.74, (NumType)1.14, (NumType)1.14, (NumType)1.27 };
+  screws::Chain<NumType> arm;
+  for (int j = 0; j < 7; ++j)
+  {
+    // v = -w x q for w = y and q = (0, 0, h)
+    arm.addJoint((j % 2 == 0) ? screws::Twist<NumType>(0, 0, 0, 0, 0, 1) : screws::Twist<NumType>(heights[j], 0, 0, 0, 1, 0));
+  }
+  screws::Dynamics<NumType> dynamics(arm);
+  for (int j = 0; j < 7; ++j)
+  {
+    const NumType mass = (NumType)(3 - 0.3*j);
+    dynamics.setLink(j, screws::HomogeneousTransform<NumType>(screws::Rotation<NumType>(), screws::Translation<NumType>(0, 0, heights[j])),
+                     screws::SpatialInertia<NumType>(mass, screws::Translation<NumType>(0, (NumType)0.01, (NumType)0.05),
+                                                     (NumType)0.01*mass, (NumType)0.01*mass, (NumType)0.005*mass));
+  }
+  return dynamics;
+}
+
+// Inverse dynamics of the 7 joint arm with a reused workspace.
+template<class NumType>
+void benchDynamics(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  screws::Dynamics<NumType> dynamics = sevenJointArm<NumType>();
+  std::vector<NumType> q(7*n), qd(7*n), qdd(7*n), tau(7), taus(7*n);
+  for (size_t k = 0; k < 7*n; ++k)
+  {
+    q[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+    qd[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+    qdd[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+    taus[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+  }
+  typename screws::Dynamics<NumType>::Workspace ws(7);
+  std::vector<NumType> zero(7, 0), unit(7, 0);
+
+  double rneaNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.inverseDynamics(&q[7*k], &qd[7*k], &qdd[7*k], &tau[0], ws);
+      sink += tau[6];
+    }
+  }, n, "inverse dynamics " + type);
+
+  double abaNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.forwardDynamics(&q[7*k], &qd[7*k], &tau[0], &qdd[7*k], ws);
+      sink += qdd[7*k + 6];
+    }
+  }, n, "forward dynamics " + type);
+  std::vector<typename screws::Dynamics<NumType>::Workspace> workspaces(std::max(1u, std::thread::hardware_concurrency()));
+  double abaBatchNs = timePerCall([&]()
+  {
+    dynamics.forwardDynamics(&q[0], &qd[0], &taus[0], &qdd[0], n, workspaces);
+    sink += qdd[7*n - 1];
+  }, n, "forward dynamics batch " + type);
+
+  // Naive forward dynamics: the mass matrix from 7 inverse dynamics calls, the bias from one more,
+  // and a Cholesky solve.
+  screws::Dynamics<NumType> noGravity = dynamics;
+  noGravity.setGravity(screws::Translation<NumType>(0, 0, 0));
+  Eigen::Matrix<NumType, 7, 7> M;
+  Eigen::Matrix<NumType, 7, 1> rhs;
+  double naiveNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      for (int j = 0; j < 7; ++j)
+      {
+        unit[j] = 1;
+        noGravity.inverseDynamics(&q[7*k], &zero[0], &unit[0], &M(0, j), ws);
+        unit[j] = 0;
+      }
+      dynamics.inverseDynamics(&q[7*k], &qd[7*k], &zero[0], &rhs(0), ws);
+      Eigen::Map< Eigen::Matrix<NumType, 7, 1> > torques(&tau[0]), accelerations(&qdd[7*k]);
+      accelerations = M.llt().solve(torques - rhs);
+      sink += qdd[7*k + 6];
+    }
+  }, n, "naive forward dynamics " + type);
+
+  // Mass matrix: composite rigid body algorithm against 7 unit acceleration inverse dynamics calls.
+  typename screws::Dynamics<NumType>::MassMatrix Mc(7, 7);
+  double crbaNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.massMatrix(&q[7*k], Mc, ws);
+      sink += Mc(6, 6);
+    }
+  }, n, "mass matrix " + type);
+  double columnsNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      for (int j = 0; j < 7; ++j)
+      {
+        unit[j] = 1;
+        noGravity.inverseDynamics(&q[7*k], &zero[0], &unit[0], &M(0, j), ws);
+        unit[j] = 0;
+      }
+      sink += M(6, 6);
+    }
+  }, n, "mass matrix by inverse dynamics " + type);
+  double biasNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.biasForces(&q[7*k], &qd[7*k], &tau[0], ws);
+      sink += tau[6];
+    }
+  }, n, "bias forces " + type);
+
+  // Gravity torques: the fast path, a batch of configurations, and inverse dynamics at rest.
+  double gravityNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.gravityTorques(&q[7*k], &tau[0], ws);
+      sink += tau[6];
+    }
+  }, n, "gravity torques " + type);
+  std::vector<NumType> holding(7*n);
+  double gravityBatchNs = timePerCall([&]()
+  {
+    dynamics.gravityTorques(&q[0], &holding[0], n, ws);
+    sink += holding[7*n - 1];
+  }, n, "gravity torques batch " + type);
+  double restNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dynamics.inverseDynamics(&q[7*k], &zero[0], &zero[0], &tau[0], ws);
+      sink += tau[6];
+    }
+  }, n, "inverse dynamics at rest " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << rneaNs << std::setw(10) << abaNs << std::setw(10) << abaBatchNs << std::setw(10) << naiveNs
+            << std::setw(9) << naiveNs/abaNs << "x"
+            << std::setw(10) << crbaNs << std::setw(10) << columnsNs << std::setw(9) << columnsNs/crbaNs << "x"
+            << std::setw(10) << biasNs
+            << std::setw(10) << gravityNs << std::setw(10) << gravityBatchNs << std::setw(9) << restNs/gravityNs << "x" << std::endl;
+}
+
+// Spatial Jacobian of the 7 joint arm alone, with its derivative from the same pass, and with the
+// derivative from a central difference along qd.
+template<class NumType>
+void benchJacobianDerivative(const std::string& type)
+{
+  const size_t n = 1 << 12;
+  const screws::Chain<NumType> arm = sevenJointArm<NumType>().chain();
+  std::vector<NumType> q(7*n), qd(7*n), qp(7), qm(7);
+  for (size_t k = 0; k < 7*n; ++k)
+  {
+    q[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+    qd[k] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+  }
+  typename screws::Chain<NumType>::Jacobian J(6, 7), Jdot(6, 7), Jp(6, 7), Jm(6, 7);
+
+  double jacobianNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      arm.spatialJacobian(&q[7*k], J);
+      sink += J(0, 6);
+    }
+  }, n, "spatial Jacobian " + type);
+  double passNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      arm.spatialJacobian(&q[7*k], &qd[7*k], J, Jdot);
+      sink += Jdot(0, 6);
+    }
+  }, n, "spatial Jacobian and derivative " + type);
+  const NumType h = (NumType)1e-3;
+  double differenceNs = timePerCall([&]()
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      arm.spatialJacobian(&q[7*k], J);
+      for (int j = 0; j < 7; ++j)
+      {
+        qp[j] = q[7*k + j] + h*qd[7*k + j];
+        qm[j] = q[7*k + j] - h*qd[7*k + j];
+      }
+      arm.spatialJacobian(&qp[0], Jp);
+      arm.spatialJacobian(&qm[0], Jm);
+      Jdot = (Jp - Jm)/(2*h);
+      sink += Jdot(0, 6);
+    }
+  }, n, "spatial Jacobian and central difference " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << jacobianNs << std::setw(10) << passNs << std::setw(12) << differenceNs
+            << std::setw(9) << differenceNs/passNs << "x" << std::endl;
+}
+
+// A body with a prescribed body velocity over T = 1 in 64 steps: Euler steps on the 4x4 matrix with
+// Gram-Schmidt re-orthonormalisation, against the Lie group integrators. Time per step and the
+// largest pose error at T.
+template<class NumType>
+void benchLieIntegrator(const std::string& type)
+{
+  typedef screws::LieIntegrator<NumType> L;
+  typedef Eigen::Matrix<NumType, 4, 4> Matrix4;
+  const size_t steps = 64, runs = 64;
+  const NumType h = (NumType)1/steps;
+  auto profile = [](const NumType& t, const screws::HomogeneousTransform<NumType>&)
+  {
+    return screws::TwistCoordinates<NumType>((NumType)(0.5 + 0.3*sin(2*t)), (NumType)(-0.2*t), (NumType)cos(3*t),
+                                             (NumType)(0.6*sin(t)), (NumType)(0.8*cos(t)), (NumType)(1.0 - t*t));
+  };
+  const screws::HomogeneousTransform<NumType> g0;
+  const screws::HomogeneousTransform<NumType> reference = L::integrate(profile, (NumType)0, g0, (NumType)1/4096, 4096);
+  auto error = [&](const Matrix4& g)
+  {
+    double e = 0;
+    for (unsigned int r = 0; r < 3; ++r)
+    {
+      for (unsigned int c = 0; c < 4; ++c)
+      {
+        e = std::max(e, (double)std::abs(g(r, c) - reference(r, c)));
+      }
+    }
+    return e;
+  };
+  auto matrix = [](const screws::HomogeneousTransform<NumType>& g)
+  {
+    Matrix4 G;
+    for (unsigned int r = 0; r < 4; ++r)
+    {
+      for (unsigned int c = 0; c < 4; ++c)
+      {
+        G(r, c) = g(r, c);
+      }
+    }
+    return G;
+  };
+
+  Matrix4 euler;
+  double eulerNs = timePerCall([&]()
+  {
+    for (size_t run = 0; run < runs; ++run)
+    {
+      euler.setIdentity();
+      for (size_t k = 0; k < steps; ++k)
+      {
+        const screws::TwistCoordinates<NumType> V = profile(k*h, g0);
+        Matrix4 X = Matrix4::Zero();
+        X << 0, -V(5), V(4), V(0),
+             V(5), 0, -V(3), V(1),
+             -V(4), V(3), 0, V(2),
+             0, 0, 0, 0;
+        euler = euler + euler*X*h;
+        Eigen::Matrix<NumType, 3, 1> c0 = euler.template block<3, 1>(0, 0).normalized();
+        Eigen::Matrix<NumType, 3, 1> c1 = euler.template block<3, 1>(0, 1);
+        c1 = (c1 - c0*c0.dot(c1)).normalized();
+        euler.template block<3, 1>(0, 0) = c0;
+        euler.template block<3, 1>(0, 1) = c1;
+        euler.template block<3, 1>(0, 2) = c0.cross(c1);
+      }
+      sink += euler(0, 3);
+    }
+  }, runs*steps, "Euler and re-orthonormalisation " + type);
+
+  const typename L::Method methods[3] = { L::RKMK4, L::CROUCH_GROSSMAN3, L::MAGNUS4 };
+  const char* names[3] = { "RKMK4 ", "Crouch-Grossman ", "Magnus " };
+  double ns[3], errors[3];
+  for (int m = 0; m < 3; ++m)
+  {
+    screws::HomogeneousTransform<NumType> g;
+    ns[m] = timePerCall([&]()
+    {
+      for (size_t run = 0; run < runs; ++run)
+      {
+        g = L::integrate(profile, (NumType)0, g0, h, steps, methods[m]);
+        sink += g(0, 3);
+      }
+    }, runs*steps, names[m] + type);
+    errors[m] = error(matrix(g));
+  }
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << eulerNs << std::setw(10) << ns[0] << std::setw(10) << ns[1] << std::setw(10) << ns[2]
+            << std::scientific << std::setprecision(2) << std::setw(12) << error(euler) << std::setw(12) << errors[0]
+            << std::setw(12) << errors[1] << std::setw(12) << errors[2] << std::endl;
+}
+
+// 256 arcs: Rz(phi) [Ry(kappa l), p] Rz(-phi) from axis rotations and transform products, against
+// the closed form one at a time and in a batch, and the closed form body Jacobian.
+template<class NumType>
+void benchConstantCurvature(const std::string& type)
+{
+  typedef screws::ConstantCurvatureSegment<NumType> Segment;
+  const size_t n = 256;
+  std::vector<NumType> kappas(n), phis(n), lengths(n);
+  std::vector<Segment> segments(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    kappas[i] = (NumType)(1 + 20.0*rand()/RAND_MAX);
+    phis[i] = (NumType)(6.0*rand()/RAND_MAX);
+    lengths[i] = (NumType)(0.01 + 0.05*rand()/RAND_MAX);
+    segments[i].set(kappas[i], phis[i], lengths[i]);
+  }
+  std::vector< screws::HomogeneousTransform<NumType> > out(n);
+
+  double productsNs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      const NumType theta = kappas[i]*lengths[i];
+      out[i] = screws::HomogeneousTransform<NumType>(screws::Rotation<NumType>('z', phis[i]), screws::Translation<NumType>())*
+               screws::HomogeneousTransform<NumType>(screws::Rotation<NumType>('y', theta),
+                                                     screws::Translation<NumType>((1 - cos(theta))/kappas[i], 0, sin(theta)/kappas[i]))*
+               screws::HomogeneousTransform<NumType>(screws::Rotation<NumType>('z', (NumType)(2*M_PI) - phis[i]), screws::Translation<NumType>());
+    }
+    sink += out[n - 1](0, 3);
+  }, n, "Axis rotation products " + type);
+
+  double closedNs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      out[i] = segments[i].transform();
+    }
+    sink += out[n - 1](0, 3);
+  }, n, "ConstantCurvatureSegment::transform " + type);
+
+  double batchNs = timePerCall([&]()
+  {
+    Segment::transform(&kappas[0], &phis[0], &lengths[0], n, &out[0]);
+    sink += out[n - 1](0, 3);
+  }, n, "ConstantCurvatureSegment::transform batch " + type);
+
+  typename Segment::Jacobian J;
+  double jacobianNs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      J = segments[i].bodyJacobian();
+      sink += J(0, 0);
+    }
+  }, n, "ConstantCurvatureSegment::bodyJacobian " + type);
+
+  std::cout << std::left << std::setw(10) << type << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << productsNs << std::setw(10) << closedNs << std::setw(9) << productsNs/closedNs << "x"
+            << std::setw(10) << batchNs << std::setw(10) << jacobianNs << std::endl;
+}
+
+// A nitinol tube of 32 steps swept through 64 neighbouring tip loads: solves from the straight rod
+// (cold), from the previous sample (warm), Newton with a forward difference Jacobian from the straight
+// rod, and the warm sweep in a batch over the hardware threads. Time per solve.
+void benchCosseratRod()
+{
+  typedef screws::CosseratRodd Rod;
+  const size_t samples = 64;
+  Rod rod(0.2, 60e9, 60e9/2.6, 0.5e-3, 0.35e-3, 32);
+  rod.setPrecurvature(screws::Translationd(5, 0, 0));
+  std::vector<screws::HomogeneousTransformd> bases(samples), tips(samples);
+  std::vector<screws::Wrenchd> loads(samples);
+  for (size_t i = 0; i < samples; ++i)
+  {
+    const double s = (double)i/samples;
+    loads[i] = screws::Wrenchd(0.05*s, -0.03 + 0.02*s, 0.01, 0.002*s, 0, 0);
+  }
+  Rod::Workspace ws;
+  size_t iterations = 0;
+
+  double coldUs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < samples; ++i)
+    {
+      ws.reset();
+      rod.solve(bases[i], loads[i], ws);
+      sink += ws.tipPose()(0, 3);
+    }
+  }, samples, "CosseratRod::solve cold")/1000;
+
+  double warmUs = timePerCall([&]()
+  {
+    iterations = 0;
+    for (size_t i = 0; i < samples; ++i)
+    {
+      rod.solve(bases[i], loads[i], ws);
+      iterations += ws.iterations();
+      sink += ws.tipPose()(0, 3);
+    }
+  }, samples, "CosseratRod::solve warm")/1000;
+
+  double differenceUs = timePerCall([&]()
+  {
+    Rod::Coordinates W, r, rd;
+    Rod::Matrix6 J, unused;
+    for (size_t i = 0; i < samples; ++i)
+    {
+      const screws::Vector3d f = loads[i].force(), l = loads[i].moment();
+      W << f(0), f(1), f(2), l(0) - 0.2*f(1), l(1) + 0.2*f(0), l(2);
+      for (int it = 0; it < 20 && rod.residual(bases[i], loads[i], W, r, unused, ws) > 1e-9; ++it)
+      {
+        for (int c = 0; c < 6; ++c)
+        {
+          Rod::Coordinates Wd = W;
+          const double step = 1e-7*std::max(1.0, std::abs(W(c)));
+          Wd(c) += step;
+          rod.residual(bases[i], loads[i], Wd, rd, unused, ws);
+          J.col(c) = (rd - r)/step;
+        }
+        W -= J.partialPivLu().solve(r);
+      }
+      sink += ws.tipPose()(0, 3);
+    }
+  }, samples, "Newton, difference Jacobian")/1000;
+
+  const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Rod::Workspace> workspaces(threads);
+  double batchUs = timePerCall([&]()
+  {
+    rod.solve(&bases[0], &loads[0], samples, &tips[0], workspaces);
+    sink += tips[samples - 1](0, 3);
+  }, samples, "CosseratRod::solve batch")/1000;
+
+  std::cout << std::left << std::setw(10) << "double" << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << coldUs << std::setw(10) << warmUs << std::setw(10) << (double)iterations/samples
+            << std::setw(12) << differenceUs << std::setw(10) << differenceUs/coldUs << "x"
+            << std::setw(10) << batchUs << std::setw(10) << threads << std::endl;
+}
+
+// A three tube robot: updates from untwisted tubes (cold), after turning one tube by 0.01 rad (the
+// teleoperation case, predicted from the last solution) and after translating one tube, which
+// rebuilds the transition points. Time per update.
+void benchConcentricTubeRobot()
+{
+  const double E = 60e9, G = E/2.6;
+  screws::ConcentricTubeRobotd robot(1e-3);
+  robot.addTube(0.10, 0.05, 8, E, G, 1.0e-3, 0.85e-3);
+  robot.addTube(0.16, 0.06, 12, E, G, 0.8e-3, 0.65e-3);
+  robot.addTube(0.22, 0.08, 15, E, G, 0.55e-3, 0.4e-3);
+  robot.setTranslation(0, -0.01);
+  robot.setTranslation(1, -0.03);
+  robot.setTranslation(2, -0.07);
+  robot.setRotation(1, 1.0);
+  robot.setRotation(2, -0.5);
+  const size_t runs = 64;
+  size_t iterations = 0;
+
+  double coldUs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < runs; ++i)
+    {
+      robot.reset();
+      robot.update();
+      sink += robot.tipPose()(0, 3);
+    }
+  }, runs, "ConcentricTubeRobot::update cold")/1000;
+
+  double turnUs = timePerCall([&]()
+  {
+    iterations = 0;
+    for (size_t i = 0; i < runs; ++i)
+    {
+      robot.setRotation(2, -0.5 + 0.01*(double)(i % 8));
+      robot.update();
+      iterations += robot.iterations();
+      sink += robot.tipPose()(0, 3);
+    }
+  }, runs, "ConcentricTubeRobot::update turn")/1000;
+
+  double translateUs = timePerCall([&]()
+  {
+    for (size_t i = 0; i < runs; ++i)
+    {
+      robot.setTranslation(2, -0.07 + 0.001*(double)(i % 8));
+      robot.update();
+      sink += robot.tipPose()(0, 3);
+    }
+  }, runs, "ConcentricTubeRobot::update translate")/1000;
+
+  std::cout << std::left << std::setw(10) << "double" << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << coldUs << std::setw(10) << turnUs << std::setw(10) << (double)iterations/runs
+            << std::setw(9) << coldUs/turnUs << "x" << std::setw(12) << translateUs << std::endl;
+}
+
+int main(void)
+{
+  srand(1);
+
+#if defined(__GNUC__) && !defined(__OPTIMIZE__)
+  std::cout << "Warning: built without optimisation, timings are not representative." << std::endl;
+#endif
+
+  std::cout << " == KERNELS (ns per call) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "function" << std::setw(8) << "type"
+            << std::right << std::setw(10) << "std" << std::setw(10) << "fast"
+            << std::setw(10) << "speedup" << std::setw(12) << "max error" << std::endl;
+  benchKernels<double>("double");
+  benchKernels<float>("float");
+
+  std::cout << "\n == LIBRARY, math policy: " << screws::MathPolicy<double>::name() << " (ns per call, max error) == " << std::endl;
+  benchLibrary<double>("double");
+  benchLibrary<float>("float");
+
+  std::cout << "\n == BATCH RODRIGUES (ns per rotation) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "scalar"
+            << std::setw(20) << "one skew" << std::setw(20) << "n skews" << std::setw(10) << "Mrot/s"
+            << std::setw(12) << "vs scalar" << std::endl;
+  benchBatchExp<double>("double");
+  benchBatchExp<float>("float");
+
+  std::cout << "\n == RUNTIME DISPATCH, default: " << screws::BatchKernels::isaName() << " (ns per element) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::setw(10) << "isa" << std::right << std::setw(10) << "exp"
+            << std::setw(10) << "log" << std::setw(12) << "transform" << std::endl;
+  benchDispatch<double>("double");
+  benchDispatch<float>("float");
+
+  std::cout << "\n == TRANSFORM EXPRESSIONS, H1*H2*H3.inv() [*p] (ns per expression) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "eager" << std::setw(10) << "lazy"
+            << std::setw(10) << "speedup" << std::setw(10) << "eager*p" << std::setw(10) << "lazy*p" << std::setw(10) << "speedup" << std::endl;
+  benchExpression<double>("double");
+  benchExpression<float>("float");
+
+  std::cout << "\n == 6 JOINT CHAIN PRODUCT (ns per chain) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "eager" << std::setw(10) << "mulInto" << std::endl;
+  benchChain<double>("double");
+  benchChain<float>("float");
+
+  std::cout << "\n == WRENCH FRAME CHANGE (ns per wrench) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "6x6" << std::setw(10) << "single" << std::setw(10) << "batch" << std::endl;
+  benchWrench<double>("double");
+  benchWrench<float>("float");
+
+  std::cout << "\n == 7 JOINT DYNAMICS (ns per call) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "RNEA" << std::setw(10) << "ABA" << std::setw(10) << "ABA batch"
+            << std::setw(10) << "M solve" << std::setw(10) << "speedup"
+            << std::setw(10) << "CRBA" << std::setw(10) << "7 RNEA" << std::setw(10) << "speedup"
+            << std::setw(10) << "bias" << std::setw(10) << "gravity" << std::setw(10) << "batch"
+            << std::setw(10) << "vs RNEA" << std::endl;
+  benchDynamics<double>("double");
+  benchDynamics<float>("float");
+
+  std::cout << "\n == 7 JOINT JACOBIAN DERIVATIVE (ns per call) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "J" << std::setw(10) << "J, Jdot"
+            << std::setw(12) << "difference" << std::setw(10) << "speedup" << std::endl;
+  benchJacobianDerivative<double>("double");
+  benchJacobianDerivative<float>("float");
+
+  std::cout << "\n == LIE INTEGRATOR, 64 steps over T = 1 (ns per step, pose error at T) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "Euler" << std::setw(10) << "RKMK4"
+            << std::setw(10) << "CG3" << std::setw(10) << "Magnus" << std::setw(12) << "Euler" << std::setw(12) << "RKMK4"
+            << std::setw(12) << "CG3" << std::setw(12) << "Magnus" << std::endl;
+  benchLieIntegrator<double>("double");
+  benchLieIntegrator<float>("float");
+
+  std::cout << "\n == COSSERAT ROD, 32 steps, 64 tip loads (us per solve) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "cold" << std::setw(10) << "warm"
+            << std::setw(10) << "iter" << std::setw(12) << "difference" << std::setw(11) << "vs cold"
+            << std::setw(10) << "batch" << std::setw(10) << "threads" << std::endl;
+  benchCosseratRod();
+
+  std::cout << "\n == CONSTANT CURVATURE SEGMENT (ns per segment) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "products" << std::setw(10) << "closed"
+            << std::setw(10) << "speedup" << std::setw(10) << "batch" << std::setw(10) << "Jacobian" << std::endl;
+  benchConstantCurvature<double>("double");
+  benchConstantCurvature<float>("float");
+
+  std::cout << "\n == CONCENTRIC TUBE ROBOT, 3 tubes, 1 mm steps (us per update) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "cold" << std::setw(10) << "turn"
+            << std::setw(10) << "iter" << std::setw(10) << "speedup" << std::setw(12) << "translate" << std::endl;
+  benchConcentricTubeRobot();
+
+  std::cout << "\n == RELATIVE POSES inv(Hi)*Hj (ns per pair) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "eager" << std::setw(10) << "relative"
+            << std::setw(10) << "gather" << std::setw(10) << "SoA" << std::setw(12) << "eager log" << std::setw(12) << "batch log" << std::endl;
+  benchRelative<double>("double");
+  benchRelative<float>("float");
+
+  std::cout << "\n == ELEMENT ACCESS, H(i, j) over 4x4 and V(i) over 6 (ns per element) == " << std::endl;
+  std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(10) << "H(i, j)" << std::setw(10) << "V(i)" << std::endl;
+  benchAccess<double>("double");
+  benchAccess<float>("float");
+
+  printCounters();
+
+  return 0;
+}
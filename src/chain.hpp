@@ -0,0 +1,323 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CHAIN_HPP
+#define CHAIN_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+
+namespace screws
+{
+  /*!
+   * \class Chain
+   * \ingroup libScrews
+   * \brief Serial chain in product of exponentials form: g(q) = exp(xi_1 q_1)...exp(xi_n q_n) g(0).
+   *
+   * The joint twists are expressed in the base frame at the home configuration g(0) (Murray, Li and
+   * Sastry, ch. 3). Twist coordinates are ordered as in Twist::coordinates(): velocity, then rotation.
+   * forwardKinematics() and spatialJacobian() with caller storage do not allocate once the Jacobian
+   * has the right size, so they can run in a control loop; adding joints does. The joint
+   * exponentials use constants formed when the joint is added, with one sine and cosine per joint.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT Chain
+  {
+  public:
+    /// @brief 6xn spatial Jacobian; column i is the twist of joint i in the current configuration.
+    typedef Eigen::Matrix<NumType, 6, Eigen::Dynamic> Jacobian;
+
+    /// @brief Create a chain with no joints and the identity home configuration.
+    Chain()
+    {
+
+    }
+
+    /// @brief Create a chain from its joint twists and home configuration.
+    /// @param twists the joint twists, from the base outwards.
+    /// @param home the tool frame at q = 0.
+    Chain(const std::vector< Twist<NumType> >& twists, const HomogeneousTransform<NumType>& home)
+      : _home(home)
+    {
+      for (size_t i = 0; i < twists.size(); ++i)
+      {
+        addJoint(twists[i]);
+      }
+    }
+
+    /// Default destructor.
+    ~Chain()
+    {
+
+    }
+
+    /// @brief Append a joint at the tool end of the chain.
+    void addJoint(const Twist<NumType>& twist)
+    {
+      _twists.push_back(twist);
+      TwistCoordinates<NumType> c = twist.coordinates();
+      Vector6 xi;
+      xi << c(0), c(1), c(2), c(3), c(4), c(5);
+      _coordinates.push_back(xi);
+
+      // exp(xi q) = exp(xi' q') with xi' = xi/|w| and q' = |w| q, so that the axis has unit length.
+      JointConstants k;
+      const Vector3 v = xi.template head<3>(), w = xi.template tail<3>();
+      k.scale = w.norm();
+      if (k.scale < NumericTraits<NumType>::zeroTolerance())
+      {
+        k.scale = 0;
+        k.w.setZero();
+        k.a = v;
+        k.b.setZero();
+      }
+      else
+      {
+        k.w = w/k.scale;
+        k.a = k.w.cross(v)/k.scale;
+        k.b = k.w*(k.w.dot(v)/k.scale);
+      }
+      _constants.push_back(k);
+    }
+
+    /// @brief Change the home configuration g(0).
+    void setHome(const HomogeneousTransform<NumType>& home)
+    {
+      _home = home;
+    }
+
+    /// @return the home configuration g(0).
+    const HomogeneousTransform<NumType>& home() const
+    {
+      return _home;
+    }
+
+    /// @return the number of joints.
+    size_t joints() const
+    {
+      return _twists.size();
+    }
+
+    /// @return the twist of joint i.
+    const Twist<NumType>& twist(const size_t& i) const
+    {
+      assert(i < joints());
+      return _twists[i];
+    }
+
+    /// @brief Forward kinematics into caller storage.
+    /// @param q joints() joint values.
+    /// @param out the tool frame g(q).
+    void forwardKinematics(const NumType* q, HomogeneousTransform<NumType>& out) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Chain::forwardKinematics", joints());
+      Matrix3 R = Matrix3::Identity();
+      Vector3 p = Vector3::Zero();
+      for (size_t i = 0; i < joints(); ++i)
+      {
+        accumulateJoint(i, q[i], R, p);
+      }
+      accumulate(_home, R, p);
+
+      out.setUnchecked(R, p);
+    }
+
+    /// @brief Forward kinematics.
+    /// @throw screws::ScrewException if q does not have joints() values.
+    HomogeneousTransform<NumType> forwardKinematics(const std::vector<NumType>& q) const
+    {
+      checkSize(q);
+      HomogeneousTransform<NumType> g;
+      forwardKinematics(q.empty() ? 0 : &q[0], g);
+
+      return g;
+    }
+
+    /// @brief Spatial Jacobian into caller storage: column i = Ad(exp(xi_1 q_1)...exp(xi_i-1 q_i-1)) xi_i.
+    /// @param q joints() joint values.
+    /// @param J the Jacobian. Resized only if it does not have joints() columns.
+    void spatialJacobian(const NumType* q, Jacobian& J) const
+    {
+      spatialJacobian(q, J, 0);
+    }
+
+    /// @brief Spatial Jacobian and the prefix products of the same pass into caller storage.
+    /// @param q joints() joint values.
+    /// @param J the Jacobian. Resized only if it does not have joints() columns.
+    /// @param prefixes joints() transforms, prefixes[i] = exp(xi_1 q_1)...exp(xi_i q_i); may be null.
+    void spatialJacobian(const NumType* q, Jacobian& J, HomogeneousTransform<NumType>* prefixes) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Chain::spatialJacobian", joints());
+      jacobianPass(q, 0, J, 0, prefixes);
+    }
+
+    /// @brief Spatial Jacobian and its time derivative in one pass, into caller storage.
+    ///
+    /// Column i moves with the joints before it, so dJ_i/dt = ad_(V_i-1) J_i, the Lie bracket with
+    /// the spatial velocity V_i-1 = J_1 qd_1 + ... + J_i-1 qd_i-1 of link i - 1; see Twist::ad().
+    /// The velocity product of a task space acceleration is then Jdot*qd.
+    /// @param q, qd joints() joint values and velocities.
+    /// @param J, Jdot the Jacobian and its time derivative. Resized only if they do not have joints() columns.
+    void spatialJacobian(const NumType* q, const NumType* qd, Jacobian& J, Jacobian& Jdot) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Chain::spatialJacobian", joints());
+      if ((size_t)Jdot.cols() != joints())
+      {
+        Jdot.resize(6, joints());
+      }
+      jacobianPass(q, qd, J, &Jdot, 0);
+    }
+
+    /// @brief Time derivative of the spatial Jacobian, see spatialJacobian(q, qd, J, Jdot).
+    /// @throw screws::ScrewException if q or qd do not have joints() values.
+    Jacobian spatialJacobianDerivative(const std::vector<NumType>& q, const std::vector<NumType>& qd) const
+    {
+      checkSize(q);
+      checkSize(qd);
+      Jacobian J(6, joints()), Jdot(6, joints());
+      spatialJacobian(q.empty() ? 0 : &q[0], qd.empty() ? 0 : &qd[0], J, Jdot);
+
+      return Jdot;
+    }
+
+    /// @brief Spatial Jacobian.
+    /// @throw screws::ScrewException if q does not have joints() values.
+    Jacobian spatialJacobian(const std::vector<NumType>& q) const
+    {
+      checkSize(q);
+      Jacobian J(6, joints());
+      spatialJacobian(q.empty() ? 0 : &q[0], J);
+
+      return J;
+    }
+
+  protected:
+
+    typedef Eigen::Matrix<NumType, 3, 3> Matrix3;
+    typedef Eigen::Matrix<NumType, 3, 1> Vector3;
+    typedef Eigen::Matrix<NumType, 6, 1> Vector6;
+
+    // Constants of the exponential of a joint twist scaled to |w| = 1: the axis w, a = w x v and
+    // b = (w.v) w, and the scale |w|. A prismatic joint has scale 0, w = 0 and a = v.
+    struct JointConstants
+    {
+      Vector3 w;
+      Vector3 a;
+      Vector3 b;
+      NumType scale;
+    };
+
+    // (R, p) = (R, p)*H
+    static void accumulate(const HomogeneousTransform<NumType>& H, Matrix3& R, Vector3& p)
+    {
+      p += R*H.translation().vector();
+      R = R*H.rotation().matrix();
+    }
+
+    // (R, p) = (R, p)*exp(xi_i q_i), with E = c 1 + s w^ + (1 - c) w w^T and t = (1 - E) a + b q'
+    // for the scaled angle q' (Murray, Li and Sastry, eq. 2.36).
+    void accumulateJoint(const size_t& i, const NumType& qi, Matrix3& R, Vector3& p) const
+    {
+      const JointConstants& k = _constants[i];
+      if (k.scale == 0)
+      {
+        p.noalias() += R*(k.a*qi);
+        return;
+      }
+      const NumType theta = k.scale*qi;
+      NumType s, c;
+      MathPolicy<NumType>::sinCos(theta, s, c);
+      const NumType x = k.w(0), y = k.w(1), z = k.w(2), d = 1 - c;
+      Matrix3 E;
+      E << c + d*x*x, d*x*y - s*z, d*x*z + s*y,
+           d*x*y + s*z, c + d*y*y, d*y*z - s*x,
+           d*x*z - s*y, d*y*z + s*x, c + d*z*z;
+      const Vector3 t = k.a - E*k.a + k.b*theta;
+      p.noalias() += R*t;
+      R = R*E;
+    }
+
+    // The Jacobian pass; Jdot (with qd) and prefixes are optional and sized by the caller.
+    void jacobianPass(const NumType* q, const NumType* qd, Jacobian& J, Jacobian* Jdot,
+                      HomogeneousTransform<NumType>* prefixes) const
+    {
+      if ((size_t)J.cols() != joints())
+      {
+        J.resize(6, joints());
+      }
+
+      Matrix3 R = Matrix3::Identity();
+      Vector3 p = Vector3::Zero();
+      // Spatial velocity (v; w) of the links before joint i.
+      Vector3 v = Vector3::Zero(), w = Vector3::Zero();
+      for (size_t i = 0; i < joints(); ++i)
+      {
+        // Ad(R, p) (v; w) = (R v + p x R w; R w)
+        const Vector6& xi = _coordinates[i];
+        const Vector3 wi = R*xi.template tail<3>();
+        const Vector3 vi = R*xi.template head<3>() + p.cross(wi);
+        J.col(i).template head<3>() = vi;
+        J.col(i).template tail<3>() = wi;
+        if (Jdot)
+        {
+          // ad_V J_i = (w x v_i + v x w_i; w x w_i)
+          Jdot->col(i).template head<3>() = w.cross(vi) + v.cross(wi);
+          Jdot->col(i).template tail<3>() = w.cross(wi);
+          v += vi*qd[i];
+          w += wi*qd[i];
+        }
+        accumulateJoint(i, q[i], R, p);
+        if (prefixes)
+        {
+          prefixes[i].setUnchecked(R, p);
+        }
+      }
+    }
+
+    void checkSize(const std::vector<NumType>& q) const
+    {
+      if (q.size() != joints())
+      {
+        ScrewException e("Number of joint values differs from the number of joints.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+    }
+
+    // Joint twists, and their coordinates for the Jacobian.
+    std::vector< Twist<NumType> > _twists;
+    std::vector< Vector6, Eigen::aligned_allocator<Vector6> > _coordinates;
+    std::vector<JointConstants> _constants;
+    // Tool frame at q = 0.
+    HomogeneousTransform<NumType> _home;
+  };
+
+  // Convenience names
+  using Chaind = Chain < double >;
+  using Chainf = Chain < float >;
+};
+
+#endif // CHAIN_HPP
@@ -0,0 +1,578 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CONCENTRICTUBEROBOT_HPP
+#define CONCENTRICTUBEROBOT_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "adjoint.hpp"
+#include "fastMath.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace screws
+{
+  /*!
+   * \class ConcentricTubeRobot
+   * \ingroup libScrews
+   * \brief Forward kinematics of a concentric tube robot with torsionally compliant, precurved tubes.
+   *
+   * Tube i has length L_i, of which the distal part of length Lc_i is precurved with curvature
+   * kappa_i about its x axis, and is rotated by alpha_i and translated by beta_i <= 0 at its base,
+   * so that it spans s in [beta_i, beta_i + L_i] along the backbone; s < 0 is held straight. With
+   * the tube angles psi_i about the z axis of a torsion-free backbone frame, the backbone curvature
+   * is the stiffness weighted sum of the rotated tube curvatures and, with no external loads,
+   * psi_i'' = (k_b,i kappa_i/k_t,i) sum_j w_j sin(psi_i - psi_j), w_j = k_b,j kappa_j/sum k_b
+   * (Dupont, Lock, Itkowitz and Butler, IEEE T-RO 2010; Rucker, Jones and Webster, IEEE T-RO 2010).
+   * The twist rates psi_i'(0) are found by shooting so that each tube is torsion free at its tip,
+   * with psi_i(0) = alpha_i - beta_i psi_i'(0), as the straight transmission of length -beta_i
+   * twists at the same rate, and the backbone frame follows the curvature twist (e3; u_x, u_y, 0)
+   * by Twist::exp steps as in CosseratRod.
+   *
+   * The tube constants (bending stiffness and torsion gain k_b kappa/k_t) are formed in addTube().
+   * The transition points, where a tube ends or its precurvature starts, are formed when the
+   * translations change, with the weights w_j of each section: the curvature twist of a section is
+   * e3 plus the weighted tube curvatures rotated by psi_j. update() then only redoes the actuation
+   * dependent parts. After a converged update, a rotation change is predicted from the shooting
+   * sensitivities to the rotations, so e.g. a teleoperation loop that turns one tube converges in
+   * about one Newton iteration. update() allocates only when the translations change; use one
+   * robot per thread.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT ConcentricTubeRobot
+  {
+  public:
+    typedef Eigen::Matrix<NumType, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Matrix<NumType, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+
+    /// @brief A robot with no tubes.
+    /// @param maxStep the largest integration step along the backbone.
+    /// @throw screws::ScrewException for a non-positive step.
+    explicit ConcentricTubeRobot(const NumType& maxStep = (NumType)1e-3)
+      : _maxStep(maxStep), _tolerance((NumType)1e-9), _maxIterations(20), _sectionsValid(false), _warm(false),
+        _iterations(0), _residual((NumType)0)
+    {
+      if (!(maxStep > 0))
+      {
+        ScrewException e("Integration step must be positive.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+    }
+
+    /// Default destructor.
+    ~ConcentricTubeRobot()
+    {
+
+    }
+
+    /// @brief Add a tube inside the previous ones, with zero rotation and translation.
+    /// @param length, curvedLength the tube length and the length of its precurved distal part.
+    /// @param curvature the precurvature, about the tube x axis.
+    /// @param youngsModulus, shearModulus the elastic moduli.
+    /// @param outerRadius, innerRadius the radii of the tube section.
+    /// @throw screws::ScrewException for a non-positive length or modulus, a curved part longer than
+    /// the tube, or an inner radius not below the outer.
+    void addTube(const NumType& length, const NumType& curvedLength, const NumType& curvature,
+                 const NumType& youngsModulus, const NumType& shearModulus,
+                 const NumType& outerRadius, const NumType& innerRadius)
+    {
+      if (!(length > 0) || !(curvedLength >= 0) || curvedLength > length || !(youngsModulus > 0) || !(shearModulus > 0))
+      {
+        ScrewException e("Tube lengths and moduli must be positive, with the curved part within the tube.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      if (!(innerRadius >= 0) || !(outerRadius > innerRadius))
+      {
+        ScrewException e("Inner radius must be non-negative and below the outer radius.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      TubeConstants t;
+      t.length = length;
+      t.curvedLength = curvedLength;
+      t.curvature = curvature;
+      // k_b = E I and k_t = G J = 2 G I.
+      const NumType I = NumericTraits<NumType>::pi()/4*(outerRadius*outerRadius*outerRadius*outerRadius - innerRadius*innerRadius*innerRadius*innerRadius);
+      t.bending = youngsModulus*I;
+      t.gain = youngsModulus*curvature/(2*shearModulus);
+      _tubes.push_back(t);
+
+      const size_t n = _tubes.size();
+      _alpha.conservativeResize(n);
+      _beta.conservativeResize(n);
+      _alpha(n - 1) = 0;
+      _beta(n - 1) = 0;
+      _lastAlpha = _alpha;
+      _c = Vector::Zero(n);
+      _r.resize(n);
+      _step.resize(n);
+      _delta.resize(n);
+      _x.resize(2*n);
+      for (int k = 0; k < 4; ++k)
+      {
+        _k[k].resize(2*n);
+        _K[k].resize(2*n, 2*n);
+      }
+      _stage.resize(2*n);
+      _Phi.resize(2*n, 2*n);
+      _PhiStage.resize(2*n, 2*n);
+      _A.resize(2*n, 2*n);
+      _Jc.resize(n, n);
+      _Jalpha.resize(n, n);
+      _lu = Eigen::PartialPivLU<Matrix>(n);
+      _lastLu = Eigen::PartialPivLU<Matrix>(n);
+      _sectionsValid = false;
+      _warm = false;
+    }
+
+    /// @return the number of tubes.
+    size_t tubes() const
+    {
+      return _tubes.size();
+    }
+
+    /// @brief Rotate tube i at its base.
+    /// @throw screws::ScrewException for a tube index out of range.
+    void setRotation(const size_t& i, const NumType& alpha)
+    {
+      checkTube(i);
+      _alpha(i) = alpha;
+    }
+
+    /// @brief Translate tube i, so that its base is at s = beta along the backbone.
+    /// @throw screws::ScrewException for a tube index out of range or a positive translation.
+    void setTranslation(const size_t& i, const NumType& beta)
+    {
+      checkTube(i);
+      if (beta > 0)
+      {
+        ScrewException e("Tube bases must be at or behind the base frame.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      if (beta != _beta(i))
+      {
+        _beta(i) = beta;
+        _sectionsValid = false;
+      }
+    }
+
+    /// @return the rotation of tube i.
+    NumType rotation(const size_t& i) const
+    {
+      checkTube(i);
+      return _alpha(i);
+    }
+
+    /// @return the translation of tube i.
+    NumType translation(const size_t& i) const
+    {
+      checkTube(i);
+      return _beta(i);
+    }
+
+    /// @brief Set the convergence tolerance of the tip twist rates [default: 1e-9], and the Newton
+    /// iteration limit [default: 20].
+    void setTolerance(const NumType& tolerance, const size_t& maxIterations = 20)
+    {
+      _tolerance = tolerance;
+      _maxIterations = maxIterations;
+    }
+
+    /// @brief Start the next update from untwisted tubes rather than the last solution.
+    void reset()
+    {
+      _warm = false;
+    }
+
+    /// @brief Solve the tube torsion for the current actuation and integrate the backbone.
+    /// @return true if every tube tip is torsion free to the tolerance.
+    /// @throw screws::ScrewException if there are no tubes.
+    bool update()
+    {
+      SCREWS_TRACE_SCOPE_SIZE("ConcentricTubeRobot::update", _tubes.size());
+      if (_tubes.empty())
+      {
+        ScrewException e("The robot has no tubes.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      const bool translated = !_sectionsValid;
+      if (translated)
+      {
+        buildSections();
+      }
+      if (!_warm)
+      {
+        _c.setZero();
+      }
+      else if (!translated)
+      {
+        // First order prediction from the last solution: dc = -Jc^-1 J_alpha dalpha.
+        _delta = _alpha - _lastAlpha;
+        if (_delta.cwiseAbs().maxCoeff() > 0)
+        {
+          _r.noalias() = _Jalpha*_delta;
+          _step = _lastLu.solve(_r);
+          _c -= _step;
+        }
+      }
+
+      NumType norm = shoot(_c);
+      for (size_t it = 0; ; ++it)
+      {
+        if (norm < _tolerance)
+        {
+          _iterations = it;
+          _residual = norm;
+          _lastAlpha = _alpha;
+          _lastLu.compute(_Jc);
+          _warm = true;
+          return true;
+        }
+        if (it == _maxIterations)
+        {
+          break;
+        }
+        // Newton step on the base twist rates, halved while the residual grows.
+        _lu.compute(_Jc);
+        _step = _lu.solve(_r);
+        NumType scale = 1;
+        for (int b = 0; b < 8; ++b)
+        {
+          _delta = _c - _step*scale;
+          const NumType trialNorm = shoot(_delta);
+          if (trialNorm < norm || b == 7)
+          {
+            _c = _delta;
+            norm = trialNorm;
+            break;
+          }
+          scale /= 2;
+        }
+      }
+      _iterations = _maxIterations;
+      _residual = norm;
+      _warm = false;
+
+      return false;
+    }
+
+    /// @return the tip frame of the last update.
+    const HomogeneousTransform<NumType>& tipPose() const
+    {
+      return _backbone.back();
+    }
+
+    /// @return the backbone frames of the last update, at arcLength(k); node 0 is the base frame.
+    const std::vector< HomogeneousTransform<NumType> >& backbone() const
+    {
+      return _backbone;
+    }
+
+    /// @return the arc length of backbone node k.
+    const NumType& arcLength(const size_t& k) const
+    {
+      return _arcLength[k];
+    }
+
+    /// @return the angle psi of tube i about the backbone z axis at node k.
+    NumType tubeAngle(const size_t& i, const size_t& k) const
+    {
+      return _states(i, k);
+    }
+
+    /// @return the twist rate psi' of tube i at node k; zero past its tip.
+    NumType tubeTwistRate(const size_t& i, const size_t& k) const
+    {
+      return _states(_tubes.size() + i, k);
+    }
+
+    /// @return the Newton iterations of the last update.
+    size_t iterations() const
+    {
+      return _iterations;
+    }
+
+    /// @return the largest tip twist rate of the last update.
+    const NumType& residual() const
+    {
+      return _residual;
+    }
+
+  protected:
+
+    struct TubeConstants
+    {
+      NumType length;
+      NumType curvedLength;
+      NumType curvature;
+      // k_b = E I, and k_b kappa/k_t.
+      NumType bending;
+      NumType gain;
+    };
+
+    // The backbone between two transition points: the present tubes, the curvature weights
+    // k_b,j kappa_j/sum k_b of the present curved tubes and their torsion gains.
+    struct Section
+    {
+      NumType begin;
+      NumType end;
+      size_t steps;
+      Vector present;
+      Vector weight;
+      Vector gain;
+    };
+
+    void checkTube(const size_t& i) const
+    {
+      if (i >= _tubes.size())
+      {
+        ScrewException e("Tube index out of range.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+    }
+
+    // The transition points 0, beta_i + L_i - Lc_i and beta_i + L_i within the backbone, and the
+    // sections between them.
+    void buildSections()
+    {
+      const size_t n = _tubes.size();
+      std::vector<NumType> points(1, (NumType)0);
+      NumType tip = 0;
+      for (size_t i = 0; i < n; ++i)
+      {
+        const NumType end = _beta(i) + _tubes[i].length;
+        points.push_back(end - _tubes[i].curvedLength);
+        points.push_back(end);
+        tip = std::max(tip, end);
+      }
+      std::sort(points.begin(), points.end());
+
+      _sections.clear();
+      size_t nodes = 1;
+      for (size_t p = 1; p < points.size(); ++p)
+      {
+        const NumType begin = std::max(points[p - 1], (NumType)0), end = std::min(points[p], tip);
+        if (!(end > begin))
+        {
+          continue;
+        }
+        Section section;
+        section.begin = begin;
+        section.end = end;
+        section.present = Vector::Zero(n);
+        section.weight = Vector::Zero(n);
+        section.gain = Vector::Zero(n);
+        const NumType middle = (begin + end)/2;
+        NumType stiffness = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+          const NumType tubeEnd = _beta(i) + _tubes[i].length;
+          if (middle < tubeEnd)
+          {
+            section.present(i) = 1;
+            stiffness += _tubes[i].bending;
+            if (middle > tubeEnd - _tubes[i].curvedLength && _tubes[i].curvature != 0)
+            {
+              section.weight(i) = _tubes[i].bending*_tubes[i].curvature;
+              section.gain(i) = _tubes[i].gain;
+            }
+          }
+        }
+        section.weight /= stiffness;
+        // Straight sections are one exact step.
+        section.steps = (section.weight.cwiseAbs().maxCoeff() == 0) ? 1 : (size_t)std::ceil((end - begin)/_maxStep);
+        nodes += section.steps;
+        _sections.push_back(section);
+      }
+
+      _backbone.resize(nodes);
+      _arcLength.resize(nodes);
+      _states.resize(2*n, nodes);
+      _sectionsValid = true;
+    }
+
+    // x = (psi, psi'): psi_i' for present tubes, psi_i'' = gain_i sum_j w_j sin(psi_i - psi_j), and the
+    // derivative A = d(dx)/dx.
+    void derivative(const Section& section, const Vector& x, Vector& dx, Matrix& A) const
+    {
+      const size_t n = _tubes.size();
+      A.setZero();
+      for (size_t i = 0; i < n; ++i)
+      {
+        dx(i) = section.present(i)*x(n + i);
+        A(i, n + i) = section.present(i);
+        NumType torque = 0;
+        if (section.gain(i) != 0)
+        {
+          for (size_t j = 0; j < n; ++j)
+          {
+            if (j == i || section.weight(j) == 0)
+            {
+              continue;
+            }
+            NumType s, c;
+            MathPolicy<NumType>::sinCos(x(i) - x(j), s, c);
+            torque += section.weight(j)*s;
+            const NumType a = section.gain(i)*section.weight(j)*c;
+            A(n + i, i) += a;
+            A(n + i, j) -= a;
+          }
+        }
+        dx(n + i) = section.gain(i)*torque;
+      }
+    }
+
+    // Backbone curvature twist (e3; u_x, u_y, 0), u = sum_j w_j (cos psi_j, sin psi_j).
+    Eigen::Matrix<NumType, 6, 1> curvatureTwist(const Section& section, const Vector& x) const
+    {
+      Eigen::Matrix<NumType, 6, 1> xi = Eigen::Matrix<NumType, 6, 1>::Zero();
+      xi(2) = 1;
+      for (size_t j = 0; j < _tubes.size(); ++j)
+      {
+        if (section.weight(j) != 0)
+        {
+          NumType s, c;
+          MathPolicy<NumType>::sinCos(x(j), s, c);
+          xi(3) += section.weight(j)*c;
+          xi(4) += section.weight(j)*s;
+        }
+      }
+
+      return xi;
+    }
+
+    // One RK4 step of the torsion and of Phi = dx/d(c, alpha).
+    void rungeKutta(const Section& section, Vector& x, Matrix& Phi, const NumType& h)
+    {
+      derivative(section, x, _k[0], _A);
+      _K[0].noalias() = _A*Phi;
+      for (int k = 1; k < 4; ++k)
+      {
+        const NumType f = (k == 3) ? h : h/2;
+        _stage = x + _k[k - 1]*f;
+        _PhiStage = Phi + _K[k - 1]*f;
+        derivative(section, _stage, _k[k], _A);
+        _K[k].noalias() = _A*_PhiStage;
+      }
+      x += (_k[0] + (_k[1] + _k[2])*(NumType)2 + _k[3])*(h/6);
+      Phi += (_K[0] + (_K[1] + _K[2])*(NumType)2 + _K[3])*(h/6);
+    }
+
+    // Integrates from the base twist rates c: the backbone and tube states into the node storage,
+    // r = psi'(tips) and its derivatives Jc and J_alpha. Returns the largest element of r.
+    NumType shoot(const Vector& c)
+    {
+      const size_t n = _tubes.size();
+      // psi(0) = alpha - beta psi'(0), psi'(0) = c.
+      _x.head(n) = _alpha - _beta.cwiseProduct(c);
+      _x.tail(n) = c;
+      _Phi.setZero();
+      for (size_t i = 0; i < n; ++i)
+      {
+        _Phi(i, i) = -_beta(i);
+        _Phi(n + i, i) = 1;
+        _Phi(i, n + i) = 1;
+      }
+      _backbone[0] = HomogeneousTransform<NumType>();
+      _arcLength[0] = 0;
+      _states.col(0) = _x;
+
+      size_t node = 0;
+      Eigen::Matrix<NumType, 6, 1> x0, xh, x1, bracket, omega;
+      for (size_t k = 0; k < _sections.size(); ++k)
+      {
+        const Section& section = _sections[k];
+        const NumType h = (section.end - section.begin)/(NumType)section.steps;
+        for (size_t step = 0; step < section.steps; ++step, ++node)
+        {
+          x0 = curvatureTwist(section, _x);
+          rungeKutta(section, _x, _Phi, h/2);
+          xh = curvatureTwist(section, _x);
+          rungeKutta(section, _x, _Phi, h/2);
+          x1 = curvatureTwist(section, _x);
+
+          // Omega = h/6 (x0 + 4 xh + x1) + h^2/12 [x0, x1], as in CosseratRod.
+          Adjoint<NumType>::ad(x0, x1, bracket);
+          omega = (x0 + xh*(NumType)4 + x1)*(h/6) + bracket*(h*h/12);
+          const HomogeneousTransform<NumType> E = Twist<NumType>(omega(0), omega(1), omega(2), omega(3), omega(4), omega(5)).exp();
+          HomogeneousTransform<NumType>::mulInto(_backbone[node + 1], _backbone[node], E);
+          _arcLength[node + 1] = section.begin + h*(NumType)(step + 1);
+          _states.col(node + 1) = _x;
+        }
+      }
+
+      _r = _x.tail(n);
+      _Jc = _Phi.bottomLeftCorner(n, n);
+      _Jalpha = _Phi.bottomRightCorner(n, n);
+
+      return _r.cwiseAbs().maxCoeff();
+    }
+
+    std::vector<TubeConstants> _tubes;
+    NumType _maxStep;
+    NumType _tolerance;
+    size_t _maxIterations;
+
+    // Actuation, and the rotations of the last converged update.
+    Vector _alpha;
+    Vector _beta;
+    Vector _lastAlpha;
+
+    // Transition points and node storage, rebuilt when the translations change.
+    std::vector<Section> _sections;
+    bool _sectionsValid;
+    std::vector< HomogeneousTransform<NumType> > _backbone;
+    std::vector<NumType> _arcLength;
+    Matrix _states;
+
+    // Shooting state: the base twist rates, the residual and its derivatives.
+    Vector _c;
+    Vector _r;
+    Vector _step;
+    Vector _delta;
+    Matrix _Jc;
+    Matrix _Jalpha;
+    Eigen::PartialPivLU<Matrix> _lu;
+    Eigen::PartialPivLU<Matrix> _lastLu;
+    bool _warm;
+    size_t _iterations;
+    NumType _residual;
+
+    // Integration storage.
+    Vector _x;
+    Vector _k[4];
+    Vector _stage;
+    Matrix _K[4];
+    Matrix _Phi;
+    Matrix _PhiStage;
+    Matrix _A;
+  };
+
+  // Convenience names
+  using ConcentricTubeRobotd = ConcentricTubeRobot < double >;
+  using ConcentricTubeRobotf = ConcentricTubeRobot < float >;
+};
+
+#endif // CONCENTRICTUBEROBOT_HPP
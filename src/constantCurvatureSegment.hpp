@@ -0,0 +1,297 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSTANTCURVATURESEGMENT_HPP
+#define CONSTANTCURVATURESEGMENT_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "fastMath.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <cmath>
+
+namespace screws
+{
+  /*!
+   * \class ConstantCurvatureSegment
+   * \ingroup libScrews
+   * \brief A circular arc of a continuum robot, of curvature kappa and length l, bent in the plane at angle phi about the base z axis.
+   *
+   * The arc is the exponential of the twist (e3; kappa (-sin phi, cos phi, 0)) over its length, which
+   * equals Rz(phi) [Ry(kappa l), p] Rz(-phi) with p = ((1 - cos kappa l)/kappa, 0, sin(kappa l)/kappa)
+   * (Webster and Jones, IJRR 2010). transform() forms it in closed form, with one sine and cosine per
+   * angle, and stays exact as kappa goes to zero. The Jacobians are in closed form too, with columns
+   * for (kappa, phi, l). Segments of a multi-segment robot compose with the HomogeneousTransform
+   * products, or with compose() and the robot spatialJacobian().
+   */
+  template<class NumType>
+  class SCREWS_EXPORT ConstantCurvatureSegment
+  {
+  public:
+    /// @brief 6x3 Jacobian, columns for (kappa, phi, l).
+    typedef Eigen::Matrix<NumType, 6, 3> Jacobian;
+    /// @brief 6x3n Jacobian of n segments.
+    typedef Eigen::Matrix<NumType, 6, Eigen::Dynamic> RobotJacobian;
+
+    /// @brief Create a segment.
+    /// @param curvature kappa, in inverse units of length.
+    /// @param bendingPlane phi, the angle of the bending plane about the base z axis.
+    /// @param length l, the arc length.
+    /// @throw screws::ScrewException for a negative length.
+    explicit ConstantCurvatureSegment(const NumType& curvature = (NumType)0, const NumType& bendingPlane = (NumType)0,
+                                      const NumType& length = (NumType)0)
+    {
+      set(curvature, bendingPlane, length);
+    }
+
+    /// Default destructor.
+    ~ConstantCurvatureSegment()
+    {
+
+    }
+
+    /// @brief Change the arc parameters.
+    /// @throw screws::ScrewException for a negative length.
+    void set(const NumType& curvature, const NumType& bendingPlane, const NumType& length)
+    {
+      if (!(length >= 0))
+      {
+        ScrewException e("Segment length must be non-negative.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      _curvature = curvature;
+      _bendingPlane = bendingPlane;
+      _length = length;
+    }
+
+    /// @return kappa.
+    const NumType& curvature() const
+    {
+      return _curvature;
+    }
+
+    /// @return phi.
+    const NumType& bendingPlane() const
+    {
+      return _bendingPlane;
+    }
+
+    /// @return l.
+    const NumType& length() const
+    {
+      return _length;
+    }
+
+    /// @return the twist per unit arc length, so that twist().exp(length()) equals transform().
+    Twist<NumType> twist() const
+    {
+      NumType s, c;
+      MathPolicy<NumType>::sinCos(_bendingPlane, s, c);
+      return Twist<NumType>(0, 0, 1, -_curvature*s, _curvature*c, 0);
+    }
+
+    /// @return the tip frame in the base frame.
+    HomogeneousTransform<NumType> transform() const
+    {
+      return transform(_length);
+    }
+
+    /// @return the frame at arc length s in the base frame, e.g. to sample the backbone.
+    HomogeneousTransform<NumType> transform(const NumType& s) const
+    {
+      HomogeneousTransform<NumType> g;
+      Eigen::Matrix<NumType, 3, 3> R;
+      Eigen::Matrix<NumType, 3, 1> p;
+      Arc a(_curvature, _bendingPlane, s);
+      a.fill(R, p);
+      g.setUnchecked(R, p);
+
+      return g;
+    }
+
+    /// @brief Tip frames of n segments, for sampling the arc parameters.
+    /// @param curvature, bendingPlane, length n values each.
+    /// @param n the number of segments.
+    /// @param out n tip frames.
+    static void transform(const NumType* curvature, const NumType* bendingPlane, const NumType* length,
+                          const size_t& n, HomogeneousTransform<NumType>* out)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("ConstantCurvatureSegment::transform batch", n);
+      Eigen::Matrix<NumType, 3, 3> R;
+      Eigen::Matrix<NumType, 3, 1> p;
+      for (size_t i = 0; i < n; ++i)
+      {
+        Arc a(curvature[i], bendingPlane[i], length[i]);
+        a.fill(R, p);
+        out[i].setUnchecked(R, p);
+      }
+    }
+
+    /// @brief Body Jacobian: g^-1 dg = (J_b (dkappa, dphi, dl))^, in the tip frame.
+    Jacobian bodyJacobian() const
+    {
+      Jacobian J;
+      Arc a(_curvature, _bendingPlane, _length);
+      a.bodyJacobian(_curvature, _length, J);
+
+      return J;
+    }
+
+    /// @brief Spatial Jacobian: dg g^-1 = (J_s (dkappa, dphi, dl))^, in the base frame; J_s = Ad_g J_b.
+    Jacobian spatialJacobian() const
+    {
+      Jacobian J;
+      Arc a(_curvature, _bendingPlane, _length);
+      a.bodyJacobian(_curvature, _length, J);
+      Eigen::Matrix<NumType, 3, 3> R;
+      Eigen::Matrix<NumType, 3, 1> p;
+      a.fill(R, p);
+      changeFrame(R, p, J);
+
+      return J;
+    }
+
+    /// @brief Tip frame of segments mounted one on the tip of the other.
+    /// @param segments n segments, from the base outwards.
+    static HomogeneousTransform<NumType> compose(const ConstantCurvatureSegment<NumType>* segments, const size_t& n)
+    {
+      Eigen::Matrix<NumType, 3, 3> R = Eigen::Matrix<NumType, 3, 3>::Identity();
+      Eigen::Matrix<NumType, 3, 1> p = Eigen::Matrix<NumType, 3, 1>::Zero();
+      Eigen::Matrix<NumType, 3, 3> E;
+      Eigen::Matrix<NumType, 3, 1> t;
+      for (size_t i = 0; i < n; ++i)
+      {
+        Arc a(segments[i]._curvature, segments[i]._bendingPlane, segments[i]._length);
+        a.fill(E, t);
+        p.noalias() += R*t;
+        R = R*E;
+      }
+      HomogeneousTransform<NumType> g;
+      g.setUnchecked(R, p);
+
+      return g;
+    }
+
+    /// @brief Spatial Jacobian of segments mounted one on the tip of the other, in the base frame of the first.
+    /// @param segments n segments, from the base outwards.
+    /// @param J columns 3i, 3i + 1 and 3i + 2 for (kappa_i, phi_i, l_i); resized to 6x3n if needed.
+    static void spatialJacobian(const ConstantCurvatureSegment<NumType>* segments, const size_t& n, RobotJacobian& J)
+    {
+      if ((size_t)J.cols() != 3*n)
+      {
+        J.resize(6, 3*n);
+      }
+      Eigen::Matrix<NumType, 3, 3> R = Eigen::Matrix<NumType, 3, 3>::Identity(), E;
+      Eigen::Matrix<NumType, 3, 1> p = Eigen::Matrix<NumType, 3, 1>::Zero(), t;
+      Jacobian Ji;
+      for (size_t i = 0; i < n; ++i)
+      {
+        // The body columns of segment i move with the frame at its tip.
+        Arc a(segments[i]._curvature, segments[i]._bendingPlane, segments[i]._length);
+        a.fill(E, t);
+        p.noalias() += R*t;
+        R = R*E;
+        a.bodyJacobian(segments[i]._curvature, segments[i]._length, Ji);
+        changeFrame(R, p, Ji);
+        J.template middleCols<3>(3*i) = Ji;
+      }
+    }
+
+  protected:
+
+    // Sines and cosines of phi and theta = kappa l, with the arc functions sin(theta)/theta,
+    // (1 - cos theta)/theta, (1 - cos theta)/theta^2 and (theta - sin theta)/theta^2, by series near 0.
+    struct Arc
+    {
+      Arc(const NumType& curvature, const NumType& bendingPlane, const NumType& length)
+        : l(length)
+      {
+        MathPolicy<NumType>::sinCos(bendingPlane, s, c);
+        const NumType theta = curvature*length;
+        MathPolicy<NumType>::sinCos(theta, S, C);
+        if (std::abs(theta) < (NumType)1e-2)
+        {
+          const NumType t2 = theta*theta;
+          sinc = 1 - t2/6*(1 - t2/20);
+          versine2 = (1 - t2/12*(1 - t2/30))/2;
+          versine = theta*versine2;
+          cubic = theta/6*(1 - t2/20*(1 - t2/42));
+        }
+        else
+        {
+          sinc = S/theta;
+          versine = (1 - C)/theta;
+          versine2 = versine/theta;
+          cubic = (theta - S)/(theta*theta);
+        }
+      }
+
+      // R = Rz(phi) Ry(theta) Rz(-phi), p = l (versine c, versine s, sinc)
+      void fill(Eigen::Matrix<NumType, 3, 3>& R, Eigen::Matrix<NumType, 3, 1>& p) const
+      {
+        const NumType d = 1 - C;
+        R << 1 - d*c*c, -d*c*s, c*S,
+             -d*c*s, 1 - d*s*s, s*S,
+             -c*S, -s*S, C;
+        p << l*versine*c, l*versine*s, l*sinc;
+      }
+
+      // Columns (kappa, phi, l): (l^2 (versine2 c, versine2 s, cubic); l (-s, c, 0)),
+      // (l versine (-s, c, 0); (-c S, -s S, C - 1)) and ((0, 0, 1); kappa (-s, c, 0)).
+      void bodyJacobian(const NumType& curvature, const NumType& length, Jacobian& J) const
+      {
+        const NumType l2 = length*length;
+        J << l2*versine2*c, -length*versine*s, 0,
+             l2*versine2*s, length*versine*c, 0,
+             l2*cubic, 0, 1,
+             -length*s, -c*S, -curvature*s,
+             length*c, -s*S, curvature*c,
+             0, C - 1, 0;
+      }
+
+      NumType l, s, c, S, C, sinc, versine, versine2, cubic;
+    };
+
+    // J = Ad_(R, p) J: (R v + p x R w; R w) for each column.
+    static void changeFrame(const Eigen::Matrix<NumType, 3, 3>& R, const Eigen::Matrix<NumType, 3, 1>& p, Jacobian& J)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        const Eigen::Matrix<NumType, 3, 1> w = R*J.col(i).template tail<3>();
+        const Eigen::Matrix<NumType, 3, 1> v = R*J.col(i).template head<3>() + p.cross(w);
+        J.col(i).template head<3>() = v;
+        J.col(i).template tail<3>() = w;
+      }
+    }
+
+    NumType _curvature;
+    NumType _bendingPlane;
+    NumType _length;
+  };
+
+  // Convenience names
+  using ConstantCurvatureSegmentd = ConstantCurvatureSegment < double >;
+  using ConstantCurvatureSegmentf = ConstantCurvatureSegment < float >;
+};
+
+#endif // CONSTANTCURVATURESEGMENT_HPP
@@ -0,0 +1,547 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef COSSERATROD_HPP
+#define COSSERATROD_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <cmath>
+
+namespace screws
+{
+  /*!
+   * \class CosseratRod
+   * \ingroup libScrews
+   * \brief Static Cosserat rod of circular (tube) section, clamped at a base pose and loaded by a wrench at the tip.
+   *
+   * Along the arc length s the rod frame g(s) moves with the body strain twist xi = (v; u),
+   * g' = g xi^, and the internal force and moment (n; m) in the rod frame satisfy
+   * n' = -u x n, m' = -u x m - v x n (Rucker and Webster, IEEE T-RO 2011, without distributed
+   * loads). The linear elastic law is n = Kse (v - e3) and m = Kbt (u - u*), with u* the
+   * precurvature. Each of the steps() steps advances (n; m) with two RK4 half steps and the frame
+   * with one Twist::exp of the fourth order Magnus twist h/6 (xi_0 + 4 xi_1/2 + xi_1) + h^2/12 [xi_0, xi_1].
+   *
+   * solve() shoots on the unknown base wrench, (n; m)(0), so that the tip wrench matches the load.
+   * The Jacobian of the tip residual is integrated with the shape, from the linearised equations and
+   * the derivative of the Magnus step, so each Newton iteration costs one integration. A Workspace
+   * holds the shape and the last solution, which starts the next solve: neighbouring samples of a
+   * planner converge in one or two iterations. The batch solve() spreads samples over one thread per
+   * workspace.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT CosseratRod
+  {
+  public:
+    typedef Eigen::Matrix<NumType, 6, 1> Coordinates;
+    typedef Eigen::Matrix<NumType, 6, 6> Matrix6;
+    typedef std::vector< Coordinates, Eigen::aligned_allocator<Coordinates> > CoordinatesVector;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /*!
+     * \class Workspace
+     * \brief Per-solve storage, reused across solves: the shape of the last solve and its base wrench,
+     * which is the initial guess of the next one.
+     */
+    class Workspace
+    {
+    public:
+      template<class NumTypeRod> friend class CosseratRod;
+
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+      /// @brief Storage for a rod with the given number of steps.
+      explicit Workspace(const size_t& steps = 0)
+        : _guess(Coordinates::Zero()), _warm(false), _iterations(0), _residual((NumType)0)
+      {
+        resize(steps);
+      }
+
+      /// @brief Change the number of steps; allocates, and forgets the last solution.
+      void resize(const size_t& steps)
+      {
+        _poses.resize(steps + 1);
+        _wrenches.resize(steps + 1);
+        _warm = false;
+      }
+
+      /// @return the number of steps the storage is for.
+      size_t steps() const
+      {
+        return _poses.size() - 1;
+      }
+
+      /// @return the rod frame at node k, at arc length k*length()/steps(); node 0 is the base.
+      const HomogeneousTransform<NumType>& pose(const size_t& k) const
+      {
+        assert(k < _poses.size());
+        return _poses[k];
+      }
+
+      /// @return the rod frame at the tip.
+      const HomogeneousTransform<NumType>& tipPose() const
+      {
+        return _poses.back();
+      }
+
+      /// @return the internal force and moment (n; m) at node k, in the rod frame at k.
+      Wrench<NumType> internalWrench(const size_t& k) const
+      {
+        assert(k < _wrenches.size());
+        const Coordinates& w = _wrenches[k];
+        return Wrench<NumType>(w(0), w(1), w(2), w(3), w(4), w(5));
+      }
+
+      /// @return the Newton iterations of the last solve.
+      size_t iterations() const
+      {
+        return _iterations;
+      }
+
+      /// @return the largest tip residual of the last solve, forces and moments over the rod length.
+      const NumType& residual() const
+      {
+        return _residual;
+      }
+
+      /// @brief Start the next solve from the unloaded straight rod rather than the last solution.
+      void reset()
+      {
+        _warm = false;
+      }
+
+    protected:
+      std::vector< HomogeneousTransform<NumType> > _poses;
+      CoordinatesVector _wrenches;
+      // Base wrench of the last converged solve.
+      Coordinates _guess;
+      bool _warm;
+      size_t _iterations;
+      NumType _residual;
+    };
+
+    /// @brief A straight rod of circular section, or a tube.
+    /// @param length the length.
+    /// @param youngsModulus, shearModulus the elastic moduli.
+    /// @param outerRadius, innerRadius the radii of the section; innerRadius = 0 for a solid rod.
+    /// @param steps the integration steps along the rod.
+    /// @throw screws::ScrewException for a non-positive length, modulus or step count, or if the inner radius is not below the outer.
+    explicit CosseratRod(const NumType& length, const NumType& youngsModulus, const NumType& shearModulus,
+                         const NumType& outerRadius, const NumType& innerRadius = (NumType)0, const size_t& steps = 32)
+      : _length(length), _steps(steps), _precurvature(Eigen::Matrix<NumType, 3, 1>::Zero()),
+        _tolerance((NumType)1e-9), _maxIterations(20)
+    {
+      if (!(length > 0) || !(youngsModulus > 0) || !(shearModulus > 0) || steps == 0)
+      {
+        ScrewException e("Rod length, moduli and steps must be positive.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      if (!(innerRadius >= 0) || !(outerRadius > innerRadius))
+      {
+        ScrewException e("Inner radius must be non-negative and below the outer radius.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      const NumType r2 = outerRadius*outerRadius - innerRadius*innerRadius;
+      const NumType area = NumericTraits<NumType>::pi()*r2;
+      const NumType I = NumericTraits<NumType>::pi()/4*(outerRadius*outerRadius*outerRadius*outerRadius - innerRadius*innerRadius*innerRadius*innerRadius);
+      // Inverse stiffnesses, Kse = diag(GA, GA, EA) and Kbt = diag(EI, EI, 2GI).
+      _shearCompliance << 1/(shearModulus*area), 1/(shearModulus*area), 1/(youngsModulus*area);
+      _bendCompliance << 1/(youngsModulus*I), 1/(youngsModulus*I), 1/(2*shearModulus*I);
+    }
+
+    /// Default destructor.
+    ~CosseratRod()
+    {
+
+    }
+
+    /// @return the length.
+    const NumType& length() const
+    {
+      return _length;
+    }
+
+    /// @return the integration steps.
+    const size_t& steps() const
+    {
+      return _steps;
+    }
+
+    /// @brief Change the integration steps.
+    /// @throw screws::ScrewException for no steps.
+    void setSteps(const size_t& steps)
+    {
+      if (steps == 0)
+      {
+        ScrewException e("Rod length, moduli and steps must be positive.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      _steps = steps;
+    }
+
+    /// @brief Set the precurvature u*, the curvature of the unloaded rod in its frame [default: 0].
+    void setPrecurvature(const Translation<NumType>& u)
+    {
+      _precurvature << u(0), u(1), u(2);
+    }
+
+    /// @return the precurvature.
+    Translation<NumType> precurvature() const
+    {
+      return Translation<NumType>(_precurvature(0), _precurvature(1), _precurvature(2));
+    }
+
+    /// @brief Set the convergence tolerance of the largest tip residual, forces and moments over the
+    /// rod length [default: 1e-9], and the Newton iteration limit [default: 20].
+    void setTolerance(const NumType& tolerance, const size_t& maxIterations = 20)
+    {
+      _tolerance = tolerance;
+      _maxIterations = maxIterations;
+    }
+
+    /// @brief Shape of the rod for a base pose and a tip load, into the workspace.
+    /// @param base the rod frame at s = 0, the rod along its z axis.
+    /// @param tip the force and the moment about the tip, in the frame of the base pose (e.g. the world).
+    /// @param ws the workspace. Resized only if it is not for steps() steps.
+    /// @return true if the tip residual is below the tolerance; the workspace then holds the shape.
+    bool solve(const HomogeneousTransform<NumType>& base, const Wrench<NumType>& tip, Workspace& ws) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("CosseratRod::solve", _steps);
+      if (ws.steps() != _steps)
+      {
+        ws.resize(_steps);
+      }
+      Coordinates W = ws._warm ? ws._guess : straightGuess(base, tip);
+      Coordinates r, step;
+      Matrix6 J;
+      NumType norm = residual(base, tip, W, r, J, ws);
+      for (size_t it = 0; ; ++it)
+      {
+        if (norm < _tolerance)
+        {
+          ws._iterations = it;
+          ws._residual = norm;
+          ws._guess = W;
+          ws._warm = true;
+          return true;
+        }
+        if (it == _maxIterations)
+        {
+          break;
+        }
+        // Newton step, halved while the residual grows.
+        step = J.partialPivLu().solve(r);
+        NumType scale = 1;
+        for (int b = 0; b < 8; ++b)
+        {
+          const Coordinates trial = W - step*scale;
+          const NumType trialNorm = residual(base, tip, trial, r, J, ws);
+          if (trialNorm < norm || b == 7)
+          {
+            W = trial;
+            norm = trialNorm;
+            break;
+          }
+          scale /= 2;
+        }
+      }
+      ws._iterations = _maxIterations;
+      ws._residual = norm;
+      ws._warm = false;
+
+      return false;
+    }
+
+    /// @brief Shapes of many actuation samples, one thread per workspace.
+    /// @param bases, tips count base poses and tip loads, see solve().
+    /// @param count the number of samples.
+    /// @param tipPoses count tip poses.
+    /// @param workspaces one workspace per thread; each solves a contiguous range of samples, warm
+    /// started from the previous sample of its range.
+    /// @return the number of samples that converged.
+    /// @throw screws::ScrewException if there are no workspaces. An exception thrown while solving
+    /// a sample is rethrown once all threads have finished.
+    size_t solve(const HomogeneousTransform<NumType>* bases, const Wrench<NumType>* tips, const size_t& count,
+                 HomogeneousTransform<NumType>* tipPoses, std::vector<Workspace>& workspaces) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("CosseratRod::solve batch", count);
+      if (workspaces.empty())
+      {
+        ScrewException e("At least one workspace is needed.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      const size_t threads = std::min(workspaces.size(), count);
+      std::vector<size_t> converged(threads, 0);
+      // A thread must not let an exception escape, and every thread must be joined before leaving.
+      std::vector<std::exception_ptr> errors(threads);
+      auto range = [&](const size_t t)
+      {
+        try
+        {
+          for (size_t i = count*t/threads; i < count*(t + 1)/threads; ++i)
+          {
+            if (solve(bases[i], tips[i], workspaces[t]))
+            {
+              ++converged[t];
+            }
+            tipPoses[i] = workspaces[t].tipPose();
+          }
+        }
+        catch (...)
+        {
+          errors[t] = std::current_exception();
+        }
+      };
+      std::vector<std::thread> pool;
+      pool.reserve(threads);
+      try
+      {
+        for (size_t t = 1; t < threads; ++t)
+        {
+          pool.push_back(std::thread(range, t));
+        }
+      }
+      catch (...)
+      {
+        for (size_t t = 0; t < pool.size(); ++t)
+        {
+          pool[t].join();
+        }
+        throw;
+      }
+      if (threads > 0)
+      {
+        range(0);
+      }
+      for (size_t t = 0; t < pool.size(); ++t)
+      {
+        pool[t].join();
+      }
+      size_t total = 0;
+      for (size_t t = 0; t < threads; ++t)
+      {
+        if (errors[t])
+        {
+          std::rethrow_exception(errors[t]);
+        }
+        total += converged[t];
+      }
+
+      return total;
+    }
+
+    /// @brief The shooting residual and its Jacobian for a base wrench, e.g. for another solver.
+    /// @param base, tip as for solve().
+    /// @param W the internal force and moment (n; m) at the base, in the base frame.
+    /// @param r the tip residual (n; m)(L) - (R^T f; R^T l), with R the tip rotation.
+    /// @param J dr/dW.
+    /// @param ws the workspace, which receives the shape. Resized only if it is not for steps() steps.
+    /// @return the largest element of r, with the moments over the rod length.
+    NumType residual(const HomogeneousTransform<NumType>& base, const Wrench<NumType>& tip, const Coordinates& W,
+                     Coordinates& r, Matrix6& J, Workspace& ws) const
+    {
+      if (ws.steps() != _steps)
+      {
+        ws.resize(_steps);
+      }
+      Matrix6 eta;
+      shoot(base, W, ws, J, eta);
+
+      // Variations of the tip frame are R eta_w^, so d(R^T f) = (R^T f) x eta_w.
+      const HomogeneousTransform<NumType>& g = ws._poses.back();
+      Eigen::Matrix<NumType, 3, 3> R;
+      R << g(0, 0), g(0, 1), g(0, 2),
+           g(1, 0), g(1, 1), g(1, 2),
+           g(2, 0), g(2, 1), g(2, 2);
+      const Eigen::Matrix<NumType, 3, 1> f = R.transpose()*Eigen::Matrix<NumType, 3, 1>(tip(0), tip(1), tip(2));
+      const Eigen::Matrix<NumType, 3, 1> l = R.transpose()*Eigen::Matrix<NumType, 3, 1>(tip(3), tip(4), tip(5));
+      r = ws._wrenches.back();
+      r.template head<3>() -= f;
+      r.template tail<3>() -= l;
+      J.template topRows<3>() -= hat(f)*eta.template bottomRows<3>();
+      J.template bottomRows<3>() -= hat(l)*eta.template bottomRows<3>();
+
+      return std::max(r.template head<3>().cwiseAbs().maxCoeff(), r.template tail<3>().cwiseAbs().maxCoeff()/_length);
+    }
+
+  protected:
+
+    // Strain twist (v; u) of the internal wrench (n; m).
+    Coordinates strain(const Coordinates& y) const
+    {
+      Coordinates xi;
+      xi.template head<3>() = _shearCompliance.cwiseProduct(y.template head<3>());
+      xi(2) += 1;
+      xi.template tail<3>() = _precurvature + _bendCompliance.cwiseProduct(y.template tail<3>());
+
+      return xi;
+    }
+
+    // (n; m)' = (-u x n; -u x m - v x n), and its derivative A(y) for the sensitivities.
+    void derivative(const Coordinates& y, Coordinates& dy, Matrix6* A) const
+    {
+      const Coordinates xi = strain(y);
+      const Eigen::Matrix<NumType, 3, 1> v = xi.template head<3>(), u = xi.template tail<3>();
+      const Eigen::Matrix<NumType, 3, 1> n = y.template head<3>(), m = y.template tail<3>();
+      dy.template head<3>() = n.cross(u);
+      dy.template tail<3>() = m.cross(u) + n.cross(v);
+      if (A)
+      {
+        const Eigen::Matrix<NumType, 3, 3> N = hat(n), U = hat(u);
+        A->template block<3, 3>(0, 0) = -U;
+        A->template block<3, 3>(0, 3) = N*_bendCompliance.asDiagonal();
+        A->template block<3, 3>(3, 0) = N*_shearCompliance.asDiagonal() - hat(v);
+        A->template block<3, 3>(3, 3) = hat(m)*_bendCompliance.asDiagonal() - U;
+      }
+    }
+
+    // One RK4 step of (n; m), and of Y = d(n; m)/dW with the same stages.
+    void rungeKutta(Coordinates& y, Matrix6& Y, const NumType& h) const
+    {
+      Coordinates k1, k2, k3, k4;
+      Matrix6 A, K1, K2, K3, K4;
+      derivative(y, k1, &A);
+      K1.noalias() = A*Y;
+      derivative(y + k1*(h/2), k2, &A);
+      K2.noalias() = A*(Y + K1*(h/2));
+      derivative(y + k2*(h/2), k3, &A);
+      K3.noalias() = A*(Y + K2*(h/2));
+      derivative(y + k3*h, k4, &A);
+      K4.noalias() = A*(Y + K3*h);
+      y += (k1 + (k2 + k3)*(NumType)2 + k4)*(h/6);
+      Y += (K1 + (K2 + K3)*(NumType)2 + K4)*(h/6);
+    }
+
+    // Integrates from the base with the base wrench W: the shape into the workspace, Y = d(n; m)(L)/dW
+    // and the body variation of the tip frame, eta, with d g(L) = g(L) (eta dW)^.
+    void shoot(const HomogeneousTransform<NumType>& base, const Coordinates& W, Workspace& ws, Matrix6& Y, Matrix6& eta) const
+    {
+      const NumType h = _length/(NumType)_steps;
+      Coordinates y = W;
+      Y.setIdentity();
+      eta.setZero();
+      ws._poses[0] = base;
+      ws._wrenches[0] = y;
+      Matrix6 dOmega, adOmega, dexp, dx0, dxh, dx1;
+      for (size_t k = 0; k < _steps; ++k)
+      {
+        const Coordinates x0 = strain(y);
+        scaleRows(Y, dx0);
+        rungeKutta(y, Y, h/2);
+        const Coordinates xh = strain(y);
+        scaleRows(Y, dxh);
+        rungeKutta(y, Y, h/2);
+        const Coordinates x1 = strain(y);
+        scaleRows(Y, dx1);
+
+        // Omega = h/6 (x0 + 4 xh + x1) + h^2/12 [x0, x1], and g_k+1 = g_k exp(Omega).
+        Coordinates bracket, omega;
+        Adjoint<NumType>::ad(x0, x1, bracket);
+        omega = (x0 + xh*(NumType)4 + x1)*(h/6) + bracket*(h*h/12);
+        const HomogeneousTransform<NumType> E = Twist<NumType>(omega(0), omega(1), omega(2), omega(3), omega(4), omega(5)).exp();
+        HomogeneousTransform<NumType>::mulInto(ws._poses[k + 1], ws._poses[k], E);
+        ws._wrenches[k + 1] = y;
+
+        // eta_k+1 = Ad_(E^-1) eta_k + dexp_(-Omega) dOmega, with dexp_(-Omega) = 1 - ad/2 + ad^2/6 - ad^3/24
+        // in Horner form, to the order of the step.
+        dOmega = (dx0 + dxh*(NumType)4 + dx1)*(h/6) + (adMatrix(x0)*dx1 - adMatrix(x1)*dx0)*(h*h/12);
+        adOmega = adMatrix(omega);
+        eta = Adjoint<NumType>(E).inv()*eta;
+        eta += dOmega;
+        dexp.noalias() = adOmega*dOmega;
+        dexp = dOmega/(NumType)6 - dexp/(NumType)24;
+        dOmega /= -(NumType)2;
+        dOmega.noalias() += adOmega*dexp;
+        eta.noalias() += adOmega*dOmega;
+      }
+    }
+
+    // Strain variations, d xi = diag(compliance) dy.
+    void scaleRows(const Matrix6& Y, Matrix6& dx) const
+    {
+      dx.template topRows<3>() = _shearCompliance.asDiagonal()*Y.template topRows<3>();
+      dx.template bottomRows<3>() = _bendCompliance.asDiagonal()*Y.template bottomRows<3>();
+    }
+
+    // The base wrench of a straight rod that carries the tip load.
+    Coordinates straightGuess(const HomogeneousTransform<NumType>& base, const Wrench<NumType>& tip) const
+    {
+      Eigen::Matrix<NumType, 3, 3> R;
+      R << base(0, 0), base(0, 1), base(0, 2),
+           base(1, 0), base(1, 1), base(1, 2),
+           base(2, 0), base(2, 1), base(2, 2);
+      const Eigen::Matrix<NumType, 3, 1> f(tip(0), tip(1), tip(2)), l(tip(3), tip(4), tip(5));
+      const Eigen::Matrix<NumType, 3, 1> arm = R.col(2)*_length;
+      Coordinates W;
+      W.template head<3>() = R.transpose()*f;
+      W.template tail<3>() = R.transpose()*(l + arm.cross(f));
+
+      return W;
+    }
+
+    // ad_xi = [w^, v^; 0, w^] for xi = (v; w).
+    static Matrix6 adMatrix(const Coordinates& xi)
+    {
+      Matrix6 ad;
+      const Eigen::Matrix<NumType, 3, 3> W = hat(xi.template tail<3>());
+      ad.template block<3, 3>(0, 0) = W;
+      ad.template block<3, 3>(0, 3) = hat(xi.template head<3>());
+      ad.template block<3, 3>(3, 0).setZero();
+      ad.template block<3, 3>(3, 3) = W;
+
+      return ad;
+    }
+
+    static Eigen::Matrix<NumType, 3, 3> hat(const Eigen::Matrix<NumType, 3, 1>& p)
+    {
+      Eigen::Matrix<NumType, 3, 3> S;
+      S << 0, -p(2), p(1),
+           p(2), 0, -p(0),
+           -p(1), p(0), 0;
+
+      return S;
+    }
+
+    NumType _length;
+    size_t _steps;
+    // Diagonals of Kse^-1 and Kbt^-1.
+    Eigen::Matrix<NumType, 3, 1> _shearCompliance;
+    Eigen::Matrix<NumType, 3, 1> _bendCompliance;
+    Eigen::Matrix<NumType, 3, 1> _precurvature;
+    NumType _tolerance;
+    size_t _maxIterations;
+  };
+
+  // Convenience names
+  using CosseratRodd = CosseratRod < double >;
+  using CosseratRodf = CosseratRod < float >;
+};
+
+#endif // COSSERATROD_HPP
@@ -0,0 +1,738 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DYNAMICS_HPP
+#define DYNAMICS_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "numericTraits.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include "spatialInertia.hpp"
+#include "chain.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+
+namespace screws
+{
+  /*!
+   * \class Dynamics
+   * \ingroup libScrews
+   * \brief Rigid body dynamics of a serial Chain, with the inertia of each link given in a link frame.
+   *
+   * Link i moves with joint i. Its frame is given at the home configuration, in the base frame, and
+   * its SpatialInertia in that frame; link frames at the centres of mass are usual but not required.
+   * inverseDynamics() is the recursive Newton-Euler algorithm in screw form (Lynch and Park, ch. 8.3):
+   * link twists and accelerations are propagated outwards with the adjoints of the joint transforms,
+   * and the joint wrenches inwards with their transposes, in O(n). Gravity enters as an acceleration
+   * of the base. forwardDynamics() is the articulated body algorithm on the same quantities, also in
+   * O(n). massMatrix() is the composite rigid body algorithm: the inertias of the links beyond each
+   * joint are summed inwards as SpatialInertia, and each column of M walks only towards the base,
+   * so only the upper triangle is computed. biasForces() is C(q, qd) qd + g(q) without the
+   * acceleration terms. gravityTorques() is g(q) alone, from the prefix products and spatial Jacobian
+   * of the Chain rather than the link recursions: joint k holds the mass and first moment of the
+   * links beyond it. All per-call storage is in a Workspace, so a call with a sized workspace
+   * does not allocate.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT Dynamics
+  {
+  public:
+    typedef Eigen::Matrix<NumType, 6, 1> Coordinates;
+    typedef std::vector< Coordinates, Eigen::aligned_allocator<Coordinates> > CoordinatesVector;
+    typedef Eigen::Matrix<NumType, 6, 6> Matrix6;
+    typedef std::vector< Matrix6, Eigen::aligned_allocator<Matrix6> > Matrix6Vector;
+    /// @brief nxn joint space inertia matrix.
+    typedef Eigen::Matrix<NumType, Eigen::Dynamic, Eigen::Dynamic> MassMatrix;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /*!
+     * \class Workspace
+     * \brief Per-call storage of the dynamics algorithms, reused across calls. Also holds the link
+     * twists, accelerations and joint wrenches of the last call, each in its link frame.
+     */
+    class Workspace
+    {
+    public:
+      template<class NumTypeDyn> friend class Dynamics;
+
+      /// @brief Storage for a chain with the given number of joints.
+      explicit Workspace(const size_t& joints = 0)
+      {
+        resize(joints);
+      }
+
+      /// @brief Change the number of joints; allocates.
+      void resize(const size_t& joints)
+      {
+        _adjoints.resize(joints);
+        _V.resize(joints);
+        _dV.resize(joints);
+        _F.resize(joints);
+        _IA.resize(joints);
+        _c.resize(joints);
+        _U.resize(joints);
+        _D.resize(joints);
+        _u.resize(joints);
+        _Ic.resize(joints);
+        _J.resize(6, joints);
+        _prefixes.resize(joints);
+      }
+
+      /// @return the number of joints the storage is for.
+      size_t joints() const
+      {
+        return _V.size();
+      }
+
+      /// @return the twist of link i in its frame.
+      TwistCoordinates<NumType> velocity(const size_t& i) const
+      {
+        assert(i < joints());
+        return coordinates(_V[i]);
+      }
+
+      /// @return the acceleration of link i in its frame.
+      TwistCoordinates<NumType> acceleration(const size_t& i) const
+      {
+        assert(i < joints());
+        return coordinates(_dV[i]);
+      }
+
+      /// @return the wrench that link i - 1 (or the base) applies to link i through joint i, in the frame of link i.
+      Wrench<NumType> wrench(const size_t& i) const
+      {
+        assert(i < joints());
+        return Wrench<NumType>(coordinates(_F[i]));
+      }
+
+    protected:
+      static TwistCoordinates<NumType> coordinates(const Coordinates& c)
+      {
+        return TwistCoordinates<NumType>(c(0), c(1), c(2), c(3), c(4), c(5));
+      }
+
+      // Ad of the transform from link i - 1 to link i at the current configuration.
+      std::vector< Adjoint<NumType> > _adjoints;
+      CoordinatesVector _V;
+      CoordinatesVector _dV;
+      CoordinatesVector _F;
+      // Articulated body algorithm: articulated inertias (the bias forces are kept in _F), velocity
+      // product accelerations, U_i = I_i A_i, D_i = A_i . U_i and u_i = tau_i - A_i . p_i.
+      Matrix6Vector _IA;
+      CoordinatesVector _c;
+      CoordinatesVector _U;
+      std::vector<NumType> _D;
+      std::vector<NumType> _u;
+      // Composite rigid body algorithm: inertia of links i..n-1 in the frame of link i.
+      std::vector< SpatialInertia<NumType> > _Ic;
+      // Gravity torques: spatial Jacobian and prefix products exp(xi_1 q_1)...exp(xi_i q_i).
+      typename Chain<NumType>::Jacobian _J;
+      std::vector< HomogeneousTransform<NumType> > _prefixes;
+    };
+
+    /// @brief Dynamics of a chain with massless links, with link frames at the base frame.
+    /// @param chain the kinematics; copied.
+    explicit Dynamics(const Chain<NumType>& chain)
+      : _chain(chain), _frames(chain.joints()), _inertias(chain.joints()), _axes(chain.joints()),
+        _axisTwists(chain.joints()), _parents(chain.joints()), _moments(chain.joints())
+    {
+      setGravity(Translation<NumType>(0, 0, (NumType)-9.81));
+      for (size_t i = 0; i < joints(); ++i)
+      {
+        update(i);
+      }
+    }
+
+    /// Default destructor.
+    ~Dynamics()
+    {
+
+    }
+
+    /// @return the kinematics.
+    const Chain<NumType>& chain() const
+    {
+      return _chain;
+    }
+
+    /// @return the number of joints.
+    size_t joints() const
+    {
+      return _chain.joints();
+    }
+
+    /// @brief Set the frame and inertia of link i.
+    /// @param frame the link frame at the home configuration, in the base frame.
+    /// @param inertia the spatial inertia of the link in its frame.
+    /// @throw screws::ScrewException if there is no link i.
+    void setLink(const size_t& i, const HomogeneousTransform<NumType>& frame, const SpatialInertia<NumType>& inertia)
+    {
+      if (i >= joints())
+      {
+        ScrewException e("Link index exceeds the number of joints.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      _frames[i] = frame;
+      _inertias[i] = inertia;
+      update(i);
+      if (i + 1 < joints())
+      {
+        update(i + 1);
+      }
+    }
+
+    /// @return the frame of link i at the home configuration.
+    const HomogeneousTransform<NumType>& linkFrame(const size_t& i) const
+    {
+      assert(i < joints());
+      return _frames[i];
+    }
+
+    /// @return the spatial inertia of link i in its frame.
+    const SpatialInertia<NumType>& inertia(const size_t& i) const
+    {
+      assert(i < joints());
+      return _inertias[i];
+    }
+
+    /// @brief Set the gravitational acceleration in the base frame [default: (0, 0, -9.81)].
+    void setGravity(const Translation<NumType>& g)
+    {
+      _gravity = g;
+      _baseAcceleration << -g(0), -g(1), -g(2), 0, 0, 0;
+    }
+
+    /// @return the gravitational acceleration in the base frame.
+    const Translation<NumType>& gravity() const
+    {
+      return _gravity;
+    }
+
+    /// @brief Inverse dynamics into caller storage, tau = M(q) qdd + C(q, qd) qd + g(q).
+    /// @param q, qd, qdd joints() joint positions, velocities and accelerations.
+    /// @param tau joints() joint torques (forces for prismatic joints).
+    /// @param ws the workspace. Resized only if it is not for joints() joints.
+    void inverseDynamics(const NumType* q, const NumType* qd, const NumType* qdd, NumType* tau, Workspace& ws) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::inverseDynamics", joints());
+      updateAdjoints(q, ws);
+      newtonEuler(qd, qdd, tau, ws);
+    }
+
+    /// @brief Inverse dynamics.
+    /// @throw screws::ScrewException if q, qd or qdd do not have joints() values.
+    std::vector<NumType> inverseDynamics(const std::vector<NumType>& q, const std::vector<NumType>& qd,
+                                         const std::vector<NumType>& qdd) const
+    {
+      checkSize(q);
+      checkSize(qd);
+      checkSize(qdd);
+      std::vector<NumType> tau(joints());
+      if (!tau.empty())
+      {
+        Workspace ws(joints());
+        inverseDynamics(&q[0], &qd[0], &qdd[0], &tau[0], ws);
+      }
+
+      return tau;
+    }
+
+    /// @brief Forward dynamics into caller storage, qdd = M(q)^-1 (tau - C(q, qd) qd - g(q)), with the
+    /// articulated body algorithm (Featherstone) in O(n).
+    /// @param q, qd joints() joint positions and velocities.
+    /// @param tau joints() joint torques (forces for prismatic joints).
+    /// @param qdd joints() joint accelerations.
+    /// @param ws the workspace. Resized only if it is not for joints() joints.
+    /// @throw screws::ScrewException if a joint moves no inertia, e.g. when the links beyond it are massless.
+    void forwardDynamics(const NumType* q, const NumType* qd, const NumType* tau, NumType* qdd, Workspace& ws) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::forwardDynamics", joints());
+      const size_t n = joints();
+      updateAdjoints(q, ws);
+
+      // Outwards: link twists V_i, velocity product accelerations c_i = ad_(V_i) A_i qd_i, and the
+      // rigid body inertias and bias forces p_i = -ad_(V_i)^T G_i V_i to start from.
+      Coordinates momentum, bias;
+      for (size_t i = 0; i < n; ++i)
+      {
+        if (i == 0)
+        {
+          ws._V[i] = _axes[i]*qd[i];
+        }
+        else
+        {
+          ws._adjoints[i].apply(ws._V[i - 1], ws._V[i]);
+          ws._V[i] += _axes[i]*qd[i];
+        }
+        Adjoint<NumType>::ad(ws._V[i], _axes[i], ws._c[i]);
+        ws._c[i] *= qd[i];
+        ws._IA[i] = _inertias[i].matrix();
+        _inertias[i].apply(ws._V[i], momentum);
+        Adjoint<NumType>::adTranspose(ws._V[i], momentum, bias);
+        ws._F[i] = -bias;
+      }
+
+      // Inwards: articulated inertias I_i and bias forces p_i; the part of link i not taken by joint
+      // i is added to the parent through Ad_(T_i,i-1).
+      Matrix6 Ia, X;
+      Coordinates pa, moved;
+      for (size_t k = n; k-- > 0;)
+      {
+        ws._U[k].noalias() = ws._IA[k]*_axes[k];
+        ws._D[k] = _axes[k].dot(ws._U[k]);
+        ws._u[k] = tau[k] - _axes[k].dot(ws._F[k]);
+        if (!(ws._D[k] > NumericTraits<NumType>::zeroTolerance()))
+        {
+          ScrewException e("A joint moves no inertia.", __FILE__, __FUNCTION__, __LINE__);
+          throw e;
+        }
+        if (k == 0)
+        {
+          continue;
+        }
+        Ia = ws._IA[k] - ws._U[k]*ws._U[k].transpose()/ws._D[k];
+        pa = ws._F[k] + ws._U[k]*(ws._u[k]/ws._D[k]);
+        pa.noalias() += Ia*ws._c[k];
+        X = ws._adjoints[k].matrix();
+        ws._IA[k - 1].noalias() += X.transpose()*Ia*X;
+        ws._adjoints[k].applyTranspose(pa, moved);
+        ws._F[k - 1] += moved;
+      }
+
+      // Outwards: qdd_i = (u_i - U_i . (Ad dV_i-1 + c_i))/D_i, dV_i = Ad dV_i-1 + c_i + A_i qdd_i.
+      for (size_t i = 0; i < n; ++i)
+      {
+        ws._adjoints[i].apply((i == 0) ? _baseAcceleration : ws._dV[i - 1], ws._dV[i]);
+        ws._dV[i] += ws._c[i];
+        qdd[i] = (ws._u[i] - ws._U[i].dot(ws._dV[i]))/ws._D[i];
+        ws._dV[i] += _axes[i]*qdd[i];
+      }
+    }
+
+    /// @brief Forward dynamics of many states, e.g. parallel rollouts of a simulation, one thread per workspace.
+    /// @param q, qd, tau count*joints() values, joints() per state.
+    /// @param qdd count*joints() joint accelerations.
+    /// @param count the number of states.
+    /// @param workspaces one workspace per thread; each steps a contiguous range of states.
+    /// @throw screws::ScrewException if there are no workspaces. An exception thrown for a state is
+    /// rethrown once all threads have finished.
+    void forwardDynamics(const NumType* q, const NumType* qd, const NumType* tau, NumType* qdd,
+                         const size_t& count, std::vector<Workspace>& workspaces) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::forwardDynamics batch", count);
+      if (workspaces.empty())
+      {
+        ScrewException e("At least one workspace is needed.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      const size_t n = joints();
+      const size_t threads = std::min(workspaces.size(), count);
+      // A thread must not let an exception escape, and every thread must be joined before leaving.
+      std::vector<std::exception_ptr> errors(threads);
+      auto range = [&](const size_t t)
+      {
+        try
+        {
+          for (size_t s = count*t/threads; s < count*(t + 1)/threads; ++s)
+          {
+            forwardDynamics(q + s*n, qd + s*n, tau + s*n, qdd + s*n, workspaces[t]);
+          }
+        }
+        catch (...)
+        {
+          errors[t] = std::current_exception();
+        }
+      };
+      std::vector<std::thread> pool;
+      pool.reserve(threads);
+      try
+      {
+        for (size_t t = 1; t < threads; ++t)
+        {
+          pool.push_back(std::thread(range, t));
+        }
+      }
+      catch (...)
+      {
+        for (size_t t = 0; t < pool.size(); ++t)
+        {
+          pool[t].join();
+        }
+        throw;
+      }
+      if (threads > 0)
+      {
+        range(0);
+      }
+      for (size_t t = 0; t < pool.size(); ++t)
+      {
+        pool[t].join();
+      }
+      for (size_t t = 0; t < threads; ++t)
+      {
+        if (errors[t])
+        {
+          std::rethrow_exception(errors[t]);
+        }
+      }
+    }
+
+    /// @brief Forward dynamics.
+    /// @throw screws::ScrewException if q, qd or tau do not have joints() values, or a joint moves no inertia.
+    std::vector<NumType> forwardDynamics(const std::vector<NumType>& q, const std::vector<NumType>& qd,
+                                         const std::vector<NumType>& tau) const
+    {
+      checkSize(q);
+      checkSize(qd);
+      checkSize(tau);
+      std::vector<NumType> qdd(joints());
+      if (!qdd.empty())
+      {
+        Workspace ws(joints());
+        forwardDynamics(&q[0], &qd[0], &tau[0], &qdd[0], ws);
+      }
+
+      return qdd;
+    }
+
+    /// @brief Joint space inertia matrix M(q) into caller storage, with the composite rigid body algorithm.
+    /// @param q joints() joint positions.
+    /// @param M the mass matrix. Resized only if it is not joints() x joints().
+    /// @param ws the workspace. Resized only if it is not for joints() joints.
+    /// @param upperOnly write only the upper triangle, e.g. for Eigen::LLT<MassMatrix, Eigen::Upper>.
+    void massMatrix(const NumType* q, MassMatrix& M, Workspace& ws, const bool& upperOnly = false) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::massMatrix", joints());
+      updateAdjoints(q, ws);
+      compositeRigidBody(M, ws, upperOnly);
+    }
+
+    /// @brief Joint space inertia matrix M(q).
+    /// @throw screws::ScrewException if q does not have joints() values.
+    MassMatrix massMatrix(const std::vector<NumType>& q) const
+    {
+      checkSize(q);
+      MassMatrix M(joints(), joints());
+      if (joints() > 0)
+      {
+        Workspace ws(joints());
+        massMatrix(&q[0], M, ws);
+      }
+
+      return M;
+    }
+
+    /// @brief Coriolis, centrifugal and gravity torques h = C(q, qd) qd + g(q) into caller storage;
+    /// inverse dynamics without the acceleration terms.
+    /// @param q, qd joints() joint positions and velocities.
+    /// @param h joints() joint torques (forces for prismatic joints).
+    /// @param ws the workspace. Resized only if it is not for joints() joints.
+    void biasForces(const NumType* q, const NumType* qd, NumType* h, Workspace& ws) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::biasForces", joints());
+      updateAdjoints(q, ws);
+      newtonEuler(qd, 0, h, ws);
+    }
+
+    /// @brief Coriolis, centrifugal and gravity torques h = C(q, qd) qd + g(q).
+    /// @throw screws::ScrewException if q or qd do not have joints() values.
+    std::vector<NumType> biasForces(const std::vector<NumType>& q, const std::vector<NumType>& qd) const
+    {
+      checkSize(q);
+      checkSize(qd);
+      std::vector<NumType> h(joints());
+      if (!h.empty())
+      {
+        Workspace ws(joints());
+        biasForces(&q[0], &qd[0], &h[0], ws);
+      }
+
+      return h;
+    }
+
+    /// @brief M(q) and h = C(q, qd) qd + g(q) of one state, e.g. for an operational space controller,
+    /// with the joint transforms computed once for both.
+    /// @see massMatrix(), biasForces()
+    void massMatrixAndBias(const NumType* q, const NumType* qd, MassMatrix& M, NumType* h, Workspace& ws,
+                           const bool& upperOnly = false) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::massMatrixAndBias", joints());
+      updateAdjoints(q, ws);
+      newtonEuler(qd, 0, h, ws);
+      compositeRigidBody(M, ws, upperOnly);
+    }
+
+    /// @brief Gravity torques g(q) into caller storage, e.g. the static holding torques, without the
+    /// velocity and acceleration passes of inverseDynamics().
+    /// @param q joints() joint positions.
+    /// @param tau joints() joint torques (forces for prismatic joints).
+    /// @param ws the workspace. Resized only if it is not for joints() joints.
+    /// @param payload a payload held by the tool, in the tool frame of the chain; only its mass and
+    /// centre of mass matter.
+    void gravityTorques(const NumType* q, NumType* tau, Workspace& ws,
+                        const SpatialInertia<NumType>& payload = SpatialInertia<NumType>()) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::gravityTorques", joints());
+      const size_t n = joints();
+      if (ws.joints() != n)
+      {
+        ws.resize(n);
+      }
+      if (n == 0)
+      {
+        return;
+      }
+      _chain.spatialJacobian(q, ws._J, &ws._prefixes[0]);
+
+      // Inwards: the mass m and first moment h = m c of the links beyond joint k, in the base frame.
+      // The gravity wrench on them is (m g; h x g), and tau_k = -xi_k' . (m g; h x g) with xi_k' the
+      // joint twist in the spatial Jacobian.
+      const Eigen::Matrix<NumType, 3, 1> g(_gravity(0), _gravity(1), _gravity(2));
+      NumType m = payload.mass();
+      Eigen::Matrix<NumType, 3, 1> h = Eigen::Matrix<NumType, 3, 1>::Zero();
+      if (m > 0)
+      {
+        const Translation<NumType> c = ws._prefixes[n - 1]*(_chain.home()*payload.centreOfMass());
+        h << m*c(0), m*c(1), m*c(2);
+      }
+      for (size_t k = n; k-- > 0;)
+      {
+        const HomogeneousTransform<NumType>& P = ws._prefixes[k];
+        const NumType mk = _inertias[k].mass();
+        m += mk;
+        h.noalias() += P.rotation().matrix()*_moments[k];
+        h += mk*P.translation().vector();
+        tau[k] = -(m*ws._J.col(k).template head<3>().dot(g) + ws._J.col(k).template tail<3>().dot(h.cross(g)));
+      }
+    }
+
+    /// @brief Gravity torques of many configurations, e.g. for a payload capacity map, with one workspace.
+    /// @param q count*joints() joint positions, joints() per configuration.
+    /// @param tau count*joints() joint torques.
+    /// @param count the number of configurations.
+    /// @param ws the workspace.
+    /// @param payload a payload held by the tool, in the tool frame of the chain.
+    void gravityTorques(const NumType* q, NumType* tau, const size_t& count, Workspace& ws,
+                        const SpatialInertia<NumType>& payload = SpatialInertia<NumType>()) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("Dynamics::gravityTorques batch", count);
+      const size_t n = joints();
+      for (size_t s = 0; s < count; ++s)
+      {
+        gravityTorques(q + s*n, tau + s*n, ws, payload);
+      }
+    }
+
+    /// @brief Gravity torques g(q).
+    /// @param payload a payload held by the tool, in the tool frame of the chain.
+    /// @throw screws::ScrewException if q does not have joints() values.
+    std::vector<NumType> gravityTorques(const std::vector<NumType>& q,
+                                        const SpatialInertia<NumType>& payload = SpatialInertia<NumType>()) const
+    {
+      checkSize(q);
+      std::vector<NumType> tau(joints());
+      if (!tau.empty())
+      {
+        Workspace ws(joints());
+        gravityTorques(&q[0], &tau[0], ws, payload);
+      }
+
+      return tau;
+    }
+
+  protected:
+
+    // Ad_(T_i,i-1) of every joint at q into the workspace, sizing it if needed.
+    void updateAdjoints(const NumType* q, Workspace& ws) const
+    {
+      const size_t n = joints();
+      if (ws.joints() != n)
+      {
+        ws.resize(n);
+      }
+      HomogeneousTransform<NumType> T;
+      for (size_t i = 0; i < n; ++i)
+      {
+        transformFromParent(i, q[i], T);
+        ws._adjoints[i] = Adjoint<NumType>(T);
+      }
+    }
+
+    // Recursive Newton-Euler on the adjoints in the workspace; no acceleration terms if qdd is null.
+    void newtonEuler(const NumType* qd, const NumType* qdd, NumType* tau, Workspace& ws) const
+    {
+      const size_t n = joints();
+
+      // Outwards: V_i = Ad_(T_i,i-1) V_i-1 + A_i qd_i,
+      // dV_i = Ad_(T_i,i-1) dV_i-1 + ad_(V_i) A_i qd_i + A_i qdd_i
+      Coordinates bracket;
+      for (size_t i = 0; i < n; ++i)
+      {
+        const Adjoint<NumType>& Ad = ws._adjoints[i];
+        if (i == 0)
+        {
+          ws._V[i].setZero();
+          Ad.apply(_baseAcceleration, ws._dV[i]);
+        }
+        else
+        {
+          Ad.apply(ws._V[i - 1], ws._V[i]);
+          Ad.apply(ws._dV[i - 1], ws._dV[i]);
+        }
+        ws._V[i] += _axes[i]*qd[i];
+        Adjoint<NumType>::ad(ws._V[i], _axes[i], bracket);
+        ws._dV[i] += bracket*qd[i];
+        if (qdd)
+        {
+          ws._dV[i] += _axes[i]*qdd[i];
+        }
+      }
+
+      // Inwards: F_i = Ad_(T_i+1,i)^T F_i+1 + G_i dV_i - ad_(V_i)^T G_i V_i, tau_i = A_i . F_i
+      Coordinates momentum, child;
+      for (size_t k = n; k-- > 0;)
+      {
+        _inertias[k].apply(ws._dV[k], ws._F[k]);
+        _inertias[k].apply(ws._V[k], momentum);
+        Adjoint<NumType>::adTranspose(ws._V[k], momentum, bracket);
+        ws._F[k] -= bracket;
+        if (k + 1 < n)
+        {
+          ws._adjoints[k + 1].applyTranspose(ws._F[k + 1], child);
+          ws._F[k] += child;
+        }
+        tau[k] = _axes[k].dot(ws._F[k]);
+      }
+    }
+
+    // Composite rigid body algorithm on the adjoints in the workspace.
+    void compositeRigidBody(MassMatrix& M, Workspace& ws, const bool& upperOnly) const
+    {
+      const size_t n = joints();
+      if ((size_t)M.rows() != n || (size_t)M.cols() != n)
+      {
+        M.resize(n, n);
+      }
+
+      // Inwards: Ic_i = G_i + Ad_(T_i+1,i)^T Ic_i+1 Ad_(T_i+1,i)
+      for (size_t k = n; k-- > 0;)
+      {
+        if (k + 1 < n)
+        {
+          ws._Ic[k + 1].changeFrame(ws._adjoints[k + 1], ws._Ic[k]);
+          ws._Ic[k] += _inertias[k];
+        }
+        else
+        {
+          ws._Ic[k] = _inertias[k];
+        }
+      }
+
+      // Column j: the wrench F = Ic_j A_j that accelerates joint j alone, carried towards the base;
+      // M_kj = A_k . F in the frame of link k for k <= j. Columns are contiguous in M.
+      Coordinates F, moved;
+      for (size_t j = 0; j < n; ++j)
+      {
+        ws._Ic[j].apply(_axes[j], F);
+        M(j, j) = _axes[j].dot(F);
+        for (size_t k = j; k > 0; --k)
+        {
+          ws._adjoints[k].applyTranspose(F, moved);
+          F = moved;
+          M(k - 1, j) = _axes[k - 1].dot(F);
+        }
+      }
+      if (!upperOnly)
+      {
+        for (size_t j = 0; j < n; ++j)
+        {
+          for (size_t k = j + 1; k < n; ++k)
+          {
+            M(k, j) = M(j, k);
+          }
+        }
+      }
+    }
+
+    // Recomputes the joint axis of link i in its frame and the home transform from link i - 1.
+    void update(const size_t& i)
+    {
+      HomogeneousTransform<NumType> toLink = _frames[i].inv();
+      Adjoint<NumType>(toLink).apply(coordinates(_chain.twist(i)), _axes[i]);
+      _axisTwists[i] = Twist<NumType>(TwistCoordinates<NumType>(-_axes[i](0), -_axes[i](1), -_axes[i](2),
+                                                                -_axes[i](3), -_axes[i](4), -_axes[i](5)));
+      _parents[i] = (i == 0) ? toLink : toLink*_frames[i - 1];
+      const Translation<NumType> c = _frames[i]*_inertias[i].centreOfMass();
+      _moments[i] << _inertias[i].mass()*c(0), _inertias[i].mass()*c(1), _inertias[i].mass()*c(2);
+    }
+
+    // T_i,i-1(q_i) = exp(-A_i q_i) M_i,i-1
+    void transformFromParent(const size_t& i, const NumType& qi, HomogeneousTransform<NumType>& T) const
+    {
+      HomogeneousTransform<NumType>::mulInto(T, _axisTwists[i].exp(qi), _parents[i]);
+    }
+
+    static Coordinates coordinates(const Twist<NumType>& xi)
+    {
+      TwistCoordinates<NumType> c = xi.coordinates();
+      Coordinates out;
+      out << c(0), c(1), c(2), c(3), c(4), c(5);
+
+      return out;
+    }
+
+    void checkSize(const std::vector<NumType>& q) const
+    {
+      if (q.size() != joints())
+      {
+        ScrewException e("Number of joint values differs from the number of joints.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+    }
+
+    Chain<NumType> _chain;
+    // Link frames at the home configuration, in the base frame, and the link inertias in them.
+    std::vector< HomogeneousTransform<NumType> > _frames;
+    std::vector< SpatialInertia<NumType> > _inertias;
+    // Joint axes in the link frames, A_i = Ad_(M_i^-1) xi_i, the twists -A_i for the joint
+    // transforms, and the home transforms from the previous link, M_i,i-1 = M_i^-1 M_i-1.
+    CoordinatesVector _axes;
+    std::vector< Twist<NumType> > _axisTwists;
+    std::vector< HomogeneousTransform<NumType> > _parents;
+    // First moments m_i c_i of the links at the home configuration, in the base frame.
+    std::vector< Eigen::Matrix<NumType, 3, 1> > _moments;
+    Translation<NumType> _gravity;
+    Coordinates _baseAcceleration;
+  };
+
+  // Convenience names
+  using Dynamicsd = Dynamics < double >;
+  using Dynamicsf = Dynamics < float >;
+};
+
+#endif // DYNAMICS_HPP
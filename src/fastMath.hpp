@@ -0,0 +1,226 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef FASTMATH_HPP
+#define FASTMATH_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "numericTraits.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace screws
+{
+  /*!
+   * \class StdMath
+   * \ingroup libScrews
+   * \brief The default math policy: the standard library functions.
+   */
+  template<class NumType>
+  struct StdMath
+  {
+    static NumType sin(const NumType& x) { return std::sin(x); }
+    static NumType cos(const NumType& x) { return std::cos(x); }
+    static NumType acos(const NumType& x) { return std::acos(x); }
+    static NumType atan2(const NumType& y, const NumType& x) { return std::atan2(y, x); }
+    static NumType sqrt(const NumType& x) { return std::sqrt(x); }
+
+    /// @brief sin and cos of the same angle.
+    static void sinCos(const NumType& x, NumType& s, NumType& c)
+    {
+      s = std::sin(x);
+      c = std::cos(x);
+    }
+
+    /// @brief sin and cos of n angles.
+    static void sinCos(const NumType* x, NumType* s, NumType* c, const size_t& n)
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        s[i] = std::sin(x[i]);
+        c[i] = std::cos(x[i]);
+      }
+    }
+
+    /// @brief atan2 of n pairs.
+    static void atan2(const NumType* y, const NumType* x, NumType* out, const size_t& n)
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        out[i] = std::atan2(y[i], x[i]);
+      }
+    }
+
+    static const char* name() { return "std"; }
+  };
+
+  /*!
+   * \class FastMath
+   * \ingroup libScrews
+   * \brief Polynomial approximations of sin, cos, acos and atan2 for the exponentials, logarithms and rpy().
+   *
+   * sin/cos: Cody-Waite reduction to [-pi/4, pi/4] followed by degree 11 (sin) and 12 (cos) minimax
+   * polynomials, with the pair renormalised so that sin^2 + cos^2 = 1 to rounding. atan2: reduction to
+   * [0, tan(pi/8)] followed by a degree 13 minimax polynomial. The degrees are chosen so that the
+   * default comparison tolerances of NumericTraits still hold in double.
+   * acos(x) = atan2(sqrt((1 - x)(1 + x)), x); it is no faster than the library acos and is only
+   * provided for completeness, the library recovers angles with atan2. sqrt stays std::sqrt, which is
+   * a single instruction.
+   *
+   * Maximum absolute error against the double precision library, measured by benchScrews over
+   * dense sweeps (sin/cos for |x| <= 1e4):
+   * - double: sin/cos 1.2e-13, atan2/acos 6e-12 rad.
+   * - float: sin/cos 1.1e-7, atan2/acos 3e-7 rad, i.e. a few float ulps, as for the float library.
+   *
+   * The code has no data-dependent branches or library calls, so the batch versions vectorise with
+   * -O3 -fno-trapping-math (GCC will not if-convert the selects otherwise). The scalar versions gain
+   * little over the library; the batches gain 2.5-10x depending on the instruction set.
+   * Select it for the whole library by defining SCREWS_FAST_MATH (CMake option of the same name,
+   * which also adds -fno-trapping-math and -fno-math-errno). Do not combine with -ffast-math, see round().
+   */
+  template<class NumType>
+  struct FastMath
+  {
+    static NumType sin(const NumType& x)
+    {
+      NumType s, c;
+      sinCos(x, s, c);
+      return s;
+    }
+
+    static NumType cos(const NumType& x)
+    {
+      NumType s, c;
+      sinCos(x, s, c);
+      return c;
+    }
+
+    static NumType sqrt(const NumType& x) { return std::sqrt(x); }
+
+    static NumType acos(const NumType& x)
+    {
+      return atan2(std::sqrt((1 - x)*(1 + x)), x);
+    }
+
+    /// @brief sin and cos of the same angle, sharing the range reduction.
+    static void sinCos(const NumType& x, NumType& s, NumType& c)
+    {
+      // x = k*pi/2 + r, with pi/2 split in three parts so that k*PIO2_1 and k*PIO2_2 are exact.
+      const NumType PIO2_1 = (NumType)1.5703125;
+      const NumType PIO2_2 = (NumType)4.837512969970703125e-4;
+      const NumType PIO2_3 = (NumType)7.54978995489188216e-8;
+      const NumType TWO_OVER_PI = (NumType)0.63661977236758134;
+
+      NumType kf = round(x*TWO_OVER_PI);
+      NumType r = ((x - kf*PIO2_1) - kf*PIO2_2) - kf*PIO2_3;
+      // Quadrant in [0, 4), kept in floating point so that the selects below vectorise.
+      // kf/4 - 3/8 is never a tie, so it rounds to floor(kf/4).
+      NumType q = kf - 4*round(kf*(NumType)0.25 - (NumType)0.375);
+
+      NumType z = r*r;
+      NumType sr = (((((NumType)-2.3983389464177485e-8*z + (NumType)2.7542472449882707e-6)*z +
+                      (NumType)-1.984118880467625e-4)*z + (NumType)8.33333314906695e-3)*z +
+                    (NumType)-1.6666666665323615e-1)*z*r + r;
+      NumType cr = (((((NumType)2.133531730372121e-9*z + (NumType)-2.756813152384983e-7)*z +
+                      (NumType)2.480166409591635e-5)*z + (NumType)-1.3888889111859264e-3)*z +
+                    (NumType)4.166666666891803e-2)*z*z - (NumType)0.5*z + 1;
+
+      // Scale the pair back onto the unit circle, so that rotations built from it stay orthonormal
+      // to rounding. n = 1 + e with e ~ 1e-13, and 1/sqrt(n) = (3 - n)/2 + O(e^2).
+      NumType n = sr*sr + cr*cr;
+      NumType scale = (3 - n)*(NumType)0.5;
+      sr *= scale;
+      cr *= scale;
+
+      // Quadrant q: (sin, cos) = (sr, cr), (cr, -sr), (-sr, -cr), (-cr, sr).
+      bool swap = (q == 1) | (q == 3);
+      NumType sinSign = (q >= 2) ? (NumType)-1 : (NumType)1;
+      NumType cosSign = (q == 1) | (q == 2) ? (NumType)-1 : (NumType)1;
+      s = sinSign*(swap ? cr : sr);
+      c = cosSign*(swap ? sr : cr);
+    }
+
+    static NumType atan2(const NumType& y, const NumType& x)
+    {
+      const NumType TAN_PI_8 = (NumType)0.41421356237309503;
+
+      NumType ax = std::fabs(x);
+      NumType ay = std::fabs(y);
+      NumType mx = (ax > ay) ? ax : ay;
+      NumType mn = (ax > ay) ? ay : ax;
+      // Divisions are unconditional, so that the selects can be evaluated on whole vectors.
+      NumType a = mn/((mx > 0) ? mx : (NumType)1);
+
+      // atan(a) = pi/4 + atan((a - 1)/(a + 1)) for a > tan(pi/8).
+      bool shift = a > TAN_PI_8;
+      NumType shifted = (a - 1)/(a + 1);
+      NumType t = shift ? shifted : a;
+      NumType z = t*t;
+      NumType r = ((((((NumType)4.63521786226076e-2*z + (NumType)-8.41813683473266e-2)*z +
+                      (NumType)1.1032961155831177e-1)*z + (NumType)-1.428090796858792e-1)*z +
+                    (NumType)1.999985716525166e-1)*z + (NumType)-3.333333180719102e-1)*z*t + t;
+      r += shift ? NumericConstants<NumType>::pi()/4 : (NumType)0;
+
+      r = (ay > ax) ? NumericConstants<NumType>::halfPi() - r : r;
+      r = (x < 0) ? NumericConstants<NumType>::pi() - r : r;
+      return (y < 0) ? -r : r;
+    }
+
+    /// @brief sin and cos of n angles.
+    static void sinCos(const NumType* x, NumType* s, NumType* c, const size_t& n)
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        sinCos(x[i], s[i], c[i]);
+      }
+    }
+
+    /// @brief atan2 of n pairs.
+    static void atan2(const NumType* y, const NumType* x, NumType* out, const size_t& n)
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        out[i] = atan2(y[i], x[i]);
+      }
+    }
+
+    static const char* name() { return "fast"; }
+
+  protected:
+
+    // Round to nearest by adding and removing 1.5*2^(mantissa bits), which pushes the fraction out
+    // of the mantissa. Valid for |x| < 2^(mantissa bits - 2); unlike std::floor it needs no SSE4.1.
+    // Relies on strict IEEE evaluation, so do not compile with -ffast-math.
+    static NumType round(const NumType& x)
+    {
+      const NumType shifter = (NumType)1.5*(NumType)(1ull << (std::numeric_limits<NumType>::digits - 1));
+      return (x + shifter) - shifter;
+    }
+  };
+
+  /// @brief The math policy used by the library, chosen at compile time.
+#ifdef SCREWS_FAST_MATH
+  template<class NumType>
+  using MathPolicy = FastMath<NumType>;
+#else
+  template<class NumType>
+  using MathPolicy = StdMath<NumType>;
+#endif
+};
+
+#endif // FASTMATH_HPP
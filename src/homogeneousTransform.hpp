@@ -19,8 +19,11 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
+#include "numericTraits.hpp"
 #include <Eigen/Eigen>
 #include <cfloat>
+#include <algorithm>
 
 namespace screws
 {
@@ -44,6 +47,7 @@ namespace screws
   public:
     template<class NumTypeTrans> friend class Translation;
     template<class NumTypeRot> friend class Rotation;
+    template<class NumTypeOther> friend class HomogeneousTransform;
     
     /// @brief Create a default homogeneous transformation unit matrix.
     HomogeneousTransform<NumType>()
@@ -62,10 +66,18 @@ namespace screws
       _zeroVal = (NumType)0;
       _oneVal = (NumType)1;
     }
+
+    /// @brief Copy and move constructors: plain copies of the rotation and translation, without validation.
+    HomogeneousTransform(const HomogeneousTransform<NumType>&) = default;
+    HomogeneousTransform(HomogeneousTransform<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    HomogeneousTransform<NumType>& operator=(const HomogeneousTransform<NumType>&) = default;
+    HomogeneousTransform<NumType>& operator=(HomogeneousTransform<NumType>&&) = default;
     
     /// @brief Return the 3x1 translation vector.
     /// @return the 3x1 translation vector.
-    Translation<NumType> translation() const
+    const Translation<NumType>& translation() const
     {
       return _T;
     }
@@ -79,7 +91,7 @@ namespace screws
     
     /// @brief Return the rotational part of the homogeneous transformation matrix.
     /// @return the 3x3 rotational component.
-    Rotation<NumType> rotation() const
+    const Rotation<NumType>& rotation() const
     {
       return _R;
     }
@@ -90,11 +102,35 @@ namespace screws
     {
       _R = R;
     }
+
+    /// @brief Overwrite both parts from Eigen storage, e.g. with a product formed in a kernel.
+    /// @param R a 3x3 Eigen matrix or expression, see Rotation::setMatrixUnchecked().
+    /// @param T a 3x1 Eigen vector or expression.
+    template<class DerivedR, class DerivedT>
+    void setUnchecked(const Eigen::MatrixBase<DerivedR>& R, const Eigen::MatrixBase<DerivedT>& T)
+    {
+      _R._data = R;
+      _T._data = T;
+    }
     
+    /// @brief Convert to another number type, e.g. HomogeneousTransformd to HomogeneousTransformf.
+    /// @return the homogeneous transform with elements rounded to NewNumType.
+    /// @note See Rotation::cast(). Use MixedPrecision to compose float transforms in double.
+    template<class NewNumType>
+    HomogeneousTransform<NewNumType> cast() const
+    {
+      HomogeneousTransform<NewNumType> H;
+      H._R = _R.template cast<NewNumType>();
+      H._T = _T.template cast<NewNumType>();
+
+      return H;
+    }
+
     /// @brief Calculate the twist (log) of the homogeneous transformation matrix.
     /// @return the 4x4 twist skew symmetric matrix.
     Twist<NumType> log() const
     {
+      SCREWS_INSTRUMENT(TRANSFORM_LOG);
       return twist();
     }
     
@@ -109,44 +145,126 @@ namespace screws
     /// @return the inverted homogeneous transformation matrix.
     HomogeneousTransform<NumType> inv() const
     {
-      Rotation<NumType> Rinv = _R.inv();
-      HomogeneousTransform<NumType> inverted(Rinv, Rinv*((NumType)(-1)*_T));
+      SCREWS_INSTRUMENT(TRANSFORM_INV);
+      HomogeneousTransform<NumType> inverted;
+      invInto(inverted, *this);
+
       return inverted;
     }
 
+    /// @brief out = H.inv(), reusing the storage of out.
+    /// @param out the result; may be H.
+    static void invInto(HomogeneousTransform<NumType>& out, const HomogeneousTransform<NumType>& H)
+    {
+      Eigen::Matrix<NumType, 3, 1> T = -(H._R._data.transpose()*H._T._data);
+      Rotation<NumType>::invInto(out._R, H._R);
+      out._T._data = T;
+    }
+
+    /// @brief out = A*B, reusing the storage of out.
+    /// @param out the result; may be A or B, but a separate output (e.g. two buffers used in turn
+    /// along a chain) is faster, as the product is then written directly.
+    static void mulInto(HomogeneousTransform<NumType>& out, const HomogeneousTransform<NumType>& A,
+                        const HomogeneousTransform<NumType>& B)
+    {
+      // The translation is formed first, as out may be B.
+      Eigen::Matrix<NumType, 3, 1> T = A._R._data*B._T._data + A._T._data;
+      Rotation<NumType>::mulInto(out._R, A._R, B._R);
+      out._T._data = T;
+    }
+
+    /// @brief out = H*T, reusing the storage of out.
+    /// @param out the result; may be T.
+    static void mulInto(Translation<NumType>& out, const HomogeneousTransform<NumType>& H, const Translation<NumType>& T)
+    {
+      out._data = H._R._data*T._data + H._T._data;
+    }
+
+    /// @brief Relative pose of H seen from this transform, inv()*H, computed without forming the inverse.
+    /// @param H the other pose.
+    /// @return (R^T*R_H, R^T*(T_H - T)).
+    /// @note The result is not validated; it is a product of valid rotations.
+    HomogeneousTransform<NumType> relative(const HomogeneousTransform<NumType>& H) const
+    {
+      HomogeneousTransform<NumType> rel;
+      rel._R._data.noalias() = _R._data.transpose()*H._R._data;
+      rel._T._data.noalias() = _R._data.transpose()*(H._T._data - _T._data);
+
+      return rel;
+    }
+
+    /// @brief Twist (log) of the relative pose inv()*H.
+    /// @note The principal log (angle in [0, pi]), so that the result is continuous around the
+    /// identity and usable as a residual.
+    Twist<NumType> relativeLog(const HomogeneousTransform<NumType>& H) const
+    {
+      return Twist<NumType>(relative(H), true);
+    }
+
     /// @brief Matrix multiplication.
     /// @return the resulting homogeneous transform.
-    HomogeneousTransform<NumType> operator*(const HomogeneousTransform<NumType>& H)
+    HomogeneousTransform<NumType> operator*(const HomogeneousTransform<NumType>& H) const
     {
-      Rotation<NumType> Rnew = _R*H.rotation();
-      Translation<NumType> Tnew = _R*H.translation() + _T;
-      
-      return HomogeneousTransform(Rnew, Tnew);
+      SCREWS_INSTRUMENT(TRANSFORM_PRODUCT);
+      HomogeneousTransform<NumType> product;
+      mulInto(product, *this, H);
+
+      return product;
     }
     
     /// @brief In-place matrix multiplication.
     /// @return the resulting homogeneous transform.
     const HomogeneousTransform<NumType>& operator *=(const HomogeneousTransform<NumType>& H)
     {
-      Rotation<NumType> Rnew = _R*H.rotation();
-      Translation<NumType> Tnew = _R*H.translation() + _T;
+      mulInto(*this, *this, H);
 
-      setRotation(Rnew);
-      setTranslation(Tnew);
-      
       return *this;
     }
     
     /// @brief Multiplication with a translation.
     /// @return the resulting translation.
-    Translation<NumType> operator*(const Translation<NumType>& T)
+    Translation<NumType> operator*(const Translation<NumType>& T) const
+    {
+      Translation<NumType> transformed;
+      mulInto(transformed, *this, T);
+
+      return transformed;
+    }
+
+    /// @brief Transform n points given as structure of arrays, o = R*p + T.
+    /// @param x, y, z the point coordinates.
+    /// @param n the number of points.
+    /// @param ox, oy, oz the transformed coordinates. May be the same arrays as x, y, z.
+    void transform(const NumType* x, const NumType* y, const NumType* z, const size_t& n,
+                   NumType* ox, NumType* oy, NumType* oz) const
     {
-      return Translation<NumType>(_R*T + _T);
+      enum { BLOCK = 256 };
+      const NumType r00 = _R(0, 0), r01 = _R(0, 1), r02 = _R(0, 2);
+      const NumType r10 = _R(1, 0), r11 = _R(1, 1), r12 = _R(1, 2);
+      const NumType r20 = _R(2, 0), r21 = _R(2, 1), r22 = _R(2, 2);
+      const NumType t0 = _T(0), t1 = _T(1), t2 = _T(2);
+      NumType bx[BLOCK], by[BLOCK], bz[BLOCK];
+      for (size_t start = 0; start < n; start += BLOCK)
+      {
+        const size_t m = std::min((size_t)BLOCK, n - start);
+        // Written to local blocks first, so that the loop vectorises whether or not the outputs
+        // overlap the inputs.
+        for (size_t i = 0; i < m; ++i)
+        {
+          NumType px = x[start + i], py = y[start + i], pz = z[start + i];
+          bx[i] = r00*px + r01*py + r02*pz + t0;
+          by[i] = r10*px + r11*py + r12*pz + t1;
+          bz[i] = r20*px + r21*py + r22*pz + t2;
+        }
+        std::copy(bx, bx + m, ox + start);
+        std::copy(by, by + m, oy + start);
+        std::copy(bz, bz + m, oz + start);
+      }
     }
     
     /// @brief Element-by-element exact equality operator.
     /// @return true if all elements are exactly the same.
-    bool operator ==(const HomogeneousTransform& H)
+    bool operator ==(const HomogeneousTransform& H) const
     {
       bool equal = true;
       for(int i = 0; i < 4; ++i)
@@ -158,7 +276,7 @@ namespace screws
     
     /// @brief Element-by-element inequality operator.
     /// @return true if any of the elements are not exactly the same.
-    bool operator !=(const HomogeneousTransform& H)
+    bool operator !=(const HomogeneousTransform& H) const
     {
       return !(*this == H);
     }
@@ -195,15 +313,16 @@ namespace screws
     
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param T compared translation.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const HomogeneousTransform<NumType>& H, double eps = FLT_EPSILON)
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const HomogeneousTransform<NumType>& H,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
       bool approxEq = true;
       for(int i = 0; i < 4; ++i)
       {
         for(int j = 0; j < 4; ++j)
         {
-          approxEq = approxEq && (fabs((*this)(i, j) - H(i, j)) < eps);
+          approxEq = approxEq && (std::fabs((*this)(i, j) - H(i, j)) < eps);
         }
       }
       
@@ -212,9 +331,10 @@ namespace screws
     
     /// @brief Perform verification that matrix is indeed in approriate format by checking
     /// the rotational component for validity.
-    bool isValid() const
+    /// @param eps allowed deviation [default: NumericTraits<NumType>::validationTolerance()].
+    bool isValid(const NumType& eps = NumericTraits<NumType>::validationTolerance()) const
     {
-      return _R.isValid();
+      return _R.isValid(eps);
     }
     
   private:
@@ -0,0 +1,302 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include "screwsInitLibrary.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <stdint.h>
+
+// Chosen by the platform only, so that the class is the same with and without SCREWS_INSTRUMENTATION.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define SCREWS_INSTRUMENTATION_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace screws
+{
+  /*!
+   * \class Instrumentation
+   * \ingroup libScrews
+   * \brief Per-thread call and time counters for the hot primitives, compiled in with SCREWS_INSTRUMENTATION.
+   *
+   * Each instrumented primitive counts its calls and the ticks spent in it (the time stamp counter
+   * on x86, nanoseconds elsewhere); exceptions and validation failures are counted as events.
+   * Every thread writes only its own block of counters, without locks or atomic read-modify-writes.
+   * snapshot() sums the blocks of all threads, including threads that have exited, so a node that
+   * misses its deadline can dump() the counters, or diff two snapshots, without a profiler.
+   * The ticks are exclusive: a primitive called inside another, e.g. Rotation::setData() inside
+   * HomogeneousTransform::operator*, counts its ticks under its own counter only, so the ticks of
+   * all counters add up to the instrumented time.
+   * Without SCREWS_INSTRUMENTATION the macros expand to nothing and snapshot() returns zeros. The
+   * class itself does not depend on the option, so code built with and without it can be linked.
+   */
+  class SCREWS_EXPORT Instrumentation
+  {
+  public:
+    /// @brief The instrumented primitives and events.
+    enum Counter
+    {
+      ROTATION_IS_VALID,
+      ROTATION_SET_DATA,
+      SKEW_EXP,
+      TWIST_EXP,
+      TRANSFORM_LOG,
+      TRANSFORM_INV,
+      TRANSFORM_PRODUCT,
+      NORMALISED,
+      EXCEPTIONS,           ///< ScrewExceptions created; event only, no ticks.
+      VALIDATION_FAILURES,  ///< Failed Rotation::isValid() checks; event only, no ticks.
+      COUNTERS
+    };
+
+    /// @brief Summed counters of all threads.
+    struct Snapshot
+    {
+      uint64_t calls[COUNTERS];
+      uint64_t ticks[COUNTERS];
+
+      /// @return the counts between an earlier snapshot and this one.
+      Snapshot operator-(const Snapshot& earlier) const
+      {
+        Snapshot d;
+        for (unsigned int i = 0; i < COUNTERS; ++i)
+        {
+          d.calls[i] = calls[i] - earlier.calls[i];
+          d.ticks[i] = ticks[i] - earlier.ticks[i];
+        }
+        return d;
+      }
+    };
+
+    /// @return true if the library was compiled with SCREWS_INSTRUMENTATION.
+    static bool enabled();
+
+    /// @return the name of a counter, e.g. for logs.
+    static const char* name(const Counter& counter)
+    {
+      static const char* const names[COUNTERS] = {
+        "Rotation::isValid", "Rotation::setData", "Skew::exp", "Twist::exp",
+        "HomogeneousTransform::log", "HomogeneousTransform::inv", "HomogeneousTransform::operator*",
+        "normalised", "exceptions", "validation failures" };
+      return names[counter];
+    }
+
+    /// @return the unit of the ticks.
+    static const char* tickUnit()
+    {
+#ifdef SCREWS_INSTRUMENTATION_RDTSC
+      return "cycles";
+#else
+      return "ns";
+#endif
+    }
+
+    /// @return the counters summed over all threads. Counts of threads still running are read
+    /// without synchronisation, so they may lag by the calls in flight.
+    static Snapshot snapshot()
+    {
+      Snapshot s;
+      for (unsigned int i = 0; i < COUNTERS; ++i)
+      {
+        s.calls[i] = 0;
+        s.ticks[i] = 0;
+      }
+      for (Block* b = head().load(std::memory_order_acquire); b != 0; b = b->next)
+      {
+        for (unsigned int i = 0; i < COUNTERS; ++i)
+        {
+          s.calls[i] += b->calls[i].load(std::memory_order_relaxed);
+          s.ticks[i] += b->ticks[i].load(std::memory_order_relaxed);
+        }
+      }
+      return s;
+    }
+
+    /// @brief Print a table of the counters with calls, ticks and ticks per call.
+    static void dump(std::ostream& os, const Snapshot& s = snapshot())
+    {
+      std::ios::fmtflags flags = os.flags();
+      std::streamsize precision = os.precision();
+      os << std::left << std::setw(36) << "counter" << std::right << std::setw(14) << "calls"
+         << std::setw(16) << tickUnit() << std::setw(12) << "per call" << std::endl;
+      for (unsigned int i = 0; i < COUNTERS; ++i)
+      {
+        os << std::left << std::setw(36) << name((Counter)i) << std::right << std::setw(14) << s.calls[i]
+           << std::setw(16) << s.ticks[i] << std::setw(12) << std::fixed << std::setprecision(1)
+           << ((s.calls[i] > 0) ? (double)s.ticks[i]/(double)s.calls[i] : 0.0) << std::endl;
+      }
+      os.flags(flags);
+      os.precision(precision);
+    }
+
+    /// @brief Count an event of the calling thread.
+    static void count(const Counter& counter)
+    {
+      bump(local().calls[counter], 1);
+    }
+
+    /// @return the current tick count.
+    static uint64_t ticks()
+    {
+#if defined(SCREWS_INSTRUMENTATION_RDTSC) && defined(_MSC_VER)
+      return __rdtsc();
+#elif defined(SCREWS_INSTRUMENTATION_RDTSC)
+      return __builtin_ia32_rdtsc();
+#else
+      return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /// @brief Count a call of the calling thread and the ticks it took.
+    static void record(const Counter& counter, const uint64_t& elapsed)
+    {
+      Block& b = local();
+      bump(b.calls[counter], 1);
+      bump(b.ticks[counter], elapsed);
+    }
+
+  private:
+    friend class InstrumentationScope;
+
+    // The counters of one thread. Blocks are never freed: a block is released when its thread
+    // exits, keeps its counts, and is reused by the next new thread, so the list is as long as the
+    // largest number of threads that ran at the same time.
+    struct Block
+    {
+      std::atomic<uint64_t> calls[COUNTERS];
+      std::atomic<uint64_t> ticks[COUNTERS];
+      std::atomic<bool> inUse;
+      Block* next;
+      // Ticks of the scopes closed inside the innermost open scope; only the owning thread uses it.
+      uint64_t nested;
+    };
+
+    // Claims a block for the lifetime of the thread.
+    struct Owner
+    {
+      Owner() : block(claim())
+      {
+
+      }
+
+      ~Owner()
+      {
+        block->inUse.store(false, std::memory_order_release);
+      }
+
+      Block* block;
+    };
+
+    static std::atomic<Block*>& head()
+    {
+      static std::atomic<Block*> blocks(0);
+      return blocks;
+    }
+
+    static Block* claim()
+    {
+      for (Block* b = head().load(std::memory_order_acquire); b != 0; b = b->next)
+      {
+        bool free = false;
+        if (b->inUse.compare_exchange_strong(free, true, std::memory_order_acq_rel))
+        {
+          return b;
+        }
+      }
+
+      Block* b = new Block;
+      for (unsigned int i = 0; i < COUNTERS; ++i)
+      {
+        b->calls[i].store(0, std::memory_order_relaxed);
+        b->ticks[i].store(0, std::memory_order_relaxed);
+      }
+      b->nested = 0;
+      b->inUse.store(true, std::memory_order_relaxed);
+      b->next = head().load(std::memory_order_relaxed);
+      while (!head().compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+      {
+      }
+      return b;
+    }
+
+    static Block& local()
+    {
+      static thread_local Owner owner;
+      return *owner.block;
+    }
+
+    // Only the owning thread writes, so a relaxed load and store is enough and avoids a locked add.
+    static void bump(std::atomic<uint64_t>& c, const uint64_t& value)
+    {
+      c.store(c.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+  };
+
+  /*!
+   * \class InstrumentationScope
+   * \ingroup libScrews
+   * \brief Records a call and its exclusive ticks on leaving the scope, see SCREWS_INSTRUMENT.
+   */
+  class InstrumentationScope
+  {
+  public:
+    explicit InstrumentationScope(const Instrumentation::Counter& counter)
+      : _counter(counter), _block(Instrumentation::local())
+    {
+      _outer = _block.nested;
+      _block.nested = 0;
+      _start = Instrumentation::ticks();
+    }
+
+    ~InstrumentationScope()
+    {
+      const uint64_t elapsed = Instrumentation::ticks() - _start;
+      Instrumentation::bump(_block.calls[_counter], 1);
+      Instrumentation::bump(_block.ticks[_counter], elapsed - _block.nested);
+      _block.nested = _outer + elapsed;
+    }
+
+  private:
+    Instrumentation::Counter _counter;
+    Instrumentation::Block& _block;
+    // The nested ticks of the enclosing scope, restored with this scope added on leaving.
+    uint64_t _outer;
+    uint64_t _start;
+  };
+};
+
+/// @brief Time the rest of the enclosing scope under the given counter, e.g. SCREWS_INSTRUMENT(SKEW_EXP).
+/// @brief SCREWS_COUNT counts an event without timing it.
+#ifdef SCREWS_INSTRUMENTATION
+#define SCREWS_INSTRUMENT_CONCAT(a, b) a##b
+#define SCREWS_INSTRUMENT_NAME(line) SCREWS_INSTRUMENT_CONCAT(screwsInstrumentationScope, line)
+#define SCREWS_INSTRUMENT(counter) \
+  screws::InstrumentationScope SCREWS_INSTRUMENT_NAME(__LINE__)(screws::Instrumentation::counter)
+#define SCREWS_COUNT(counter) screws::Instrumentation::count(screws::Instrumentation::counter)
+#else
+#define SCREWS_INSTRUMENT(counter)
+#define SCREWS_COUNT(counter)
+#endif
+
+#endif // INSTRUMENTATION_HPP
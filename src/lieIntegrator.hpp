@@ -0,0 +1,233 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef LIEINTEGRATOR_HPP
+#define LIEINTEGRATOR_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "adjoint.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <cmath>
+
+namespace screws
+{
+  /*!
+   * \class LieIntegrator
+   * \ingroup libScrews
+   * \brief Integrators of g' = g V^ on SE(3) and R' = R w^ on SO(3), for a body velocity V(t, g) or w(t, R).
+   *
+   * Every step moves the pose by products of exponentials, g_n+1 = g_n exp(...), through Twist::exp()
+   * and Skew::exp(), so the result stays a rigid motion to rounding and needs no re-orthonormalisation.
+   * The methods are (Iserles, Munthe-Kaas, Norsett and Zanna, Acta Numerica 2000):
+   * - RKMK4: Runge-Kutta-Munthe-Kaas of order 4, the classical RK4 in the Lie algebra, with
+   *   dexp^-1 truncated after the double bracket. Four velocity calls per step.
+   * - CROUCH_GROSSMAN3: Crouch-Grossman of order 3, each stage a product of exponentials of
+   *   frozen velocities. Three velocity calls per step, no brackets.
+   * - MAGNUS4: Magnus of order 4 with two Gauss points, for velocities of time only, e.g. a
+   *   prescribed profile. The velocity is evaluated at the pose at the start of the step, so a
+   *   velocity of the pose makes it first order; use RKMK4 or CROUCH_GROSSMAN3 then.
+   *
+   * The velocity is any callable: V(t, g) returning TwistCoordinates for SE(3), with the linear part
+   * first, and w(t, R) returning a Vector3 for SO(3). The batch forms call f(i, t, g) for body i.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT LieIntegrator
+  {
+  public:
+    /// @brief The integration method.
+    enum Method
+    {
+      RKMK4,
+      CROUCH_GROSSMAN3,
+      MAGNUS4
+    };
+
+    /// @brief One step of g' = g V^(t, g) on SE(3).
+    /// @param f the body velocity, TwistCoordinates<NumType> f(const NumType& t, const HomogeneousTransform<NumType>& g).
+    /// @param t the time at the start of the step.
+    /// @param g the pose at t.
+    /// @param h the step.
+    /// @param method the integration method.
+    /// @return the pose at t + h.
+    template<class Velocity>
+    static HomogeneousTransform<NumType> step(const Velocity& f, const NumType& t, const HomogeneousTransform<NumType>& g,
+                                              const NumType& h, const Method& method = RKMK4)
+    {
+      return stepOn<SE3>(f, t, g, h, method);
+    }
+
+    /// @brief One step of R' = R w^(t, R) on SO(3).
+    /// @param f the body angular velocity, Vector3<NumType> f(const NumType& t, const Rotation<NumType>& R).
+    /// @see step() on SE(3) for the other parameters.
+    template<class Velocity>
+    static Rotation<NumType> step(const Velocity& f, const NumType& t, const Rotation<NumType>& R,
+                                  const NumType& h, const Method& method = RKMK4)
+    {
+      return stepOn<SO3>(f, t, R, h, method);
+    }
+
+    /// @brief One step of many bodies, each with its own velocity f(i, t, g_i), in place.
+    /// @param f the body velocities, called as f(i, t, g) for body i.
+    /// @param g count poses (HomogeneousTransform or Rotation), replaced by the poses at t + h.
+    /// @param count the number of bodies.
+    /// @note The bodies are independent and no state is kept, so threads may step disjoint ranges.
+    template<class Velocity, class Element>
+    static void step(const Velocity& f, const NumType& t, Element* g, const size_t& count,
+                     const NumType& h, const Method& method = RKMK4)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("LieIntegrator::step batch", count);
+      for (size_t i = 0; i < count; ++i)
+      {
+        g[i] = step([&f, i](const NumType& s, const Element& x) { return f(i, s, x); }, t, g[i], h, method);
+      }
+    }
+
+    /// @brief Integrate with a fixed step.
+    /// @param f the velocity, as for step().
+    /// @param t0 the initial time.
+    /// @param g0 the initial pose (HomogeneousTransform or Rotation).
+    /// @param h the step.
+    /// @param steps the number of steps.
+    /// @return the pose at t0 + steps*h.
+    template<class Velocity, class Element>
+    static Element integrate(const Velocity& f, const NumType& t0, const Element& g0, const NumType& h,
+                             const size_t& steps, const Method& method = RKMK4)
+    {
+      Element g = g0;
+      for (size_t k = 0; k < steps; ++k)
+      {
+        g = step(f, t0 + (NumType)k*h, g, h, method);
+      }
+
+      return g;
+    }
+
+  protected:
+
+    // SE(3): twist coordinates (v; w), Twist::exp and the bracket of Adjoint::ad.
+    struct SE3
+    {
+      typedef HomogeneousTransform<NumType> Element;
+      typedef Eigen::Matrix<NumType, 6, 1> Algebra;
+
+      static Algebra coordinates(const TwistCoordinates<NumType>& V)
+      {
+        Algebra u;
+        u << V(0), V(1), V(2), V(3), V(4), V(5);
+
+        return u;
+      }
+
+      static Element exp(const Algebra& u)
+      {
+        return Twist<NumType>(u(0), u(1), u(2), u(3), u(4), u(5)).exp();
+      }
+
+      static Algebra bracket(const Algebra& a, const Algebra& b)
+      {
+        Algebra out;
+        Adjoint<NumType>::ad(a, b, out);
+
+        return out;
+      }
+    };
+
+    // SO(3): angular velocity w, Skew::exp and the cross product.
+    struct SO3
+    {
+      typedef Rotation<NumType> Element;
+      typedef Eigen::Matrix<NumType, 3, 1> Algebra;
+
+      static Algebra coordinates(const Vector3<NumType>& w)
+      {
+        return Algebra(w(0), w(1), w(2));
+      }
+
+      static Element exp(const Algebra& u)
+      {
+        return Skew<NumType>(Translation<NumType>(u(0), u(1), u(2))).exp();
+      }
+
+      static Algebra bracket(const Algebra& a, const Algebra& b)
+      {
+        return a.cross(b);
+      }
+    };
+
+    template<class Group, class Velocity>
+    static typename Group::Element stepOn(const Velocity& f, const NumType& t, const typename Group::Element& g,
+                                          const NumType& h, const Method& method)
+    {
+      typedef typename Group::Algebra Algebra;
+      switch (method)
+      {
+      case CROUCH_GROSSMAN3:
+      {
+        // Y2 = g exp(3/4 h k1), Y3 = g exp(119/216 h k1) exp(17/108 h k2),
+        // g' = g exp(13/51 h k1) exp(-2/3 h k2) exp(24/17 h k3)
+        const Algebra k1 = Group::coordinates(f(t, g));
+        const Algebra k2 = Group::coordinates(f(t + h*(NumType)0.75, g*Group::exp(k1*(h*(NumType)0.75))));
+        const Algebra k3 = Group::coordinates(f(t + h*(NumType)(17.0/24.0),
+                                                g*Group::exp(k1*(h*(NumType)(119.0/216.0)))*Group::exp(k2*(h*(NumType)(17.0/108.0)))));
+        return g*Group::exp(k1*(h*(NumType)(13.0/51.0)))*Group::exp(k2*(h*(NumType)(-2.0/3.0)))*Group::exp(k3*(h*(NumType)(24.0/17.0)));
+      }
+      case MAGNUS4:
+      {
+        // Omega = h/2 (V1 + V2) + sqrt(3)/12 h^2 [V1, V2] at the Gauss points t + (1/2 -+ sqrt(3)/6) h.
+        const NumType offset = (NumType)(std::sqrt(3.0)/6.0);
+        const Algebra V1 = Group::coordinates(f(t + h*((NumType)0.5 - offset), g));
+        const Algebra V2 = Group::coordinates(f(t + h*((NumType)0.5 + offset), g));
+        const Algebra omega = (V1 + V2)*(h/2) + Group::bracket(V1, V2)*(h*h*offset/2);
+        return g*Group::exp(omega);
+      }
+      case RKMK4:
+      default:
+      {
+        // Stages at g exp(u), with the body velocity pulled back to the algebra by
+        // dexp^-1_-u V = V + [u, V]/2 + [u, [u, V]]/12.
+        const Algebra k1 = Group::coordinates(f(t, g));
+        Algebra u = k1*(h/2);
+        const Algebra k2 = dexpInverse<Group>(u, Group::coordinates(f(t + h/2, g*Group::exp(u))));
+        u = k2*(h/2);
+        const Algebra k3 = dexpInverse<Group>(u, Group::coordinates(f(t + h/2, g*Group::exp(u))));
+        u = k3*h;
+        const Algebra k4 = dexpInverse<Group>(u, Group::coordinates(f(t + h, g*Group::exp(u))));
+        return g*Group::exp((k1 + (k2 + k3)*(NumType)2 + k4)*(h/6));
+      }
+      }
+    }
+
+    template<class Group>
+    static typename Group::Algebra dexpInverse(const typename Group::Algebra& u, const typename Group::Algebra& V)
+    {
+      const typename Group::Algebra uV = Group::bracket(u, V);
+      return V + uV/(NumType)2 + Group::bracket(u, uV)/(NumType)12;
+    }
+  };
+
+  // Convenience names
+  using LieIntegratord = LieIntegrator < double >;
+  using LieIntegratorf = LieIntegrator < float >;
+};
+
+#endif // LIEINTEGRATOR_HPP
@@ -0,0 +1,166 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef MIXEDPRECISION_HPP
+#define MIXEDPRECISION_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+
+namespace screws
+{
+  /*!
+   * \class MixedPrecision
+   * \ingroup libScrews
+   * \brief Composition kernels for homogeneous transforms stored in StorageType (typically float)
+   * and composed in ComputeType (typically double).
+   *
+   * Every kernel loads the stored transforms, multiplies them in ComputeType, and rounds only the
+   * result back to StorageType. No intermediate Rotation is created, so nothing is re-validated.
+   *
+   * Error bound: let u = epsilon(StorageType)/2 (2^-24 for float). Compared with composing the same
+   * stored inputs entirely in ComputeType, every element x of a result differs by at most u*|x|,
+   * the final rounding, plus n*epsilon(ComputeType) terms for a chain of n transforms. Composing in
+   * StorageType instead adds a rounding error at every step, so that error grows with n.
+   */
+  template<class StorageType, class ComputeType = double>
+  class SCREWS_EXPORT MixedPrecision
+  {
+  public:
+    /// @brief Multiply two stored transforms, computing in ComputeType.
+    /// @return A*B rounded to StorageType.
+    static HomogeneousTransform<StorageType> multiply(const HomogeneousTransform<StorageType>& A,
+                                                      const HomogeneousTransform<StorageType>& B)
+    {
+      Matrix3 Ra, Rb;
+      Vector3 Ta, Tb;
+      load(A, Ra, Ta);
+      load(B, Rb, Tb);
+
+      HomogeneousTransform<StorageType> H;
+      store(Ra*Rb, Ra*Tb + Ta, H);
+
+      return H;
+    }
+
+    /// @brief Element-by-element multiplication of two batches, out[i] = A[i]*B[i].
+    /// @param A the left-hand transforms.
+    /// @param B the right-hand transforms, same size as A.
+    /// @param out the products. Resized only if its size differs, so it can be reused across calls.
+    /// @throw screws::ScrewException if A and B differ in size.
+    static void multiply(const std::vector< HomogeneousTransform<StorageType> >& A,
+                         const std::vector< HomogeneousTransform<StorageType> >& B,
+                         std::vector< HomogeneousTransform<StorageType> >& out)
+    {
+      if (A.size() != B.size())
+      {
+        ScrewException e("Batches of different sizes.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      if (out.size() != A.size())
+      {
+        out.resize(A.size());
+      }
+
+      Matrix3 Ra, Rb;
+      Vector3 Ta, Tb;
+      for (size_t i = 0; i < A.size(); ++i)
+      {
+        load(A[i], Ra, Ta);
+        load(B[i], Rb, Tb);
+        store(Ra*Rb, Ra*Tb + Ta, out[i]);
+      }
+    }
+
+    /// @brief Running products out[i] = start*H[0]*...*H[i], accumulated in ComputeType.
+    /// @param H the stored transforms, e.g. the relative motions along a trajectory or down a kinematic tree branch.
+    /// @param out the running products. Resized only if its size differs, so it can be reused across calls.
+    /// @param start the transform the chain starts from [default: identity].
+    /// @return the final product in ComputeType, so that the next batch can continue without loss.
+    static HomogeneousTransform<ComputeType> accumulate(const std::vector< HomogeneousTransform<StorageType> >& H,
+                                                        std::vector< HomogeneousTransform<StorageType> >& out,
+                                                        const HomogeneousTransform<ComputeType>& start = HomogeneousTransform<ComputeType>())
+    {
+      if (out.size() != H.size())
+      {
+        out.resize(H.size());
+      }
+
+      Matrix3 Racc = start.rotation().matrix();
+      Vector3 Tacc = start.translation().vector();
+      Matrix3 R;
+      Vector3 T;
+      for (size_t i = 0; i < H.size(); ++i)
+      {
+        load(H[i], R, T);
+        Tacc += Racc*T;
+        Racc = Racc*R;
+        store(Racc, Tacc, out[i]);
+      }
+
+      HomogeneousTransform<ComputeType> result;
+      result.setUnchecked(Racc, Tacc);
+
+      return result;
+    }
+
+    /// @brief Convert a batch between number types, e.g. float storage to double.
+    /// @param in the transforms to convert.
+    /// @param out the converted transforms. Resized only if its size differs.
+    template<class FromType, class ToType>
+    static void convert(const std::vector< HomogeneousTransform<FromType> >& in,
+                        std::vector< HomogeneousTransform<ToType> >& out)
+    {
+      if (out.size() != in.size())
+      {
+        out.resize(in.size());
+      }
+
+      for (size_t i = 0; i < in.size(); ++i)
+      {
+        out[i] = in[i].template cast<ToType>();
+      }
+    }
+
+  protected:
+
+    typedef Eigen::Matrix<ComputeType, 3, 3> Matrix3;
+    typedef Eigen::Matrix<ComputeType, 3, 1> Vector3;
+
+    // Widen a stored transform to the computation type.
+    static void load(const HomogeneousTransform<StorageType>& H, Matrix3& R, Vector3& T)
+    {
+      R = H.rotation().matrix().template cast<ComputeType>();
+      T = H.translation().vector().template cast<ComputeType>();
+    }
+
+    // Round a computed transform to the storage type.
+    static void store(const Matrix3& R, const Vector3& T, HomogeneousTransform<StorageType>& H)
+    {
+      H.setUnchecked(R.template cast<StorageType>(), T.template cast<StorageType>());
+    }
+  };
+
+  // Convenience names
+  using MixedPrecisionf = MixedPrecision < float, double >;
+};
+
+#endif // MIXEDPRECISION_HPP
@@ -0,0 +1,94 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef NUMERICTRAITS_HPP
+#define NUMERICTRAITS_HPP
+
+#include "screwsInitLibrary.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace screws
+{
+  /*!
+   * \class NumericConstants
+   * \ingroup libScrews
+   * \brief Constants rounded once to NumType, so that single precision code does not promote through double.
+   */
+  template<class NumType>
+  struct NumericConstants
+  {
+    /// @brief pi in NumType precision.
+    static NumType pi() { return (NumType)M_PI; }
+    /// @brief pi/2 in NumType precision.
+    static NumType halfPi() { return (NumType)M_PI_2; }
+    /// @brief 2*pi in NumType precision.
+    static NumType twoPi() { return (NumType)(2*M_PI); }
+  };
+
+  /*!
+   * \class NumericTraits
+   * \ingroup libScrews
+   * \brief Tolerances used by the validity checks and the approximate comparisons, scaled to NumType,
+   * together with the NumericConstants.
+   * \note The generic version derives the tolerances from the machine epsilon. float and double
+   * are specialised below; specialise for custom number types, or pass an explicit tolerance
+   * at the call site to override the default.
+   */
+  template<class NumType>
+  struct NumericTraits : public NumericConstants<NumType>
+  {
+    /// @brief Default precision of the approxEq comparisons.
+    static NumType comparisonTolerance()
+    {
+      return std::sqrt(std::numeric_limits<NumType>::epsilon());
+    }
+
+    /// @brief Allowed deviation from orthonormality (or skew symmetry) before isValid fails.
+    static NumType validationTolerance()
+    {
+      return (NumType)16*std::sqrt(std::numeric_limits<NumType>::epsilon());
+    }
+
+    /// @brief Magnitude below which a norm is treated as zero.
+    static NumType zeroTolerance()
+    {
+      return (NumType)16*std::numeric_limits<NumType>::epsilon();
+    }
+  };
+
+  /// @brief Tolerances for single precision. A few hundred ulps, so that chains of float
+  /// operations do not throw spuriously.
+  template<>
+  struct NumericTraits<float> : public NumericConstants<float>
+  {
+    static float comparisonTolerance() { return 1e-5f; }
+    static float validationTolerance() { return 1e-4f; }
+    static float zeroTolerance() { return 1e-6f; }
+  };
+
+  /// @brief Tolerances for double precision.
+  template<>
+  struct NumericTraits<double> : public NumericConstants<double>
+  {
+    static double comparisonTolerance() { return 1e-8; }
+    static double validationTolerance() { return 1e-6; }
+    static double zeroTolerance() { return 1e-10; }
+  };
+};
+
+#endif // NUMERICTRAITS_HPP
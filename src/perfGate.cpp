@@ -0,0 +1,490 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Performance regression gate.
+// Runs a fixed set of library microbenchmarks and compares their median time per operation with a
+// baseline checked into the repository (perfBaseline.json), failing if any is slower by more than
+// the threshold. Registered with CTest in Release builds; see CMakeLists.txt.
+//
+// Timings depend on the machine and its load, so every repetition is preceded by a short
+// calibration loop (plain 3x3 products, square roots and sines) and the median of the
+// per-repetition ratios is compared with the baseline; a clock change or a busy sibling core then
+// slows both. The benchmarks are interleaved, one repetition of each per round, so that a burst of
+// interference costs each benchmark a few samples rather than one benchmark all of them. The
+// reported times are the ratios times the fastest calibration run. Noise is further reduced by
+// pinning the process to one CPU and a warm-up run. Benchmarks over the threshold are measured
+// again after a pause, and the best median counts, so that a slowdown must persist to fail the
+// gate.
+//
+// Usage: perfGateScrews [--baseline file] [--threshold fraction] [--reps n] [--retries n] [--write file] [--no-pin]
+//   --threshold 0.5 fails on a slowdown above 50% [default].
+//   --retries 3 measures the benchmarks over the threshold up to 3 more times [default].
+//   --write stores the measured medians as a new baseline instead of comparing.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include "chain.hpp"
+
+static volatile double sink = 0;
+
+// Nanoseconds per operation of a single run of f(), which performs n operations.
+template<class Function>
+double timePerOp(Function f, const size_t& n)
+{
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  f();
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count()/n;
+}
+
+// Reference work in nanoseconds per step. Each step is a 3x3 product, a square root, a division and
+// a sine on data in L1, a mix like that of the benchmarks, so that it slows down with them when the
+// core is shared or throttled. Written as plain loops, so that it does not change with the library.
+double calibrationRun(const size_t& steps)
+{
+  static double m[64][9];
+  static bool initialised = false;
+  if (!initialised)
+  {
+    for (int k = 0; k < 64; ++k)
+    {
+      for (int e = 0; e < 9; ++e)
+      {
+        m[k][e] = 0.5 + 0.01*((k*9 + e) % 17);
+      }
+    }
+    initialised = true;
+  }
+
+  return timePerOp([&]()
+  {
+    double acc = sink;
+    for (size_t i = 0; i < steps; ++i)
+    {
+      const double* a = m[i & 63];
+      const double* b = m[(i + 1) & 63];
+      double c[9];
+      for (int r = 0; r < 3; ++r)
+      {
+        for (int col = 0; col < 3; ++col)
+        {
+          c[3*r + col] = a[3*r]*b[col] + a[3*r + 1]*b[3 + col] + a[3*r + 2]*b[6 + col];
+        }
+      }
+      acc += std::sqrt(c[0]*c[0] + c[4]*c[4] + c[8]*c[8])/(1.0 + std::abs(c[1])) + std::sin(c[2] + acc*1e-9);
+    }
+    sink = acc;
+  }, steps);
+}
+
+// A benchmark: run() performs n operations.
+struct Benchmark
+{
+  std::string name;
+  std::function<void()> run;
+  size_t n;
+};
+
+// Median over reps of the time per operation of each benchmark divided by the calibration time just
+// before it. The benchmarks are run in turn in every round, so that a burst of interference longer
+// than one benchmark spreads over a few samples of many benchmarks instead of all samples of one.
+std::vector<double> medianRatios(const std::vector<Benchmark>& benchmarks, const int& reps)
+{
+  std::vector< std::vector<double> > ratios(benchmarks.size(), std::vector<double>(reps));
+  for (size_t k = 0; k < benchmarks.size(); ++k)
+  {
+    benchmarks[k].run();
+  }
+  for (int r = 0; r < reps; ++r)
+  {
+    for (size_t k = 0; k < benchmarks.size(); ++k)
+    {
+      double calibration = calibrationRun(1 << 8);
+      ratios[k][r] = timePerOp(benchmarks[k].run, benchmarks[k].n)/calibration;
+    }
+  }
+
+  std::vector<double> medians(benchmarks.size());
+  for (size_t k = 0; k < benchmarks.size(); ++k)
+  {
+    std::nth_element(ratios[k].begin(), ratios[k].begin() + reps/2, ratios[k].end());
+    medians[k] = ratios[k][reps/2];
+  }
+  return medians;
+}
+
+// Pin to the CPU the process is running on, so that the repetitions do not migrate.
+bool pinToCurrentCpu(int& cpu)
+{
+#ifdef __linux__
+  cpu = sched_getcpu();
+  if (cpu < 0)
+  {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  cpu = -1;
+  return false;
+#endif
+}
+
+// Reads the flat baseline format written by writeBaseline().
+bool readBaseline(const std::string& filename, double& calibration, std::map<std::string, double>& medians)
+{
+  std::ifstream file(filename.c_str());
+  if (!file)
+  {
+    return false;
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  const std::string text = ss.str();
+
+  calibration = 0;
+  size_t at = 0;
+  while ((at = text.find('"', at)) != std::string::npos)
+  {
+    size_t end = text.find('"', at + 1);
+    size_t colon = text.find(':', end);
+    if (end == std::string::npos || colon == std::string::npos)
+    {
+      break;
+    }
+    const std::string key = text.substr(at + 1, end - at - 1);
+    const char* value = text.c_str() + colon + 1;
+    char* parsed = 0;
+    double number = std::strtod(value, &parsed);
+    if (parsed != value)
+    {
+      if (key == "calibration")
+      {
+        calibration = number;
+      }
+      else
+      {
+        medians[key] = number;
+      }
+    }
+    at = colon + 1;
+  }
+  return calibration > 0;
+}
+
+bool writeBaseline(const std::string& filename, const double& calibration,
+                   const std::vector< std::pair<std::string, double> >& medians)
+{
+  std::ofstream file(filename.c_str());
+  file << std::fixed << std::setprecision(3);
+  file << "{\n  \"calibration\": " << calibration << ",\n  \"benchmarks\": {\n";
+  for (size_t k = 0; k < medians.size(); ++k)
+  {
+    file << "    \"" << medians[k].first << "\": " << medians[k].second << (k + 1 < medians.size() ? ",\n" : "\n");
+  }
+  file << "  }\n}\n";
+  return (bool)file;
+}
+
+// The inputs and outputs of the benchmarks of one number type. Results are stored in full, so that
+// the compiler cannot drop the elements that are not read.
+template<class NumType>
+struct Fixture
+{
+  static const size_t n = 1 << 10;
+
+  std::vector< screws::Skew<NumType> > S;
+  std::vector< screws::Twist<NumType> > Tw;
+  std::vector< screws::Rotation<NumType> > R;
+  std::vector< screws::HomogeneousTransform<NumType> > H;
+  std::vector<NumType> theta;
+  screws::Chain<NumType> arm;
+  std::vector<NumType> q;
+
+  std::vector< screws::Rotation<NumType> > outR;
+  std::vector< screws::HomogeneousTransform<NumType> > outH;
+  std::vector< screws::Twist<NumType> > outTw;
+  std::vector< screws::Vector3<NumType> > outV;
+  screws::HomogeneousTransform<NumType> out;
+  typename screws::Chain<NumType>::Jacobian J;
+
+  Fixture()
+    : S(n), Tw(n), R(n), H(n + 1), theta(n), q(7*n), outR(n), outH(n), outTw(n), outV(n), J(6, 7)
+  {
+    srand(1);
+    for (size_t i = 0; i < n; ++i)
+    {
+      screws::Vector3<NumType> w((NumType)((double)rand()/RAND_MAX + 0.1),
+                                 (NumType)((double)rand()/RAND_MAX),
+                                 (NumType)((double)rand()/RAND_MAX));
+      w = w/w.norm();
+      theta[i] = (NumType)(6*(double)rand()/RAND_MAX);
+      S[i] = screws::Skew<NumType>(w);
+      Tw[i] = screws::Twist<NumType>((NumType)1, (NumType)2, (NumType)3, w(0), w(1), w(2));
+      R[i] = S[i].exp(theta[i]);
+      H[i] = Tw[i].exp(theta[i]);
+    }
+    H[n] = H[0];
+
+    // A 7 DoF arm in product of exponentials form, revolute joints alternating between z and y.
+    const NumType heights[7] = { (NumType)0.34, (NumType)0.34, (NumType)0.74, (NumType)0.74, (NumType)1.14, (NumType)1.14, (NumType)1.27 };
+    for (int j = 0; j < 7; ++j)
+    {
+      if (j % 2 == 0)
+      {
+        arm.addJoint(screws::Twist<NumType>(0, 0, 0, 0, 0, 1));
+      }
+      else
+      {
+        // v = -w x q for w = y and q = (0, 0, h)
+        arm.addJoint(screws::Twist<NumType>(heights[j], 0, 0, 0, 1, 0));
+      }
+    }
+    arm.setHome(screws::HomogeneousTransform<NumType>(screws::Rotation<NumType>(), screws::Translation<NumType>(0, 0, (NumType)1.35)));
+    for (size_t i = 0; i < q.size(); ++i)
+    {
+      q[i] = (NumType)(2*(double)rand()/RAND_MAX - 1);
+    }
+  }
+
+  // Appends the benchmarks, named with the given type suffix.
+  void add(const std::string& type, std::vector<Benchmark>& benchmarks)
+  {
+    Benchmark b[] = {
+      { "Skew::exp " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outR[i] = S[i].exp(theta[i]);
+          sink = sink + outR[n/2](0, 1);
+        }, n },
+      { "Twist::exp " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outH[i] = Tw[i].exp(theta[i]);
+          sink = sink + outH[n/2](0, 3);
+        }, n },
+      { "HomogeneousTransform::operator* " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outH[i] = H[i]*H[i + 1];
+          sink = sink + outH[n/2](0, 3);
+        }, n },
+      { "HomogeneousTransform::inv " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outH[i] = H[i].inv();
+          sink = sink + outH[n/2](0, 3);
+        }, n },
+      { "HomogeneousTransform::log " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outTw[i] = H[i].log();
+          sink = sink + outTw[n/2].velocity()(0);
+        }, n },
+      { "Rotation::rpy " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) outV[i] = R[i].rpy();
+          sink = sink + outV[n/2](0);
+        }, n },
+      { "Chain::forwardKinematics 7 DoF " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) { arm.forwardKinematics(&q[7*i], out); sink = sink + out(0, 3); }
+        }, n },
+      { "Chain::spatialJacobian 7 DoF " + type, [this]()
+        {
+          for (size_t i = 0; i < n; ++i) { arm.spatialJacobian(&q[7*i], J); sink = sink + J(0, 6); }
+        }, n }
+    };
+    benchmarks.insert(benchmarks.end(), b, b + sizeof(b)/sizeof(b[0]));
+  }
+};
+
+int main(int argc, char** argv)
+{
+  std::string baseline = "perfBaseline.json", output;
+  double threshold = 0.5;
+  int reps = 51;
+  int retries = 3;
+  bool pin = true;
+  for (int a = 1; a < argc; ++a)
+  {
+    if (std::strcmp(argv[a], "--baseline") == 0 && a + 1 < argc)
+    {
+      baseline = argv[++a];
+    }
+    else if (std::strcmp(argv[a], "--threshold") == 0 && a + 1 < argc)
+    {
+      threshold = std::atof(argv[++a]);
+    }
+    else if (std::strcmp(argv[a], "--reps") == 0 && a + 1 < argc)
+    {
+      reps = std::max(1, std::atoi(argv[++a]));
+    }
+    else if (std::strcmp(argv[a], "--retries") == 0 && a + 1 < argc)
+    {
+      retries = std::max(0, std::atoi(argv[++a]));
+    }
+    else if (std::strcmp(argv[a], "--write") == 0 && a + 1 < argc)
+    {
+      output = argv[++a];
+    }
+    else if (std::strcmp(argv[a], "--no-pin") == 0)
+    {
+      pin = false;
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--baseline file] [--threshold fraction] [--reps n] [--retries n] [--write file] [--no-pin]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+#if defined(__GNUC__) && !defined(__OPTIMIZE__)
+  std::cout << "Warning: built without optimisation, timings are not representative." << std::endl;
+#endif
+
+  int cpu = -1;
+  if (pin)
+  {
+    if (pinToCurrentCpu(cpu))
+    {
+      std::cout << "Pinned to CPU " << cpu << "." << std::endl;
+    }
+    else
+    {
+      std::cout << "Could not pin to a CPU, timings may be noisier." << std::endl;
+    }
+  }
+
+  // The fastest calibration run converts the ratios to nanoseconds for the report and the baseline file.
+  double calibration = 1e300;
+  for (int r = 0; r < reps; ++r)
+  {
+    calibration = std::min(calibration, calibrationRun(1 << 12));
+  }
+
+  Fixture<double> doubles;
+  Fixture<float> floats;
+  std::vector<Benchmark> benchmarks;
+  doubles.add("double", benchmarks);
+  floats.add("float", benchmarks);
+
+  std::vector<double> ratios = medianRatios(benchmarks, reps);
+  std::vector< std::pair<std::string, double> > medians;
+  for (size_t k = 0; k < benchmarks.size(); ++k)
+  {
+    medians.push_back(std::make_pair(benchmarks[k].name, ratios[k]*calibration));
+  }
+
+  if (!output.empty())
+  {
+    if (!writeBaseline(output, calibration, medians))
+    {
+      std::cerr << "Cannot write " << output << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Baseline of " << medians.size() << " benchmarks written to " << output << "." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  double baseCalibration = 0;
+  std::map<std::string, double> base;
+  if (!readBaseline(baseline, baseCalibration, base))
+  {
+    std::cerr << "Cannot read the baseline " << baseline << "." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Ratio of the normalised medians; > 1 + threshold is a regression.
+  auto ratio = [&](const size_t& k)
+  {
+    std::map<std::string, double>::const_iterator b = base.find(medians[k].first);
+    return (b == base.end() || b->second <= 0) ? 0.0 : (medians[k].second/calibration)/(b->second/baseCalibration);
+  };
+
+  for (int attempt = 0; attempt < retries; ++attempt)
+  {
+    std::vector<Benchmark> suspects;
+    std::vector<size_t> index;
+    for (size_t k = 0; k < medians.size(); ++k)
+    {
+      if (ratio(k) > 1 + threshold)
+      {
+        suspects.push_back(benchmarks[k]);
+        index.push_back(k);
+      }
+    }
+    if (suspects.empty())
+    {
+      break;
+    }
+    std::cout << "Measuring " << suspects.size() << " benchmark(s) over the threshold again." << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(attempt + 1));
+    std::vector<double> again = medianRatios(suspects, reps);
+    for (size_t j = 0; j < index.size(); ++j)
+    {
+      medians[index[j]].second = std::min(medians[index[j]].second, again[j]*calibration);
+    }
+  }
+
+  std::cout << "Calibration " << std::fixed << std::setprecision(3) << calibration << " ns, baseline "
+            << baseCalibration << " ns; threshold " << std::setprecision(0) << 100*threshold << "%." << std::endl;
+  std::cout << std::left << std::setw(44) << "benchmark" << std::right << std::setw(12) << "ns/op"
+            << std::setw(12) << "baseline" << std::setw(10) << "ratio" << std::endl;
+  int regressions = 0;
+  for (size_t k = 0; k < medians.size(); ++k)
+  {
+    std::cout << std::left << std::setw(44) << medians[k].first << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << medians[k].second;
+    std::map<std::string, double>::const_iterator b = base.find(medians[k].first);
+    if (b == base.end() || b->second <= 0)
+    {
+      std::cout << std::setw(12) << "-" << std::setw(10) << "-" << "  new" << std::endl;
+      continue;
+    }
+    bool regressed = (ratio(k) > 1 + threshold);
+    regressions += regressed ? 1 : 0;
+    std::cout << std::setw(12) << b->second << std::setw(10) << ratio(k) << (regressed ? "  REGRESSION" : "  ok") << std::endl;
+  }
+
+  if (regressions > 0)
+  {
+    std::cout << regressions << " benchmark(s) regressed by more than " << std::setprecision(0) << 100*threshold << "%." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "No regressions." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -19,8 +19,12 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
 #include <Eigen/Eigen>
 #include <cfloat>
+#include <iostream>
 
 namespace screws
 {
@@ -43,6 +47,8 @@ namespace screws
     template<class NumTypeTrans> friend class Translation;
     template<class NumTypeSkew> friend class Skew;
     template<class NumTypeTwist> friend class Twist;
+    template<class NumTypeOther> friend class Rotation;
+    template<class NumTypeHomo> friend class HomogeneousTransform;
 
     /// @brief Construct a 3x3 identity rotation matrix.
     explicit Rotation()
@@ -137,10 +143,15 @@ namespace screws
     }
 
     /// Default destructor.
-    ~Rotation()
-    {
+    ~Rotation() = default;
 
-    }
+    /// @brief Copy and move constructors: plain copies of the 3x3 storage, without validation.
+    Rotation(const Rotation<NumType>&) = default;
+    Rotation(Rotation<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    Rotation<NumType>& operator=(const Rotation<NumType>&) = default;
+    Rotation<NumType>& operator=(Rotation<NumType>&&) = default;
 
     /// @brief Return the axis of rotation.
     /// @return the axis of rotation as a 3x1 vector.
@@ -175,46 +186,52 @@ namespace screws
       NumType roll, pitch, yaw;
       NumType alpha, beta, gamma;
 
-      beta = atan2(-_data(2, 0), sqrt(_data(0, 0)*_data(0, 0) + _data(1, 0)*_data(1, 0)));
-      if (fabs(beta - M_PI/2) < FLT_EPSILON)
+      const NumType eps = NumericTraits<NumType>::comparisonTolerance();
+      const NumType pi = NumericTraits<NumType>::pi();
+      const NumType halfPi = NumericTraits<NumType>::halfPi();
+      const NumType twoPi = NumericTraits<NumType>::twoPi();
+
+      beta = MathPolicy<NumType>::atan2(-_data(2, 0), MathPolicy<NumType>::sqrt(_data(0, 0)*_data(0, 0) + _data(1, 0)*_data(1, 0)));
+      if (std::fabs(beta - halfPi) < eps)
       {
         alpha = 0;
-        gamma = atan2(_data(0, 1), _data(1, 1));
+        gamma = MathPolicy<NumType>::atan2(_data(0, 1), _data(1, 1));
       }
-      else if (fabs(beta + M_PI/2) < FLT_EPSILON)
+      else if (std::fabs(beta + halfPi) < eps)
       {
         alpha = 0;
-        gamma = -atan2(_data(0, 1), _data(1, 1));
+        gamma = -MathPolicy<NumType>::atan2(_data(0, 1), _data(1, 1));
       }
       else
       {
-        alpha = atan2(_data(1, 0)/cos(beta), _data(0, 0)/cos(beta));
-        gamma = atan2(_data(2, 1)/cos(beta), _data(2, 2)/cos(beta));
+        NumType cb = MathPolicy<NumType>::cos(beta);
+        alpha = MathPolicy<NumType>::atan2(_data(1, 0)/cb, _data(0, 0)/cb);
+        gamma = MathPolicy<NumType>::atan2(_data(2, 1)/cb, _data(2, 2)/cb);
       }
 
       roll = gamma;
       pitch = beta;
       yaw = alpha;
 
-      if (fabs(roll - M_PI) < FLT_EPSILON && fabs(yaw - M_PI) < FLT_EPSILON)
+      if (std::fabs(roll - pi) < eps && std::fabs(yaw - pi) < eps)
       {
         roll = 0;
         yaw = 0;
-        pitch = M_PI - pitch;
+        pitch = pi - pitch;
       }
 
       if (roll < 0)
       {
-        roll += 2*M_PI;
+        roll += twoPi;
       }
       if (pitch < 0)
       {
-        pitch += 2*M_PI;
+        pitch += twoPi;
       }
 
       if (yaw < 0)
       {
-        yaw += 2*M_PI;
+        yaw += twoPi;
       }
 
       v(0) = roll;
@@ -226,19 +243,42 @@ namespace screws
 
     /// @brief Invert by taking the transpose.
     /// @return the inverted rotation matrix.
+    /// @note The transpose of a valid rotation is valid, so it is not re-validated.
     Rotation<NumType> inv() const
     {
-      Eigen::Matrix<NumType, 3, 3, 0, 3, 3> newData = _data.transpose();
-
       Rotation<NumType> RtoReturn;
-      
-      RtoReturn.setData(newData(0, 0), newData(0, 1), newData(0, 2),
-        newData(1, 0), newData(1, 1), newData(1, 2),
-        newData(2, 0), newData(2, 1), newData(2, 2));
-      
+      invInto(RtoReturn, *this);
+
       return RtoReturn;
     }
 
+    /// @brief out = R.inv(), reusing the storage of out.
+    /// @param out the result; may be R.
+    static void invInto(Rotation<NumType>& out, const Rotation<NumType>& R)
+    {
+      if (&out == &R)
+      {
+        out._data.transposeInPlace();
+      }
+      else
+      {
+        out._data = R._data.transpose();
+      }
+    }
+
+    /// @brief Convert to another number type, e.g. Rotationd to Rotationf.
+    /// @return the rotation with elements rounded to NewNumType.
+    /// @note The result is not re-validated. A valid double rotation stays valid within
+    /// the float tolerance; a float rotation keeps its float accuracy when converted to double.
+    template<class NewNumType>
+    Rotation<NewNumType> cast() const
+    {
+      Rotation<NewNumType> R;
+      R._data = _data.template cast<NewNumType>();
+
+      return R;
+    }
+
     /// @brief Return the skew (log) symmetric matrix corresponding to this rotation.
     /// @return: the skew symmetric matrix.
     Skew<NumType> log() const
@@ -263,18 +303,53 @@ namespace screws
       return _data(i, j);
     }
 
+    /// @brief The 3x3 storage, for Eigen expressions in kernels built on rotations.
+    const Eigen::Matrix<NumType, 3, 3>& matrix() const
+    {
+      return _data;
+    }
+
+    /// @brief Overwrite the matrix, e.g. with a product of rotations formed in a kernel.
+    /// @param R a 3x3 Eigen matrix or expression.
+    /// @note Unlike the column constructor, orthonormality is not checked; R must be a rotation.
+    template<class Derived>
+    void setMatrixUnchecked(const Eigen::MatrixBase<Derived>& R)
+    {
+      _data = R;
+    }
+
     /// @brief Multiplication operator.
+    /// @note Products of valid rotations are valid to rounding and are not re-validated, as for *=.
     Rotation<NumType> operator *(const Rotation<NumType>& R) const
     {
-      Eigen::Matrix<NumType, 3, 3, 0, 3, 3> newData = _data*R._data;
-
       Rotation<NumType> RtoReturn;
-      RtoReturn.setData(newData(0, 0), newData(0, 1), newData(0, 2),
-        newData(1, 0), newData(1, 1), newData(1, 2),
-        newData(2, 0), newData(2, 1), newData(2, 2));
-      
+      mulInto(RtoReturn, *this, R);
+
       return RtoReturn;
     }
+
+    /// @brief out = A*B, reusing the storage of out.
+    /// @param out the result; may be A or B, at the cost of a copy through a temporary.
+    static void mulInto(Rotation<NumType>& out, const Rotation<NumType>& A, const Rotation<NumType>& B)
+    {
+      if (&out == &A || &out == &B)
+      {
+        Eigen::Matrix<NumType, 3, 3> product;
+        product.noalias() = A._data*B._data;
+        out._data = product;
+      }
+      else
+      {
+        out._data.noalias() = A._data*B._data;
+      }
+    }
+
+    /// @brief out = R*T, reusing the storage of out.
+    /// @param out the result; may be T.
+    static void mulInto(Vector3<NumType>& out, const Rotation<NumType>& R, const Vector3<NumType>& T)
+    {
+      out._data = R._data*T._data;
+    }
     /// @brief In-place multiplication operator.
     const Rotation<NumType>& operator *=(const Rotation<NumType>& R)
     {
@@ -311,18 +386,19 @@ namespace screws
     
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param R compared rotation.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const Rotation<NumType>& R, double eps = FLT_EPSILON) const
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const Rotation<NumType>& R,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
-      if (fabs(R(0, 0) - _data(0, 0)) < eps &&
-          fabs(R(1, 0) - _data(1, 0)) < eps &&
-          fabs(R(2, 0) - _data(2, 0)) < eps &&
-          fabs(R(0, 1) - _data(0, 1)) < eps &&
-          fabs(R(1, 1) - _data(1, 1)) < eps &&
-          fabs(R(2, 1) - _data(2, 1)) < eps &&
-          fabs(R(0, 2) - _data(0, 2)) < eps &&
-          fabs(R(1, 2) - _data(1, 2)) < eps &&
-          fabs(R(2, 2) - _data(2, 2)) < eps)
+      if (std::fabs(R(0, 0) - _data(0, 0)) < eps &&
+          std::fabs(R(1, 0) - _data(1, 0)) < eps &&
+          std::fabs(R(2, 0) - _data(2, 0)) < eps &&
+          std::fabs(R(0, 1) - _data(0, 1)) < eps &&
+          std::fabs(R(1, 1) - _data(1, 1)) < eps &&
+          std::fabs(R(2, 1) - _data(2, 1)) < eps &&
+          std::fabs(R(0, 2) - _data(0, 2)) < eps &&
+          std::fabs(R(1, 2) - _data(1, 2)) < eps &&
+          std::fabs(R(2, 2) - _data(2, 2)) < eps)
       {
         return true;
       }
@@ -341,33 +417,45 @@ namespace screws
     }
 
     /// @brief Perform verification that matrix is indeed in approriate format,
-    /// by checking if the determinant is zero, and if the columns are othogonal
-    /// to each other and of magnitude one.
+    /// by checking if the columns are othogonal to each other and of magnitude one,
+    /// and if they form a right-handed system.
+    /// @param eps allowed deviation [default: NumericTraits<NumType>::validationTolerance()].
     /// @return true if the rotation is valid, false otherwise.
     /// @throw scews::ScrewException for invalid rotation.
-    bool isValid() const
+    /// @note Only squared norms and dot products are used. Once the columns are orthonormal
+    /// the determinant is +/-1, so only the sign of c0.(c1 x c2) is checked.
+    bool isValid(const NumType& eps = NumericTraits<NumType>::validationTolerance()) const
     {
-      double determinant = _data.determinant();
-      double col0norm = _data(0, 0) * _data(0, 0) + _data(1, 0) * _data(1, 0) + _data(2, 0) * _data(2, 0);
-      double col1norm = _data(0, 1) * _data(0, 1) + _data(1, 1) * _data(1, 1) + _data(2, 1) * _data(2, 1);
-      double col2norm = _data(0, 2) * _data(0, 2) + _data(1, 2) * _data(1, 2) + _data(2, 2) * _data(2, 2);
+      SCREWS_INSTRUMENT(ROTATION_IS_VALID);
+      NumType col0norm = _data(0, 0) * _data(0, 0) + _data(1, 0) * _data(1, 0) + _data(2, 0) * _data(2, 0);
+      NumType col1norm = _data(0, 1) * _data(0, 1) + _data(1, 1) * _data(1, 1) + _data(2, 1) * _data(2, 1);
+      NumType col2norm = _data(0, 2) * _data(0, 2) + _data(1, 2) * _data(1, 2) + _data(2, 2) * _data(2, 2);
 
-      double col01norm = _data(0, 0) * _data(0, 1) + _data(1, 0) * _data(1, 1) + _data(2, 0) * _data(2, 1);
-      double col02norm = _data(0, 0) * _data(0, 2) + _data(1, 0) * _data(1, 2) + _data(2, 0) * _data(2, 2);
-      double col12norm = _data(0, 1) * _data(0, 2) + _data(1, 1) * _data(1, 2) + _data(2, 1) * _data(2, 2);
+      NumType col01norm = _data(0, 0) * _data(0, 1) + _data(1, 0) * _data(1, 1) + _data(2, 0) * _data(2, 1);
+      NumType col02norm = _data(0, 0) * _data(0, 2) + _data(1, 0) * _data(1, 2) + _data(2, 0) * _data(2, 2);
+      NumType col12norm = _data(0, 1) * _data(0, 2) + _data(1, 1) * _data(1, 2) + _data(2, 1) * _data(2, 2);
 
-      bool validity = (fabs(determinant - 1.0) < FLT_EPSILON &&
-        fabs(col0norm - 1) < FLT_EPSILON && fabs(col1norm - 1) < FLT_EPSILON && fabs(col2norm - 1) < FLT_EPSILON &&
-        fabs(col01norm) < FLT_EPSILON && fabs(col02norm) < FLT_EPSILON && fabs(col12norm) < FLT_EPSILON);
+      bool validity = (std::fabs(col0norm - 1) < eps && std::fabs(col1norm - 1) < eps && std::fabs(col2norm - 1) < eps &&
+        std::fabs(col01norm) < eps && std::fabs(col02norm) < eps && std::fabs(col12norm) < eps);
+
+      NumType determinant = (NumType)0;
+      if (validity)
+      {
+        determinant = _data(0, 0) * (_data(1, 1) * _data(2, 2) - _data(2, 1) * _data(1, 2)) +
+                      _data(1, 0) * (_data(2, 1) * _data(0, 2) - _data(0, 1) * _data(2, 2)) +
+                      _data(2, 0) * (_data(0, 1) * _data(1, 2) - _data(1, 1) * _data(0, 2));
+        validity = (determinant > 0);
+      }
 
       if (!validity)
       {
+        SCREWS_COUNT(VALIDATION_FAILURES);
         char s[200];
         sprintf(s, "Determinant: %f,\n"
                    "col0norm = %f, col1norm = %f, col2norm = %f,\n"
                    "col01norm = %f, col02norm = %f, col12norm = %f",
-                   determinant, col0norm, col1norm, col2norm,
-                   col01norm, col02norm, col12norm);
+                   (double)determinant, (double)col0norm, (double)col1norm, (double)col2norm,
+                   (double)col01norm, (double)col02norm, (double)col12norm);
         throw ScrewException(s, __FILE__, __FUNCTION__, __LINE__);
       }
       return true;
@@ -381,15 +469,15 @@ namespace screws
       const NumType& uz,
       const NumType& theta)
     {
-      if (theta < 0 || theta >= 2*M_PI)
+      if (theta < 0 || theta >= NumericTraits<NumType>::twoPi())
       {
         ScrewException s("Only angles within [0, 2pi) are supported", __FILE__,
                          __FUNCTION__, __LINE__);
         throw s;
       }
 
-      NumType cs = cos(theta);
-      NumType ss = sin(theta);
+      NumType cs, ss;
+      MathPolicy<NumType>::sinCos(theta, ss, cs);
 
       _data(0, 0) = cs + ux*ux*(1 - cs);
       _data(0, 1) = ux*uy*(1 - cs) - uz*ss;
@@ -409,6 +497,7 @@ namespace screws
       const NumType& r10, const NumType& r11, const NumType& r12,
       const NumType& r20, const NumType& r21, const NumType& r22)
     {
+      SCREWS_INSTRUMENT(ROTATION_SET_DATA);
       _data(0, 0) = r00; _data(0, 1) = r01; _data(0, 2) = r02;
       _data(1, 0) = r10; _data(1, 1) = r11; _data(1, 2) = r12;
       _data(2, 0) = r20; _data(2, 1) = r21; _data(2, 2) = r22;
@@ -432,28 +521,49 @@ namespace screws
     }
     
     // Calculates the axis and the angle in one go.
-    void calculateAxisAndAngle(Vector3<NumType>& axisVec, NumType& angleVal) const
+    // The angle is recovered with atan2(sin, cos), which is accurate over the whole range,
+    // unlike acos(cos) close to 0 and pi. Unless principal is set, the axis is flipped to keep its
+    // first coordinate non-negative and the angle becomes 2pi - angle; the principal angle is in [0, pi].
+    void calculateAxisAndAngle(Vector3<NumType>& axisVec, NumType& angleVal, bool principal = false) const
     {
-      NumType tr = (NumType)(0.5)*(_data(0, 0) + _data(1, 1) + _data(2, 2) - 1);
+      // 2*cos(angle) and 2*sin(angle)*axis
+      NumType cs2 = _data(0, 0) + _data(1, 1) + _data(2, 2) - 1;
 
-      // Only in case of numerical errors
-      if (tr < -1)
-      {
-        tr = (NumType)(-1);
-      }
-      else if (tr > 1)
-      {
-        tr = (NumType)(1);
-      }
-
-      angleVal = (NumType)acos(tr);
-      
       axisVec(0) = _data(2, 1) - _data(1, 2);
       axisVec(1) = _data(0, 2) - _data(2, 0);
       axisVec(2) = _data(1, 0) - _data(0, 1);
 
       NumType normV = axisVec.norm();
-      if (fabs(normV) > 1e-10)
+      angleVal = MathPolicy<NumType>::atan2(normV, cs2);
+
+      if (cs2 < 0)
+      {
+        // Close to pi the antisymmetric part vanishes. Take the axis from the symmetric part,
+        // (R + R^T)/2 - cos(angle)*I = (1 - cos(angle))*axis*axis^T, using its largest diagonal
+        // element, and the sign from the antisymmetric part.
+        NumType cs = (NumType)(0.5)*cs2;
+        int k = 0;
+        for (int i = 1; i < 3; ++i)
+        {
+          if (_data(i, i) > _data(k, k))
+          {
+            k = i;
+          }
+        }
+        NumType scale = (NumType)1/std::sqrt((_data(k, k) - cs)*(1 - cs));
+        Vector3<NumType> symAxis;
+        for (int i = 0; i < 3; ++i)
+        {
+          symAxis(i) = (i == k) ? (_data(k, k) - cs)*scale :
+                                  (NumType)(0.5)*(_data(i, k) + _data(k, i))*scale;
+        }
+        if (symAxis.dot(axisVec) < 0)
+        {
+          symAxis = (NumType)(-1)*symAxis;
+        }
+        axisVec = symAxis;
+      }
+      else if (normV > NumericTraits<NumType>::zeroTolerance())
       {
         axisVec /= normV;
       }
@@ -464,10 +574,10 @@ namespace screws
         axisVec(2) = 1;
       }
 
-      if (axisVec(0) < 0)
+      if (!principal && axisVec(0) < 0)
       {
-        axisVec = -1.0*axisVec;
-        angleVal = (NumType)(2 * M_PI) - angleVal;
+        axisVec = (NumType)(-1)*axisVec;
+        angleVal = NumericTraits<NumType>::twoPi() - angleVal;
       }
     }
 
@@ -0,0 +1,227 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ROTATIONBATCH_HPP
+#define ROTATIONBATCH_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
+#include "rotation.hpp"
+#include <Eigen/Eigen>
+#include <algorithm>
+
+namespace screws
+{
+  /*!
+   * \class RotationBatch
+   * \ingroup libScrews
+   * \brief N rotations stored as structure of arrays: element (r, c) of all rotations is contiguous.
+   *
+   * This is the output of the batch kernels, e.g. Skew::exp over many angles. Loops over one plane
+   * map directly onto SIMD lanes. The rotations are not validated on the way in or out.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT RotationBatch
+  {
+  public:
+    /// @brief Create n identity rotations.
+    explicit RotationBatch(const size_t& n = 0)
+    {
+      resize(n);
+    }
+
+    /// Default destructor.
+    ~RotationBatch()
+    {
+
+    }
+
+    /// @return the number of rotations.
+    size_t size() const
+    {
+      return (size_t)_data.rows();
+    }
+
+    /// @brief Change the number of rotations. Nothing is reallocated if the size is unchanged,
+    /// so a batch can be reused across calls; new contents are identities.
+    void resize(const size_t& n)
+    {
+      if ((size_t)_data.rows() != n)
+      {
+        _data.resize(n, 9);
+        setIdentity();
+      }
+    }
+
+    /// @brief Set every rotation to the identity.
+    void setIdentity()
+    {
+      _data.setZero();
+      _data.col(0).setOnes();
+      _data.col(4).setOnes();
+      _data.col(8).setOnes();
+    }
+
+    /// @brief Contiguous array with element (r, c) of every rotation.
+    NumType* plane(const unsigned int& r, const unsigned int& c)
+    {
+      assert(r < 3 && c < 3);
+      return _data.col(r + 3*c).data();
+    }
+
+    /// @brief Contiguous array with element (r, c) of every rotation (read).
+    const NumType* plane(const unsigned int& r, const unsigned int& c) const
+    {
+      assert(r < 3 && c < 3);
+      return _data.col(r + 3*c).data();
+    }
+
+    /// @brief Return element (r, c) of rotation i.
+    /// @note No boundary check is performed.
+    const NumType& operator () (const unsigned int& r, const unsigned int& c, const size_t& i) const
+    {
+      assert(r < 3 && c < 3 && i < size());
+      return _data(i, r + 3*c);
+    }
+
+    /// @brief Copy out rotation i.
+    Rotation<NumType> rotation(const size_t& i) const
+    {
+      assert(i < size());
+      Eigen::Matrix<NumType, 3, 3> E;
+      for (unsigned int j = 0; j < 9; ++j)
+      {
+        E(j) = _data(i, j);
+      }
+      Rotation<NumType> R;
+      R.setMatrixUnchecked(E);
+
+      return R;
+    }
+
+    /// @brief Overwrite rotation i.
+    void set(const size_t& i, const Rotation<NumType>& R)
+    {
+      assert(i < size());
+      for (unsigned int j = 0; j < 9; ++j)
+      {
+        _data(i, j) = R.matrix()(j);
+      }
+    }
+
+    /// @brief Batch logarithm: wx[i], wy[i], wz[i] are the coordinates of rotation(i).log(),
+    /// with the same axis and angle conventions as Rotation::calculateAxisAndAngle().
+    /// @param wx, wy, wz arrays of size() elements.
+    /// @param principal if true, the principal logs (angles in [0, pi]), see Skew(const Rotation&, bool).
+    /// @note Both the antisymmetric and the near-pi (symmetric part) axes are evaluated for every
+    /// rotation and the right one is selected, so that the loops have no branches.
+    void log(NumType* wx, NumType* wy, NumType* wz, bool principal = false) const
+    {
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
+      const NumType twoPi = NumericTraits<NumType>::twoPi();
+      const size_t n = size();
+
+      NumType cs2[BATCH_BLOCK] = {}, normV[BATCH_BLOCK] = {}, angle[BATCH_BLOCK];
+      for (size_t start = 0; start < n; start += BATCH_BLOCK)
+      {
+        const size_t m = std::min((size_t)BATCH_BLOCK, n - start);
+        const NumType* r00 = plane(0, 0) + start;
+        const NumType* r01 = plane(0, 1) + start;
+        const NumType* r02 = plane(0, 2) + start;
+        const NumType* r10 = plane(1, 0) + start;
+        const NumType* r11 = plane(1, 1) + start;
+        const NumType* r12 = plane(1, 2) + start;
+        const NumType* r20 = plane(2, 0) + start;
+        const NumType* r21 = plane(2, 1) + start;
+        const NumType* r22 = plane(2, 2) + start;
+
+        // 2*cos(angle) and |2*sin(angle)*axis|
+        for (size_t i = 0; i < m; ++i)
+        {
+          NumType vx = r21[i] - r12[i];
+          NumType vy = r02[i] - r20[i];
+          NumType vz = r10[i] - r01[i];
+          cs2[i] = r00[i] + r11[i] + r22[i] - 1;
+          normV[i] = std::sqrt(vx*vx + vy*vy + vz*vz);
+        }
+        MathPolicy<NumType>::atan2(normV, cs2, angle, m);
+
+        NumType ox[BATCH_BLOCK], oy[BATCH_BLOCK], oz[BATCH_BLOCK];
+        for (size_t i = 0; i < m; ++i)
+        {
+          NumType vx = r21[i] - r12[i];
+          NumType vy = r02[i] - r20[i];
+          NumType vz = r10[i] - r01[i];
+
+          // Axis from the antisymmetric part, or the z axis for the identity.
+          NumType tiny = (normV[i] > zero) ? (NumType)0 : (NumType)1;
+          NumType inv = (1 - tiny)/((normV[i] > zero) ? normV[i] : (NumType)1);
+          NumType ax = vx*inv;
+          NumType ay = vy*inv;
+          NumType az = vz*inv + tiny;
+
+          // Axis from the column of the symmetric part with the largest diagonal element.
+          NumType cs = (NumType)0.5*cs2[i];
+          bool k1 = r11[i] > r00[i];
+          NumType d = k1 ? r11[i] : r00[i];
+          bool k2 = r22[i] > d;
+          d = k2 ? r22[i] : d;
+          NumType dk = d - cs;
+          NumType s01 = (NumType)0.5*(r01[i] + r10[i]);
+          NumType s02 = (NumType)0.5*(r02[i] + r20[i]);
+          NumType s12 = (NumType)0.5*(r12[i] + r21[i]);
+          NumType sx = k2 ? s02 : (k1 ? s01 : dk);
+          NumType sy = k2 ? s12 : (k1 ? dk : s01);
+          NumType sz = k2 ? dk : (k1 ? s12 : s02);
+          NumType scale = 1/std::sqrt(std::max(dk*(1 - cs), zero));
+          scale = (sx*vx + sy*vy + sz*vz < 0) ? -scale : scale;
+
+          bool nearPi = cs2[i] < 0;
+          ax = nearPi ? sx*scale : ax;
+          ay = nearPi ? sy*scale : ay;
+          az = nearPi ? sz*scale : az;
+
+          // Keep the first axis coordinate non-negative, unless the principal log is requested.
+          bool flip = !principal && ax < 0;
+          NumType theta = flip ? twoPi - angle[i] : angle[i];
+          NumType sign = flip ? (NumType)-1 : (NumType)1;
+          ox[i] = sign*ax*theta;
+          oy[i] = sign*ay*theta;
+          oz[i] = sign*az*theta;
+        }
+        std::copy(ox, ox + m, wx + start);
+        std::copy(oy, oy + m, wy + start);
+        std::copy(oz, oz + m, wz + start);
+      }
+    }
+
+  protected:
+
+    // Number of rotations the batch kernels process per pass.
+    enum { BATCH_BLOCK = 256 };
+
+    // One column per matrix element, in Eigen's column-major element order.
+    Eigen::Matrix<NumType, Eigen::Dynamic, 9> _data;
+  };
+
+  // Convenience names
+  using RotationBatchd = RotationBatch < double >;
+  using RotationBatchf = RotationBatch < float >;
+};
+
+#endif // ROTATIONBATCH_HPP
@@ -15,24 +15,39 @@
 //
 
 #include "screwException.hpp"
-#include <stdlib.h>
+#include "instrumentation.hpp"
 #include <stdio.h>
 
 using namespace screws;
 
-ScrewException::ScrewException(std::string msg, std::string filename, std::string function, int line)
+ScrewException::ScrewException(const char* msg, const char* filename, const char* function, int line)
 {
-  _msg = msg;
-  _filename = filename;
-  _function = function;
-  _line = line;
-  _buffer = (char*)malloc(500 * sizeof(char));
+  format(msg, filename, function, line);
+}
+
+ScrewException::ScrewException(const std::string& msg, const std::string& filename, const std::string& function, int line)
+{
+  format(msg.c_str(), filename.c_str(), function.c_str(), line);
 }
 
 ScrewException::~ScrewException() {}
 
 const char* ScrewException::what() const
 {
-  sprintf(_buffer, "Encountered: %s, in file %s, function %s, line %d.", _msg.c_str(), _filename.c_str(), _function.c_str(), _line);
   return _buffer;
 }
+
+void ScrewException::format(const char* msg, const char* filename, const char* function, int line)
+{
+  SCREWS_COUNT(EXCEPTIONS);
+  snprintf(_buffer, BUFFER_SIZE, "Encountered: %s, in file %s, function %s, line %d.", msg, filename, function, line);
+}
+
+bool Instrumentation::enabled()
+{
+#ifdef SCREWS_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
@@ -27,6 +27,9 @@ namespace screws
    * \class ScrewException
    * \ingroup libScrews
    * \brief This class handles different exception types for the screws library.
+   * \note The message is formatted into a fixed buffer when the exception is created, so creating
+   * one does not allocate (the C++ runtime still allocates the thrown object). Longer messages are
+   * truncated.
    * \date 27th April 2013
    */
   class SCREWS_EXPORT ScrewException
@@ -34,23 +37,25 @@ namespace screws
   public:
     /*!
      * @brief Exception class for libScrews.
-     * @param msg an std::string with the message to be displayed.
-     * @param filename an std::string containing the filename where the error originated.
-     * @param function an std::string containing the name of the function where the error originated from.
+     * @param msg the message to be displayed.
+     * @param filename the filename where the error originated.
+     * @param function the name of the function where the error originated from.
      * @param line an integer specifying the line of code in the file.
      */
-    ScrewException(std::string msg, std::string filename, std::string function, int line);
+    ScrewException(const char* msg, const char* filename, const char* function, int line);
+
+    /// @brief As above, for messages built at run time.
+    ScrewException(const std::string& msg, const std::string& filename, const std::string& function, int line);
     ~ScrewException();
 
     /// @return the reported error message.
     virtual const char* what() const;
 
   private:
-    char* _buffer;
-    std::string _msg;
-    std::string _function;
-    std::string _filename;
-    int _line;
+    void format(const char* msg, const char* filename, const char* function, int line);
+
+    enum { BUFFER_SIZE = 512 };
+    char _buffer[BUFFER_SIZE];
   };
 };
 
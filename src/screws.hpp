@@ -18,12 +18,30 @@
 #define SCREWS_H
 
 #include <Eigen\Eigen>
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
+#include "instrumentation.hpp"
+#include "trace.hpp"
 #include "translation.hpp"
 #include "rotation.hpp"
+#include "rotationBatch.hpp"
 #include "homogeneousTransform.hpp"
 #include "skew.hpp"
 #include "twist.hpp"
-// #include "adjoint.h"
+#include "mixedPrecision.hpp"
+#include "twistExpCache.hpp"
+#include "batchKernels.hpp"
+#include "transformExpression.hpp"
+#include "transformBatch.hpp"
+#include "chain.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include "spatialInertia.hpp"
+#include "dynamics.hpp"
+#include "lieIntegrator.hpp"
+#include "cosseratRod.hpp"
+#include "constantCurvatureSegment.hpp"
+#include "concentricTubeRobot.hpp"
 #include "screwException.hpp"
 #include "screwsInitLibrary.hpp"
 
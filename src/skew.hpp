@@ -18,8 +18,12 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
 #include <Eigen/Eigen>
 #include <cfloat>
+#include <vector>
 
 namespace screws
 {
@@ -27,6 +31,8 @@ namespace screws
   class Rotation;
   template<class NumType>
   class Translation;
+  template<class NumType>
+  class RotationBatch;
   
   /*!
    * \class Skew
@@ -62,18 +68,23 @@ namespace screws
     
     /// @brief Create a skew symmetric matrix by taking the log of a rotation matrix.
     /// @param R the 3x3 rotation matrix.
-    /// @param theta the extracted rotation angle.
-    explicit Skew(const Rotation<NumType>& R)
+    /// @param principal if true, the principal log with angle in [0, pi]; otherwise the axis keeps
+    /// a non-negative first coordinate and the angle is in [0, 2pi).
+    explicit Skew(const Rotation<NumType>& R, bool principal = false)
     {
       // R will always be valid, otherwise it won't be a rotation.
-      NumType theta = R.angle();
+      Vector3<NumType> axisVec;
+      NumType theta;
+      R.calculateAxisAndAngle(axisVec, theta, principal);
+
       if (theta == (NumType)0)
       {
         resetData();
       }
       else
       {
-        _data = (R._data - R.inv()._data)/(2*sin(theta))*theta;
+        // Built from the axis rather than (R - R^T)/(2 sin(theta)), which loses all precision close to pi.
+        *this = Skew<NumType>(axisVec*theta);
       }
     }
     
@@ -84,10 +95,15 @@ namespace screws
     }
     
     /// Default destructor.
-    ~Skew()
-    {
+    ~Skew() = default;
 
-    }
+    /// @brief Copy and move constructors: plain copies of the 3x3 storage, without validation.
+    Skew(const Skew<NumType>&) = default;
+    Skew(Skew<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    Skew<NumType>& operator=(const Skew<NumType>&) = default;
+    Skew<NumType>& operator=(Skew<NumType>&&) = default;
     
     /// @brief Transposes the skew.
     /// @return the transposed skew.
@@ -102,6 +118,7 @@ namespace screws
     /// @param theta the rotation magnitude.
     Rotation<NumType> exp(const NumType& theta = (NumType)1) const
     {
+      SCREWS_INSTRUMENT(SKEW_EXP);
       if (theta == (NumType)0)
       {
         return Rotation<NumType>();
@@ -110,7 +127,7 @@ namespace screws
       {
         NumType mag = angle();
 
-        if (fabs(mag) < FLT_EPSILON)
+        if (mag < NumericTraits<NumType>::zeroTolerance())
         {
           return Rotation<NumType>();
         }
@@ -118,18 +135,111 @@ namespace screws
         {
           // Rodriguez formula
           Rotation<NumType> rGen;
+          NumType sn, cs;
+          MathPolicy<NumType>::sinCos(mag*theta, sn, cs);
           rGen._data = rGen._data +
-              (_data/mag)*sin(mag*theta) + (_data*_data)/(mag*mag)*((NumType)1.0 - cos(mag*theta));
+              (_data/mag)*sn + (_data*_data)/(mag*mag)*((NumType)1.0 - cs);
 
           return rGen;
         }
       }
     }
+
+    /// @brief Batch exponential over many angles, out[i] = exp(S*theta[i]).
+    /// @param theta the angles.
+    /// @param n the number of angles.
+    /// @param out the rotations. Resized only if its size differs.
+    /// @note The skew-dependent matrices are computed once; the per-angle loops have no branches,
+    /// so that they run across SIMD lanes. Include rotationBatch.hpp to use.
+    void exp(const NumType* theta, const size_t& n, RotationBatch<NumType>& out) const
+    {
+      out.resize(n);
+
+      NumType mag = angle();
+      if (mag < NumericTraits<NumType>::zeroTolerance())
+      {
+        out.setIdentity();
+        return;
+      }
+
+      Eigen::Matrix<NumType, 3, 3> K1 = _data/mag;
+      Eigen::Matrix<NumType, 3, 3> K2 = K1*K1;
+
+      NumType phi[BATCH_BLOCK] = {}, s[BATCH_BLOCK], c[BATCH_BLOCK];
+      for (size_t start = 0; start < n; start += BATCH_BLOCK)
+      {
+        size_t m = std::min((size_t)BATCH_BLOCK, n - start);
+        for (size_t i = 0; i < m; ++i)
+        {
+          phi[i] = mag*theta[start + i];
+        }
+        MathPolicy<NumType>::sinCos(phi, s, c, m);
+
+        for (unsigned int col = 0; col < 3; ++col)
+        {
+          for (unsigned int row = 0; row < 3; ++row)
+          {
+            NumType* p = out.plane(row, col) + start;
+            const NumType id = (row == col) ? (NumType)1 : (NumType)0;
+            const NumType k1 = K1(row, col);
+            const NumType k2 = K2(row, col);
+            for (size_t i = 0; i < m; ++i)
+            {
+              p[i] = id + k1*s[i] + k2*(1 - c[i]);
+            }
+          }
+        }
+      }
+    }
+
+    /// @brief Batch exponential of n skews, each with its own angle, out[i] = exp(S_i*theta[i]).
+    /// @param wx, wy, wz the skew coordinates, as structure of arrays.
+    /// @param theta the angles.
+    /// @param n the number of skews.
+    /// @param out the rotations. Resized only if its size differs.
+    static void exp(const NumType* wx, const NumType* wy, const NumType* wz, const NumType* theta,
+                    const size_t& n, RotationBatch<NumType>& out)
+    {
+      out.resize(n);
+      for (size_t start = 0; start < n; start += BATCH_BLOCK)
+      {
+        size_t m = std::min((size_t)BATCH_BLOCK, n - start);
+        expBlock(wx + start, wy + start, wz + start, theta + start, m, out, start);
+      }
+    }
+
+    /// @brief Batch exponential of n skews, each with its own angle, out[i] = exp(S[i]*theta[i]).
+    /// @param out the rotations. Resized only if its size differs.
+    /// @throw screws::ScrewException if S and theta differ in size.
+    static void exp(const std::vector< Skew<NumType> >& S, const std::vector<NumType>& theta,
+                    RotationBatch<NumType>& out)
+    {
+      if (S.size() != theta.size())
+      {
+        ScrewException e("Batches of different sizes.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+
+      out.resize(S.size());
+      NumType wx[BATCH_BLOCK], wy[BATCH_BLOCK], wz[BATCH_BLOCK];
+      for (size_t start = 0; start < S.size(); start += BATCH_BLOCK)
+      {
+        size_t m = std::min((size_t)BATCH_BLOCK, S.size() - start);
+        for (size_t i = 0; i < m; ++i)
+        {
+          wx[i] = S[start + i]._data(2, 1);
+          wy[i] = S[start + i]._data(0, 2);
+          wz[i] = S[start + i]._data(1, 0);
+        }
+        expBlock(wx, wy, wz, &theta[start], m, out, start);
+      }
+    }
     
     /// @brief Normalise and remove magnitude from skew symmetric matrix. Only rotation axis information remains.
     /// @return the normalised skew.
     Skew<NumType> normalised() const
     {
+      SCREWS_INSTRUMENT(NORMALISED);
       NumType mag = angle();
 
       if (mag > (NumType)0)
@@ -149,14 +259,21 @@ namespace screws
     /// @return the norm of the skew.
     NumType norm() const
     {
-      return coordinates().norm();
+      return angle();
+    }
+
+    /// @brief Calculate the squared norm of the skew, without taking the square root.
+    /// @return the squared norm of the skew.
+    NumType squaredNorm() const
+    {
+      return _data(0, 1)*_data(0, 1) + _data(0, 2)*_data(0, 2) + _data(1, 2)*_data(1, 2);
     }
 
     /// @brief Extract the rotation magnitude without normalising.
     /// @return the magnitude of the rotation.
     NumType angle() const
     {
-      return (NumType)sqrt(_data(0, 1)*_data(0, 1) + _data(0, 2)*_data(0, 2) + _data(1, 2)*_data(1, 2));
+      return (NumType)std::sqrt(squaredNorm());
     }
 
     /// @brief Extract the axis of rotation.
@@ -178,6 +295,12 @@ namespace screws
       return _data(i, j);
     }
 
+    /// @brief The 3x3 storage, for Eigen expressions.
+    const Eigen::Matrix<NumType, 3, 3>& matrix() const
+    {
+      return _data;
+    }
+
     /// @brief Element-by-element addition of skew matrices.
     /// @note This operation corresponds to multiplication of the respective rotations.
     Skew<NumType> operator +(const Skew<NumType>& S) const
@@ -242,18 +365,19 @@ namespace screws
 
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param S compared skew matrix.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const Skew<NumType>& S, double eps = FLT_EPSILON) const
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const Skew<NumType>& S,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
-      if (fabs(S(0, 0) - _data(0, 0)) < eps &&
-          fabs(S(1, 0) - _data(1, 0)) < eps &&
-          fabs(S(2, 0) - _data(2, 0)) < eps &&
-          fabs(S(0, 1) - _data(0, 1)) < eps &&
-          fabs(S(1, 1) - _data(1, 1)) < eps &&
-          fabs(S(2, 1) - _data(2, 1)) < eps &&
-          fabs(S(0, 2) - _data(0, 2)) < eps &&
-          fabs(S(1, 2) - _data(1, 2)) < eps &&
-          fabs(S(2, 2) - _data(2, 2)) < eps)
+      if (std::fabs(S(0, 0) - _data(0, 0)) < eps &&
+          std::fabs(S(1, 0) - _data(1, 0)) < eps &&
+          std::fabs(S(2, 0) - _data(2, 0)) < eps &&
+          std::fabs(S(0, 1) - _data(0, 1)) < eps &&
+          std::fabs(S(1, 1) - _data(1, 1)) < eps &&
+          std::fabs(S(2, 1) - _data(2, 1)) < eps &&
+          std::fabs(S(0, 2) - _data(0, 2)) < eps &&
+          std::fabs(S(1, 2) - _data(1, 2)) < eps &&
+          std::fabs(S(2, 2) - _data(2, 2)) < eps)
       {
         return true;
       }
@@ -272,26 +396,77 @@ namespace screws
       return v;
     }
     
-    /// @brief Perform verification that the matrix corresponds to a rotation.
+    /// @brief Perform verification that the matrix corresponds to a rotation, i.e. that it is
+    /// skew symmetric within the given precision.
+    /// @param eps allowed deviation [default: NumericTraits<NumType>::validationTolerance()].
     /// @return true if the matrix corresponds to a rotation, false otherwise.
-    bool isValid() const
+    bool isValid(const NumType& eps = NumericTraits<NumType>::validationTolerance()) const
     {
-      double val = 0;
-      for(int i = 0; i < 3; ++i)
-        for(int j = 0; j < 3; ++j)
-          val += _data(i, j) + _data(j, i);
+      return (std::fabs(_data(0, 0)) < eps && std::fabs(_data(1, 1)) < eps && std::fabs(_data(2, 2)) < eps &&
+              std::fabs(_data(0, 1) + _data(1, 0)) < eps &&
+              std::fabs(_data(0, 2) + _data(2, 0)) < eps &&
+              std::fabs(_data(1, 2) + _data(2, 1)) < eps);
+    }
+    
+  protected:
+
+    // Number of elements the batch kernels process per pass; sized for the stack and the L1 cache.
+    enum { BATCH_BLOCK = 256 };
 
-      if (val == 0)
+    // Rodrigues formula for up to BATCH_BLOCK skews, written to out[offset, offset + m).
+    static void expBlock(const NumType* wx, const NumType* wy, const NumType* wz, const NumType* theta,
+                         const size_t& m, RotationBatch<NumType>& out, const size_t& offset)
+    {
+      NumType ux[BATCH_BLOCK], uy[BATCH_BLOCK], uz[BATCH_BLOCK];
+      NumType phi[BATCH_BLOCK] = {}, s[BATCH_BLOCK], c[BATCH_BLOCK];
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
+      for (size_t i = 0; i < m; ++i)
       {
-        return true;
+        NumType mag = std::sqrt(wx[i]*wx[i] + wy[i]*wy[i] + wz[i]*wz[i]);
+        // Skews below the zero tolerance give the identity, as in the scalar exp(). Written with
+        // a multiplier rather than selects per output, which GCC does not if-convert.
+        NumType keep = (mag < zero) ? (NumType)0 : (NumType)1;
+        NumType inv = keep/((mag < zero) ? (NumType)1 : mag);
+        ux[i] = wx[i]*inv;
+        uy[i] = wy[i]*inv;
+        uz[i] = wz[i]*inv;
+        phi[i] = keep*mag*theta[i];
       }
-      else
+      MathPolicy<NumType>::sinCos(phi, s, c, m);
+
+      // One column per loop: with all nine planes in one loop the compiler gives up on the
+      // aliasing checks between the outputs.
+      NumType* r00 = out.plane(0, 0) + offset;
+      NumType* r10 = out.plane(1, 0) + offset;
+      NumType* r20 = out.plane(2, 0) + offset;
+      for (size_t i = 0; i < m; ++i)
       {
-        return false;
+        NumType vc = 1 - c[i];
+        r00[i] = c[i] + ux[i]*ux[i]*vc;
+        r10[i] = ux[i]*uy[i]*vc + uz[i]*s[i];
+        r20[i] = ux[i]*uz[i]*vc - uy[i]*s[i];
+      }
+      NumType* r01 = out.plane(0, 1) + offset;
+      NumType* r11 = out.plane(1, 1) + offset;
+      NumType* r21 = out.plane(2, 1) + offset;
+      for (size_t i = 0; i < m; ++i)
+      {
+        NumType vc = 1 - c[i];
+        r01[i] = ux[i]*uy[i]*vc - uz[i]*s[i];
+        r11[i] = c[i] + uy[i]*uy[i]*vc;
+        r21[i] = uy[i]*uz[i]*vc + ux[i]*s[i];
+      }
+      NumType* r02 = out.plane(0, 2) + offset;
+      NumType* r12 = out.plane(1, 2) + offset;
+      NumType* r22 = out.plane(2, 2) + offset;
+      for (size_t i = 0; i < m; ++i)
+      {
+        NumType vc = 1 - c[i];
+        r02[i] = ux[i]*uz[i]*vc + uy[i]*s[i];
+        r12[i] = uy[i]*uz[i]*vc - ux[i]*s[i];
+        r22[i] = c[i] + uz[i]*uz[i]*vc;
       }
     }
-    
-  protected:
 
     // Set all to zero.
     void resetData()
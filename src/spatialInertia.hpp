@@ -0,0 +1,204 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SPATIALINERTIA_HPP
+#define SPATIALINERTIA_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "translation.hpp"
+#include "homogeneousTransform.hpp"
+#include "vector6.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include <Eigen/Eigen>
+
+namespace screws
+{
+  /*!
+   * \class SpatialInertia
+   * \ingroup libScrews
+   * \brief Spatial inertia of a rigid body in some frame, stored as mass, first moment and rotational inertia.
+   *
+   * With c the centre of mass and I_o the rotational inertia about the frame origin, the 6x6 inertia
+   * for twist coordinates (v; w) is [m 1, -m c^; m c^, I_o]. Only m, h = m c and I_o (10 numbers)
+   * are stored, and the momentum G V = (m v + w x h; h x v + I_o w) is formed without the 6x6 matrix.
+   * Inertias change frame as Ad_g^T G Ad_g and add up, so the inertia of rigidly joined bodies, e.g. the
+   * composite bodies of the mass matrix, stays in this form.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT SpatialInertia
+  {
+  public:
+    /// @brief 6x1 twist or wrench coordinates, linear part first.
+    typedef Eigen::Matrix<NumType, 6, 1> Coordinates;
+    /// @brief The 6x6 matrix form.
+    typedef Eigen::Matrix<NumType, 6, 6> Matrix;
+
+    /// @brief A massless body.
+    SpatialInertia()
+      : _m((NumType)0), _h(Eigen::Matrix<NumType, 3, 1>::Zero()), _I(Eigen::Matrix<NumType, 3, 3>::Zero())
+    {
+
+    }
+
+    /// @brief Create the inertia of a body from its mass properties.
+    /// @param mass the mass.
+    /// @param com the centre of mass in this frame.
+    /// @param Ixx-Iyz the inertia tensor about the centre of mass, in the axes of this frame.
+    /// @throw screws::ScrewException for a negative mass.
+    explicit SpatialInertia(const NumType& mass, const Translation<NumType>& com,
+                            const NumType& Ixx, const NumType& Iyy, const NumType& Izz,
+                            const NumType& Ixy = (NumType)0, const NumType& Ixz = (NumType)0, const NumType& Iyz = (NumType)0)
+    {
+      if (mass < 0)
+      {
+        ScrewException e("Mass cannot be negative.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      Eigen::Matrix<NumType, 3, 1> c(com(0), com(1), com(2));
+      Eigen::Matrix<NumType, 3, 3> Ic;
+      Ic << Ixx, Ixy, Ixz,
+            Ixy, Iyy, Iyz,
+            Ixz, Iyz, Izz;
+
+      // Parallel axis theorem, I_o = I_c + m (|c|^2 1 - c c^T)
+      _m = mass;
+      _h = mass*c;
+      _I = Ic + mass*(c.squaredNorm()*Eigen::Matrix<NumType, 3, 3>::Identity() - c*c.transpose());
+    }
+
+    /// Default destructor.
+    ~SpatialInertia() = default;
+
+    /// @brief Copy and move constructors and assignment.
+    SpatialInertia(const SpatialInertia<NumType>&) = default;
+    SpatialInertia(SpatialInertia<NumType>&&) = default;
+    SpatialInertia<NumType>& operator=(const SpatialInertia<NumType>&) = default;
+    SpatialInertia<NumType>& operator=(SpatialInertia<NumType>&&) = default;
+
+    /// @return the mass.
+    const NumType& mass() const
+    {
+      return _m;
+    }
+
+    /// @return the centre of mass, or the origin for a massless body.
+    Translation<NumType> centreOfMass() const
+    {
+      if (_m <= 0)
+      {
+        return Translation<NumType>();
+      }
+      return Translation<NumType>(_h(0)/_m, _h(1)/_m, _h(2)/_m);
+    }
+
+    /// @return the 6x6 matrix [m 1, -m c^; m c^, I_o].
+    Matrix matrix() const
+    {
+      Matrix G;
+      Eigen::Matrix<NumType, 3, 3> H;
+      H << 0, -_h(2), _h(1),
+           _h(2), 0, -_h(0),
+           -_h(1), _h(0), 0;
+      G.template topLeftCorner<3, 3>() = _m*Eigen::Matrix<NumType, 3, 3>::Identity();
+      G.template topRightCorner<3, 3>() = -H;
+      G.template bottomLeftCorner<3, 3>() = H;
+      G.template bottomRightCorner<3, 3>() = _I;
+
+      return G;
+    }
+
+    /// @brief The wrench G V, e.g. the momentum for a body twist V or the inertial force for an acceleration.
+    Wrench<NumType> operator*(const TwistCoordinates<NumType>& V) const
+    {
+      Coordinates c, out;
+      c << V(0), V(1), V(2), V(3), V(4), V(5);
+      apply(c, out);
+
+      return Wrench<NumType>(out(0), out(1), out(2), out(3), out(4), out(5));
+    }
+
+    /// @brief out = G V.
+    void apply(const Coordinates& V, Coordinates& out) const
+    {
+      const Eigen::Matrix<NumType, 3, 1> v = V.template head<3>(), w = V.template tail<3>();
+      out.template head<3>() = _m*v + w.cross(_h);
+      out.template tail<3>() = _h.cross(v) + _I*w;
+    }
+
+    /// @brief The inertia of both bodies, rigidly joined; both are in the same frame.
+    SpatialInertia<NumType>& operator+=(const SpatialInertia<NumType>& G)
+    {
+      _m += G._m;
+      _h += G._h;
+      _I += G._I;
+
+      return *this;
+    }
+
+    /// @brief The inertia of both bodies, rigidly joined; both are in the same frame.
+    SpatialInertia<NumType> operator+(const SpatialInertia<NumType>& G) const
+    {
+      SpatialInertia<NumType> sum(*this);
+      sum += G;
+
+      return sum;
+    }
+
+    /// @brief The same inertia in another frame, Ad_g^T G Ad_g.
+    /// @param g the pose of the new frame in the frame of this inertia.
+    SpatialInertia<NumType> changeFrame(const HomogeneousTransform<NumType>& g) const
+    {
+      SpatialInertia<NumType> out;
+      changeFrame(Adjoint<NumType>(g), out);
+
+      return out;
+    }
+
+    /// @brief out = Ad_g^T G Ad_g, in 10 numbers rather than two 6x6 products.
+    /// @param Ad the adjoint of the pose g of the new frame in the frame of this inertia.
+    /// @param out the result; may not be this inertia.
+    void changeFrame(const Adjoint<NumType>& Ad, SpatialInertia<NumType>& out) const
+    {
+      assert(&out != this);
+      const Eigen::Matrix<NumType, 3, 3>& R = Ad._R;
+      const Eigen::Matrix<NumType, 3, 1>& p = Ad._p;
+      // Moving the origin to p: h' = h - m p and, without dividing by m,
+      // I' = I_o + (m |p|^2 - 2 h.p) 1 + h p^T + p h^T - m p p^T. Then into the new axes.
+      const Eigen::Matrix<NumType, 3, 1> h = _h - _m*p;
+      Eigen::Matrix<NumType, 3, 3> I = _I + h*p.transpose() + p*_h.transpose();
+      I.diagonal().array() += _m*p.squaredNorm() - 2*_h.dot(p);
+      out._m = _m;
+      out._h.noalias() = R.transpose()*h;
+      out._I.noalias() = R.transpose()*I*R;
+    }
+
+  protected:
+
+    NumType _m;
+    // First moment of mass, m c.
+    Eigen::Matrix<NumType, 3, 1> _h;
+    // Rotational inertia about the frame origin.
+    Eigen::Matrix<NumType, 3, 3> _I;
+  };
+
+  // Convenience names
+  using SpatialInertiad = SpatialInertia < double >;
+  using SpatialInertiaf = SpatialInertia < float >;
+};
+
+#endif // SPATIALINERTIA_HPP
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <time.h>
+#include <type_traits>
+#include <thread>
+#include <sstream>
 
 #define SHOW_PRINT_OUTS false
 #define TEST_VECTOR6 true
@@ -8,6 +11,22 @@
 #define TEST_HOMOGENEOUS_TRANSFORMS true
 #define TEST_SKEWS true
 #define TEST_TWISTS true
+#define TEST_SINGLE_PRECISION true
+#define TEST_MIXED_PRECISION true
+#define TEST_TWIST_EXP_CACHE true
+#define TEST_ROTATION_BATCH true
+#define TEST_BATCH_KERNELS true
+#define TEST_TRANSFORM_EXPRESSION true
+#define TEST_TRANSFORM_BATCH true
+#define TEST_CHAIN true
+#define TEST_WRENCH true
+#define TEST_DYNAMICS true
+#define TEST_LIE_INTEGRATOR true
+#define TEST_COSSERAT_ROD true
+#define TEST_CONSTANT_CURVATURE true
+#define TEST_CONCENTRIC_TUBE_ROBOT true
+#define TEST_INSTRUMENTATION true
+#define TEST_TRACE true
 
 #include "translation.hpp"
 #include "rotation.hpp"
@@ -15,6 +34,23 @@
 #include "skew.hpp"
 #include "vector6.hpp"
 #include "twist.hpp"
+#include "mixedPrecision.hpp"
+#include "twistExpCache.hpp"
+#include "rotationBatch.hpp"
+#include "batchKernels.hpp"
+#include "transformExpression.hpp"
+#include "transformBatch.hpp"
+#include "chain.hpp"
+#include "wrench.hpp"
+#include "adjoint.hpp"
+#include "spatialInertia.hpp"
+#include "dynamics.hpp"
+#include "lieIntegrator.hpp"
+#include "cosseratRod.hpp"
+#include "constantCurvatureSegment.hpp"
+#include "concentricTubeRobot.hpp"
+#include "instrumentation.hpp"
+#include "trace.hpp"
 
 void testVector6()
 {
@@ -482,6 +518,69 @@ void testTwists()
   Twrand.pitch();
   Twrand.axis();
 
+  assert(Twrand.exp().approxEq(Hrand, 1e-6));
+  assert(TwrandRot.exp().approxEq(HrandRot, 1e-6));
+  assert(TwrandTra.exp().approxEq(HrandTra, 1e-6));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Exponential of the logarithm test passed." << std::endl;
+}
+
+void testSinglePrecision()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == SINGLE PRECISION == " << std::endl;
+  int testIdx = 1;
+
+  // The float path must stay close to the double path.
+  const double tol = 1e-4;
+
+  double angle = 1.999*M_PI*(double)rand()/RAND_MAX;
+  screws::Vector3d axis((double)rand()/RAND_MAX + 0.1,
+                        (double)rand()/RAND_MAX,
+                        (double)rand()/RAND_MAX);
+  screws::Vector3d trans((double)rand()/RAND_MAX,
+                         (double)rand()/RAND_MAX,
+                         (double)rand()/RAND_MAX);
+  screws::Vector3f axisf((float)axis(0), (float)axis(1), (float)axis(2));
+  screws::Vector3f transf((float)trans(0), (float)trans(1), (float)trans(2));
+
+  screws::Rotationd Rd(axis, angle);
+  screws::Rotationf Rf(axisf, (float)angle);
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+      assert(fabs(Rd(i, j) - Rf(i, j)) < tol);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Axis-angle construction test passed." << std::endl;
+
+  screws::Skewd Sd = Rd.log();
+  screws::Skewf Sf = Rf.log();
+  for (int i = 0; i < 3; ++i)
+    assert(fabs(Sd.coordinates()(i) - Sf.coordinates()(i)) < 10*tol);
+  assert(Sf.exp().approxEq(Rf, 10*(float)tol));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Skew log and exponential test passed." << std::endl;
+
+  screws::Rotationd Rrpyd = screws::Rotationd('z', angle)*screws::Rotationd('x', 0.5*angle);
+  screws::Rotationf Rrpyf = screws::Rotationf('z', (float)angle)*screws::Rotationf('x', 0.5f*(float)angle);
+  screws::Vector3f rpyf = Rrpyf.rpy();
+  screws::Rotationf Rrpyf2 = screws::Rotationf('z', rpyf(2))*screws::Rotationf('y', rpyf(1))*screws::Rotationf('x', rpyf(0));
+  assert(Rrpyf2.approxEq(Rrpyf, 10*(float)tol));
+  assert(fabs(Rrpyd.rpy()(1) - rpyf(1)) < 10*tol || fabs(Rrpyd.rpy()(1) - rpyf(1)) > 2*M_PI - 10*tol);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") RPY test passed." << std::endl;
+
+  screws::HomogeneousTransformd Hd(Rd, trans);
+  screws::HomogeneousTransformf Hf(Rf, transf);
+  screws::Twistd Twd(Hd);
+  screws::Twistf Twf(Hf);
+  if (fabs(angle - M_PI) > 0.1 && angle < 1.9*M_PI)
+  {
+    for (int i = 0; i < 6; ++i)
+      assert(fabs(Twd.coordinates()(i) - Twf.coordinates()(i)) < 100*tol);
+  }
+  screws::HomogeneousTransformf Hf2 = Twf.exp();
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 4; ++j)
+    {
+      assert(fabs(Hf2(i, j) - Hd(i, j)) < 100*tol);
+      assert(fabs(Twd.exp()(i, j) - Hd(i, j)) < tol);
+    }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Twist log and exponential test passed." << std::endl;
 }
 
 void testSkews()
@@ -610,6 +709,14 @@ void testSkews()
   assert(SrandRot.approxEq(Rrand.log(), 1e-10));
   assert(SrandRot.approxEq(Rrand.skew(), 1e-10));
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Conversion from rotation to skew passed." << std::endl;
+
+  screws::Rotationd Rpi('x', M_PI);
+  screws::Rotationd RnearPi(randAxis, M_PI - 1e-9);
+  assert(Rpi.log().exp().approxEq(Rpi));
+  assert(RnearPi.log().exp().approxEq(RnearPi));
+  assert(fabs(RnearPi.log().angle() - (M_PI - 1e-9)) < 1e-12 ||
+         fabs(RnearPi.log().angle() - (M_PI + 1e-9)) < 1e-12);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Conversion from rotation to skew close to pi passed." << std::endl;
 }
 
 void testHomogeneousTransforms()
@@ -643,6 +750,8 @@ void testHomogeneousTransforms()
 
   assert(randH.rotation() == randRot);
   assert(randH.translation() == randTrans);
+  const screws::HomogeneousTransformd& constH = randH;
+  assert(constH.approxEq(randH) && !constH.approxEq(Heye));
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") R-T constructor test passed." << std::endl;
 
   randH.setTranslation(randTrans);
@@ -685,6 +794,53 @@ void testHomogeneousTransforms()
   assert(!(randH != randH));
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Exact equality and inequality test passed." << std::endl;
 
+  screws::HomogeneousTransformd out;
+  screws::HomogeneousTransformd::mulInto(out, randH, randHold);
+  assert(out == randH*randHold);
+  screws::HomogeneousTransformd::invInto(out, randH);
+  assert(out == randH.inv());
+  out = randH;
+  screws::HomogeneousTransformd::mulInto(out, out, randHold);
+  assert(out == randH*randHold);
+  out = randHold;
+  screws::HomogeneousTransformd::mulInto(out, randH, out);
+  assert(out == randH*randHold);
+  out = randH;
+  screws::HomogeneousTransformd::invInto(out, out);
+  assert(out == randH.inv());
+  screws::Translationd p = randTrans;
+  screws::HomogeneousTransformd::mulInto(p, randH, p);
+  assert(p == randH*randTrans);
+  screws::Rotationd R = randH.rotation();
+  screws::Rotationd::mulInto(R, R, R);
+  assert(R == randH.rotation()*randH.rotation());
+  screws::Rotationd::invInto(R, R);
+  assert(R == (randH.rotation()*randH.rotation()).inv());
+  out = randH;
+  screws::HomogeneousTransformd::mulInto(out, out, out);
+  assert(out == randH*randH);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") In-place multiplication and inversion into storage test passed." << std::endl;
+
+  static_assert(std::is_nothrow_move_constructible<screws::HomogeneousTransformd>::value &&
+                std::is_nothrow_move_assignable<screws::HomogeneousTransformd>::value &&
+                std::is_nothrow_move_constructible<screws::Twistd>::value &&
+                std::is_nothrow_move_constructible<screws::TwistCoordinatesd>::value,
+                "moves of the primitive types must not throw");
+  const screws::Rotationd& Rref = randH.rotation();
+  assert(&Rref == &randH.rotation());
+
+  // Storage accessors: reads, and writes that are not validated.
+  screws::HomogeneousTransformd copied;
+  copied.setUnchecked(randH.rotation().matrix(), randH.translation().vector());
+  assert(copied == randH);
+  screws::Rotationd Rset;
+  Rset.setMatrixUnchecked(randH.rotation().matrix()*randHold.rotation().matrix());
+  assert(Rset == randH.rotation()*randHold.rotation());
+  screws::Translationd Tset;
+  Tset.setVector(randH.translation().vector()*2.0);
+  assert(Tset == randH.translation()*2.0);
+  assert(randH.rotation().log().matrix()(1, 0) == randH.rotation().log()(1, 0));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Storage accessor test passed." << std::endl;
 }
 
 void testRotations()
@@ -766,11 +922,11 @@ void testRotations()
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Axis and angle of random rotation test passed." << std::endl;
 
   screws::Rotationd RrandSquare = Rrand*Rrand;
-  assert(RrandSquare.approxEq(screws::Rotation<double>(randAxis, 2*randAngle)));
+  assert(RrandSquare.approxEq(screws::Rotation<double>(randAxis, fmod(2*randAngle, 2*M_PI))));
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Multiplication of random rotation test passed." << std::endl;
 
   RrandSquare *= Rrand;
-  assert(RrandSquare.approxEq(screws::Rotation<double>(randAxis, 3*randAngle)));
+  assert(RrandSquare.approxEq(screws::Rotation<double>(randAxis, fmod(3*randAngle, 2*M_PI))));
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") In-place multiplication of random rotation test passed." << std::endl;
 
   screws::Rotation<double> rFromZ(screws::Vector3<double>(Rrand(0, 2), Rrand(1, 2), Rrand(2, 2)));
@@ -788,75 +944,1968 @@ void testRotations()
   assert(Rrand.approxEq(Rrand2));
 
   if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") RPY and creation from RPY test passed." << std::endl;
+
+  // Columns off by 1e-9 pass the default double tolerance, but not a tighter one given at the call site.
+  screws::Rotationd Rperturbed(screws::Vector3d(1.0 + 1e-9, 0.0, 0.0),
+                               screws::Vector3d(0.0, 1.0, 0.0),
+                               screws::Vector3d(0.0, 0.0, 1.0));
+  assert(Rperturbed.isValid());
+  assert(Rperturbed.approxEq(Reye));
+  assert(!Rperturbed.approxEq(Reye, 1e-12));
+  try
+  {
+    Rperturbed.isValid(1e-12);
+    exit(1);
+  }
+  catch(screws::ScrewException s)
+  {
+    if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Per-call validation tolerance passed: " << s.what() << std::endl;
+  }
+
+  // Chains of single precision rotations remain valid under the float tolerance.
+  screws::Rotationf RfStep('z', (float)angleZ);
+  screws::Rotationf RfChain;
+  for (int i = 0; i < 100; ++i)
+  {
+    RfChain *= RfStep;
+  }
+  assert(RfChain.isValid());
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Single precision validation tolerance passed." << std::endl;
 }
 
-int main(void)
+void testMixedPrecision()
 {
-  srand(time(NULL));
+  if (SHOW_PRINT_OUTS) std::cout << " == MIXED PRECISION == " << std::endl;
+  int testIdx = 1;
 
-  const int maxIter = 5000000;
-  if (TEST_VECTOR6)
+  const int n = 200;
+  std::vector<screws::HomogeneousTransformf> Hf(n);
+  std::vector<screws::HomogeneousTransformd> Hd;
+  for (int i = 0; i < n; ++i)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    screws::HomogeneousTransformd H(screws::Rotationd(screws::Vector3d((double)rand()/RAND_MAX + 0.1,
+                                                                       (double)rand()/RAND_MAX,
+                                                                       (double)rand()/RAND_MAX),
+                                                      0.2*(double)rand()/RAND_MAX),
+                                    screws::Translationd((double)rand()/RAND_MAX,
+                                                         (double)rand()/RAND_MAX,
+                                                         (double)rand()/RAND_MAX));
+    Hf[i] = H.cast<float>();
+  }
+  screws::MixedPrecisionf::convert(Hf, Hd);
+  assert(Hd.size() == Hf.size());
+  assert(Hd[0].cast<float>() == Hf[0]);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Conversion test passed." << std::endl;
+
+  // Reference: the same stored inputs composed entirely in double, and entirely in float.
+  std::vector<screws::HomogeneousTransformf> prefix;
+  std::vector<screws::HomogeneousTransformd> ref;
+  std::vector<screws::HomogeneousTransformf> pureFloat;
+  screws::HomogeneousTransformd last = screws::MixedPrecisionf::accumulate(Hf, prefix);
+  screws::HomogeneousTransformd refLast = screws::MixedPrecision<double, double>::accumulate(Hd, ref);
+  screws::MixedPrecision<float, float>::accumulate(Hf, pureFloat);
+  const double u = FLT_EPSILON/2;
+  double maxErrMixed = 0, maxErrFloat = 0;
+  for (int i = 0; i < n; ++i)
+  {
+    for (int r = 0; r < 3; ++r)
     {
-      if (i % 10000 == 0)
-        std::cout << "Vector6 iteration " << i << " of " << maxIter << std::endl;
-      testVector6();
+      for (int c = 0; c < 4; ++c)
+      {
+        double errMixed = fabs(prefix[i](r, c) - ref[i](r, c));
+        assert(errMixed <= u*fabs(ref[i](r, c)) + 1e-13*(i + 1)*(1 + fabs(ref[i](r, c))));
+        maxErrMixed = std::max(maxErrMixed, errMixed);
+        maxErrFloat = std::max(maxErrFloat, fabs(pureFloat[i](r, c) - ref[i](r, c)));
+      }
     }
-    std::cout << "\n\n" << std::endl;
   }
+  assert(last.approxEq(refLast, 1e-12));
+  assert(maxErrMixed <= maxErrFloat);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Accumulation error bound test passed: mixed "
+                                 << maxErrMixed << ", float " << maxErrFloat << std::endl;
+
+  std::vector<screws::HomogeneousTransformf> products;
+  screws::MixedPrecisionf::multiply(prefix, Hf, products);
+  for (int i = 0; i < n; ++i)
+  {
+    screws::HomogeneousTransformd product = screws::MixedPrecision<double, double>::multiply(prefix[i].cast<double>(), Hd[i]);
+    for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 4; ++c)
+        assert(fabs(products[i](r, c) - product(r, c)) <= u*fabs(product(r, c)) + 1e-13);
+  }
+  screws::HomogeneousTransformf pair = screws::MixedPrecisionf::multiply(Hf[0], Hf[1]);
+  screws::HomogeneousTransformd pairRef = screws::MixedPrecision<double, double>::multiply(Hd[0], Hd[1]);
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 4; ++c)
+      assert(fabs(pair(r, c) - pairRef(r, c)) <= u*fabs(pairRef(r, c)) + 1e-13);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch multiplication test passed." << std::endl;
+}
 
-  if (TEST_TRANSLATIONS)
+void testTwistExpCache()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == TWIST EXP CACHE == " << std::endl;
+  int testIdx = 1;
+
+  screws::Twistd tw(screws::TwistCoordinatesd((double)rand()/RAND_MAX,
+                                              (double)rand()/RAND_MAX,
+                                              (double)rand()/RAND_MAX,
+                                              (double)rand()/RAND_MAX + 0.1,
+                                              (double)rand()/RAND_MAX,
+                                              (double)rand()/RAND_MAX));
+  const unsigned int bits = 10;
+  screws::TwistExpCached sinCos(tw, bits);
+  screws::TwistExpCached packed(tw, bits, screws::TwistExpCached::TRANSFORM);
+  assert(sinCos.bytesUsed() == 0);
+  const double step = 2*M_PI/(1 << bits);
+  for (int i = 0; i < 20; ++i)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    unsigned int k = rand() % (1 << bits);
+    screws::HomogeneousTransformd H = tw.exp(k*step);
+    assert(sinCos.exp(k).approxEq(H, 1e-12));
+    assert(packed.exp(k).approxEq(H, 1e-12));
+    assert(sinCos.rotation(k).approxEq(H.rotation(), 1e-12));
+    assert(sinCos.exp(k + (1 << bits)) == sinCos.exp(k));
+  }
+  assert(sinCos.bytesUsed() == 1024*2*sizeof(double));
+  assert(packed.bytesUsed() == 1024*12*sizeof(double));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Cached exponential test passed." << std::endl;
+
+  double theta = 4*M_PI*((double)rand()/RAND_MAX - 0.5);
+  unsigned int k = sinCos.count(theta);
+  double wrapped = theta - 2*M_PI*floor(theta/(2*M_PI));
+  double diff = fabs(k*step - wrapped);
+  assert(std::min(diff, 2*M_PI - diff) <= step/2 + 1e-12);
+  assert(sinCos.expAngle(theta) == sinCos.exp(k));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Quantisation test passed." << std::endl;
+
+  // A budget of two pages: the rest of the table falls back to direct computation.
+  screws::TwistExpCached bounded(tw, 12, screws::TwistExpCached::TRANSFORM, 2*1024*12*sizeof(double));
+  bounded.build();
+  assert(bounded.bytesUsed() == 2*1024*12*sizeof(double));
+  for (int i = 0; i < 20; ++i)
+  {
+    unsigned int k = rand() % bounded.counts();
+    assert(bounded.exp(k).approxEq(tw.exp(k*2*M_PI/bounded.counts()), 1e-12));
+  }
+  assert(bounded.bytesUsed() == 2*1024*12*sizeof(double));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Memory bound test passed." << std::endl;
+
+  screws::Twistd prismatic(screws::TwistCoordinatesd(1, 2, 3, 0, 0, 0));
+  screws::TwistExpCached prismaticCache(prismatic, bits);
+  assert(prismaticCache.exp(5).approxEq(prismatic.exp(5*step), 1e-12));
+  assert(prismaticCache.bytesUsed() == 0);
+
+  screws::TwistCoordinatesd xi = tw.coordinates();
+  screws::Twistf twf(screws::TwistCoordinatesf((float)xi(0), (float)xi(1), (float)xi(2),
+                                               (float)xi(3), (float)xi(4), (float)xi(5)));
+  screws::TwistExpCachef tableF(twf, 17);
+  k = rand() % tableF.counts();
+  assert(tableF.exp(k).approxEq(twf.exp((float)(k*2*M_PI/tableF.counts())), 1e-4f));
+  assert(tableF.bytesUsed() == 1024*2*sizeof(float));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Prismatic and single precision test passed." << std::endl;
+}
+
+void testRotationBatch()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == ROTATION BATCH == " << std::endl;
+  int testIdx = 1;
+
+  // Not a multiple of the block size or of any SIMD width.
+  const size_t n = 301;
+  std::vector<screws::Skewd> S(n);
+  std::vector<double> wx(n), wy(n), wz(n), theta(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    wx[i] = (double)rand()/RAND_MAX - 0.5;
+    wy[i] = (double)rand()/RAND_MAX - 0.5;
+    wz[i] = (double)rand()/RAND_MAX - 0.5;
+    theta[i] = 2*M_PI*(double)rand()/RAND_MAX;
+  }
+  wx[7] = wy[7] = wz[7] = 0;
+  theta[11] = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    S[i] = screws::Skewd(screws::Vector3d(wx[i], wy[i], wz[i]));
+  }
+
+  screws::RotationBatchd batch;
+  S[0].exp(&theta[0], n, batch);
+  assert(batch.size() == n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    assert(batch.rotation(i).approxEq(S[0].exp(theta[i]), 1e-12));
+    assert(batch.rotation(i).isValid());
+  }
+  assert(batch.rotation(11) == screws::Rotationd());
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch exponential of one skew test passed." << std::endl;
+
+  screws::RotationBatchd batchSoA, batchVec;
+  screws::Skewd::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batchSoA);
+  screws::Skewd::exp(S, theta, batchVec);
+  for (size_t i = 0; i < n; ++i)
+  {
+    screws::Rotationd R = S[i].exp(theta[i]);
+    assert(batchSoA.rotation(i).approxEq(R, 1e-12));
+    for (unsigned int r = 0; r < 3; ++r)
+      for (unsigned int c = 0; c < 3; ++c)
+        assert(batchVec(r, c, i) == batchSoA(r, c, i) && batchSoA.plane(r, c)[i] == batchSoA(r, c, i));
+  }
+  assert(batchSoA.rotation(7) == screws::Rotationd());
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch exponential of many skews test passed." << std::endl;
+
+  batchSoA.set(3, S[3].exp(1.0));
+  assert(batchSoA.rotation(3) == S[3].exp(1.0));
+  std::vector<double> shortTheta(n - 1);
+  try
+  {
+    screws::Skewd::exp(S, shortTheta, batchVec);
+    assert(false);
+  }
+  catch (screws::ScrewException&)
+  {
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch access and size check test passed." << std::endl;
+}
+
+void testBatchKernels()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == BATCH KERNELS == " << std::endl;
+  int testIdx = 1;
+
+  const size_t n = 301;
+  std::vector<double> wx(n), wy(n), wz(n), theta(n), ox(n), oy(n), oz(n);
+  std::vector<float> wxf(n), wyf(n), wzf(n), thetaf(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    wx[i] = (double)rand()/RAND_MAX - 0.5;
+    wy[i] = (double)rand()/RAND_MAX - 0.5;
+    wz[i] = (double)rand()/RAND_MAX - 0.5;
+    theta[i] = 2*M_PI*(double)rand()/RAND_MAX;
+  }
+  // Identity, and a rotation by pi that takes the symmetric part path of the logarithm.
+  wx[7] = wy[7] = wz[7] = 0;
+  theta[11] = M_PI/std::sqrt(wx[11]*wx[11] + wy[11]*wy[11] + wz[11]*wz[11]);
+  for (size_t i = 0; i < n; ++i)
+  {
+    wxf[i] = (float)wx[i];
+    wyf[i] = (float)wy[i];
+    wzf[i] = (float)wz[i];
+    thetaf[i] = (float)theta[i];
+  }
+  screws::Skewd S(screws::Vector3d(wx[0], wy[0], wz[0]));
+  screws::Skewf Sf(screws::Vector3f(wxf[0], wyf[0], wzf[0]));
+  screws::HomogeneousTransformd H(S.exp(1.0), screws::Translationd(1, 2, 3));
+
+  const screws::BatchKernels::Isa initial = screws::BatchKernels::isa();
+  const screws::BatchKernels::Isa all[] = { screws::BatchKernels::BASELINE, screws::BatchKernels::AVX2, screws::BatchKernels::AVX512 };
+  assert(screws::BatchKernels::isSupported(screws::BatchKernels::BASELINE));
+  for (unsigned int k = 0; k < 3; ++k)
+  {
+    if (!screws::BatchKernels::isSupported(all[k]))
     {
-      if (i % 10000 == 0)
-        std::cout << "Translation iteration " << i << " of " << maxIter << std::endl;
-      testTranslations();
+      try
+      {
+        screws::BatchKernels::setIsa(all[k]);
+        assert(false);
+      }
+      catch (screws::ScrewException&)
+      {
+      }
+      continue;
     }
-    std::cout << "\n\n" << std::endl;
+    screws::BatchKernels::setIsa(all[k]);
+    assert(screws::BatchKernels::isa() == all[k]);
+
+    screws::RotationBatchd batch;
+    screws::RotationBatchf batchf;
+    screws::BatchKernels::exp(S, &theta[0], n, batch);
+    screws::BatchKernels::exp(Sf, &thetaf[0], n, batchf);
+    for (size_t i = 0; i < n; ++i)
+    {
+      assert(batch.rotation(i).approxEq(S.exp(theta[i]), 1e-12));
+      assert(batchf.rotation(i).approxEq(Sf.exp(thetaf[i]), 1e-5f));
+    }
+
+    screws::BatchKernels::exp(&wx[0], &wy[0], &wz[0], &theta[0], n, batch);
+    screws::BatchKernels::exp(&wxf[0], &wyf[0], &wzf[0], &thetaf[0], n, batchf);
+    for (size_t i = 0; i < n; ++i)
+    {
+      screws::Skewd Si(screws::Vector3d(wx[i], wy[i], wz[i]));
+      screws::Skewf Sfi(screws::Vector3f(wxf[i], wyf[i], wzf[i]));
+      assert(batch.rotation(i).approxEq(Si.exp(theta[i]), 1e-12));
+      assert(batchf.rotation(i).approxEq(Sfi.exp(thetaf[i]), 1e-5f));
+    }
+    if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") " << screws::BatchKernels::isaName() << " batch exponential test passed." << std::endl;
+
+    screws::BatchKernels::log(batch, &ox[0], &oy[0], &oz[0]);
+    for (size_t i = 0; i < n; ++i)
+    {
+      screws::Vector3d w = batch.rotation(i).log().coordinates();
+      assert(std::fabs(w(0) - ox[i]) < 1e-9 && std::fabs(w(1) - oy[i]) < 1e-9 && std::fabs(w(2) - oz[i]) < 1e-9);
+    }
+    assert(ox[7] == 0 && oy[7] == 0 && oz[7] == 0);
+    std::vector<float> oxf(n), oyf(n), ozf(n);
+    screws::BatchKernels::log(batchf, &oxf[0], &oyf[0], &ozf[0]);
+    for (size_t i = 0; i < n; ++i)
+    {
+      screws::Skewf L(screws::Vector3f(oxf[i], oyf[i], ozf[i]));
+      assert(L.exp().approxEq(batchf.rotation(i), 1e-5f));
+    }
+    if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") " << screws::BatchKernels::isaName() << " batch logarithm test passed." << std::endl;
+
+    screws::BatchKernels::transform(H, &wx[0], &wy[0], &wz[0], n, &ox[0], &oy[0], &oz[0]);
+    for (size_t i = 0; i < n; ++i)
+    {
+      screws::Translationd p = H*screws::Translationd(wx[i], wy[i], wz[i]);
+      assert(std::fabs(p(0) - ox[i]) < 1e-12 && std::fabs(p(1) - oy[i]) < 1e-12 && std::fabs(p(2) - oz[i]) < 1e-12);
+    }
+    // In place.
+    std::vector<double> x(wx), y(wy), z(wz);
+    screws::BatchKernels::transform(H, &x[0], &y[0], &z[0], n, &x[0], &y[0], &z[0]);
+    assert(x == ox && y == oy && z == oz);
+    if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") " << screws::BatchKernels::isaName() << " batch transform test passed." << std::endl;
   }
+  screws::BatchKernels::setIsa(initial);
+}
 
-  if (TEST_ROTATIONS)
+void testTransformExpression()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == TRANSFORM EXPRESSION == " << std::endl;
+  int testIdx = 1;
+
+  screws::HomogeneousTransformd H[3];
+  screws::Rotationd R;
+  for (int k = 0; k < 3; ++k)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+    H[k] = screws::HomogeneousTransformd(S.exp(2*M_PI*(double)rand()/RAND_MAX),
+                                         screws::Translationd((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX));
+    R = S.exp(1.0);
+  }
+  screws::Translationd p((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+
+  screws::HomogeneousTransformd eager = H[0]*H[1]*H[2].inv();
+  screws::HomogeneousTransformd lazy = screws::lazy(H[0])*H[1]*screws::lazy(H[2]).inv();
+  assert(lazy.approxEq(eager, 1e-12));
+  assert(lazy.isValid());
+  assert((H[0]*screws::lazy(H[1])).eval().approxEq(H[0]*H[1], 1e-12));
+  assert((screws::lazy(H[0])*screws::lazy(H[1]).inv()*H[2]).rotation().approxEq(H[0].rotation()*H[1].rotation().inv()*H[2].rotation(), 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Lazy product evaluation test passed." << std::endl;
+
+  screws::Translationd q = screws::lazy(H[0])*H[1]*screws::lazy(H[2]).inv()*p;
+  assert(q.approxEq(eager*p, 1e-12));
+  q = screws::lazy(H[0]).inv()*(screws::lazy(H[0])*p);
+  assert(q.approxEq(p, 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Lazy point transformation test passed." << std::endl;
+
+  screws::HomogeneousTransformd inverse = (screws::lazy(H[0])*H[1]*H[2]).inv();
+  assert(inverse.approxEq((H[0]*H[1]*H[2]).inv(), 1e-12));
+  inverse = (screws::lazy(H[0])*H[1].inv()).inv().inv();
+  assert(inverse.approxEq(H[0]*H[1].inv(), 1e-12));
+  assert((screws::lazy(H[1])*screws::lazy(H[1]).inv()).eval().approxEq(screws::HomogeneousTransformd(), 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Lazy inversion test passed." << std::endl;
+
+  screws::HomogeneousTransformd HR(R, screws::Translationd());
+  lazy = screws::lazy(R)*H[0]*screws::lazy(R).inv();
+  assert(lazy.approxEq(HR*H[0]*HR.inv(), 1e-12));
+  lazy = R*(screws::lazy(H[0])*R);
+  assert(lazy.approxEq(HR*H[0]*HR, 1e-12));
+  assert((screws::lazy(R).inv()*p).approxEq(R.inv()*p, 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Lazy rotation factors test passed." << std::endl;
+}
+
+void testTransformBatch()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == TRANSFORM BATCH == " << std::endl;
+  int testIdx = 1;
+
+  const size_t nPoses = 40;
+  const size_t n = 301;
+  std::vector<screws::HomogeneousTransformd> poses(nPoses);
+  std::vector<screws::HomogeneousTransformf> posesf(nPoses);
+  for (size_t k = 0; k < nPoses; ++k)
+  {
+    screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+    poses[k] = screws::HomogeneousTransformd(S.exp(2*M_PI*(double)rand()/RAND_MAX),
+                                             screws::Translationd((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX));
+    posesf[k] = poses[k].cast<float>();
+  }
+  // Pure translation and pure rotation relative poses.
+  poses[1] = screws::HomogeneousTransformd(poses[0].rotation(), screws::Translationd(1, 2, 3));
+  poses[2] = screws::HomogeneousTransformd(poses[0].rotation()*screws::Skewd(screws::Vector3d(0, 0, 1)).exp(0.3), poses[0].translation());
+  std::vector<size_t> i(n), j(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    i[k] = (size_t)rand() % nPoses;
+    j[k] = (size_t)rand() % nPoses;
+  }
+  i[0] = 0; j[0] = 1;
+  i[1] = 0; j[1] = 2;
+  i[2] = 3; j[2] = 3;
+
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(poses[i[k]].relative(poses[j[k]]).approxEq(poses[i[k]].inv()*poses[j[k]], 1e-12));
+  }
+  assert(poses[3].relative(poses[3]).approxEq(screws::HomogeneousTransformd(), 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Relative pose test passed." << std::endl;
+
+  screws::TransformBatchd Hi(n), Hj(n), rel, relGather;
+  for (size_t k = 0; k < n; ++k)
+  {
+    Hi.set(k, poses[i[k]]);
+    Hj.set(k, poses[j[k]]);
+    assert(Hi.transform(k) == poses[i[k]]);
+  }
+  screws::TransformBatchd::relative(Hi, Hj, rel);
+  screws::TransformBatchd::relative(poses, &i[0], &j[0], n, relGather);
+  for (size_t k = 0; k < n; ++k)
+  {
+    screws::HomogeneousTransformd H = poses[i[k]].relative(poses[j[k]]);
+    assert(rel.transform(k).approxEq(H, 1e-12));
+    assert(relGather.transform(k).approxEq(H, 1e-12));
+    assert(rel(0, 3, k) == rel.plane(0, 3)[k] && rel(2, 1, k) == rel.rotations()(2, 1, k));
+  }
+  try
+  {
+    screws::TransformBatchd::relative(Hi, screws::TransformBatchd(n - 1), rel);
+    assert(false);
+  }
+  catch (screws::ScrewException&)
+  {
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch relative pose test passed." << std::endl;
+
+  std::vector<double> v[6], vGather[6];
+  for (int q = 0; q < 6; ++q)
+  {
+    v[q].resize(n);
+    vGather[q].resize(n);
+  }
+  screws::TransformBatchd::relativeLog(Hi, Hj, &v[0][0], &v[1][0], &v[2][0], &v[3][0], &v[4][0], &v[5][0]);
+  screws::TransformBatchd::relativeLog(poses, &i[0], &j[0], n, &vGather[0][0], &vGather[1][0], &vGather[2][0],
+                                       &vGather[3][0], &vGather[4][0], &vGather[5][0]);
+  for (size_t k = 0; k < n; ++k)
+  {
+    screws::TwistCoordinatesd c = poses[i[k]].relativeLog(poses[j[k]]).coordinates();
+    for (int q = 0; q < 6; ++q)
     {
-      if (i % 10000 == 0)
-        std::cout << "Rotation iteration " << i << " of " << maxIter << std::endl;
-      testRotations();
+      assert(std::fabs(c(q) - v[q][k]) < 1e-9*(1 + std::fabs(c(q))));
+      assert(v[q][k] == vGather[q][k]);
     }
-    std::cout << "\n\n" << std::endl;
   }
+  screws::Translationd pure = poses[0].relative(poses[1]).translation();
+  assert(std::fabs(v[0][0] - pure(0)) < 1e-12 && std::fabs(v[1][0] - pure(1)) < 1e-12 && std::fabs(v[2][0] - pure(2)) < 1e-12);
+  assert(v[3][0] == 0 && v[4][0] == 0 && v[5][0] == 0);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch relative pose log test passed." << std::endl;
 
-  if (TEST_HOMOGENEOUS_TRANSFORMS)
+  std::vector<float> vf[6];
+  for (int q = 0; q < 6; ++q)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    vf[q].resize(n);
+  }
+  screws::TransformBatchf::relativeLog(posesf, &i[0], &j[0], n, &vf[0][0], &vf[1][0], &vf[2][0], &vf[3][0], &vf[4][0], &vf[5][0]);
+  for (size_t k = 0; k < n; ++k)
+  {
+    screws::Twistf tw(vf[0][k], vf[1][k], vf[2][k], vf[3][k], vf[4][k], vf[5][k]);
+    assert(tw.exp().approxEq(posesf[i[k]].relative(posesf[j[k]]), 1e-4f));
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Single precision batch relative pose log test passed." << std::endl;
+
+  // A small relative rotation about -x is a small residual, not an angle just below 2pi.
+  const double small = 0.01*(double)rand()/RAND_MAX + 1e-4;
+  screws::Translationd offset((double)rand()/RAND_MAX - 0.5, 0.22, (double)rand()/RAND_MAX - 0.5);
+  screws::HomogeneousTransformd Ha = poses[2];
+  screws::HomogeneousTransformd Hb = Ha*screws::HomogeneousTransformd(screws::Skewd(screws::Vector3d(-1, 0, 0)).exp(small), offset);
+  screws::TwistCoordinatesd cs = Ha.relativeLog(Hb).coordinates();
+  assert(std::fabs(cs(3) + small) < 1e-12 && std::fabs(cs(4)) < 1e-12 && std::fabs(cs(5)) < 1e-12);
+  for (int q = 0; q < 3; ++q)
+  {
+    assert(std::fabs(cs(q) - offset(q)) < small*(std::fabs(offset(0)) + 0.5));
+  }
+  std::vector< screws::HomogeneousTransformd > pair;
+  pair.push_back(Ha);
+  pair.push_back(Hb);
+  std::vector< screws::HomogeneousTransformf > pairf;
+  pairf.push_back(Ha.cast<float>());
+  pairf.push_back(Hb.cast<float>());
+  const size_t a = 0, b = 1, one = 1;
+  double d[6];
+  float f[6];
+  screws::TransformBatchd::relativeLog(pair, &a, &b, one, &d[0], &d[1], &d[2], &d[3], &d[4], &d[5]);
+  screws::TransformBatchf::relativeLog(pairf, &a, &b, one, &f[0], &f[1], &f[2], &f[3], &f[4], &f[5]);
+  for (int q = 0; q < 6; ++q)
+  {
+    assert(std::fabs(d[q] - cs(q)) < 1e-9);
+    assert(std::fabs(f[q] - cs(q)) < 1e-4);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Small relative rotation about -x log test passed." << std::endl;
+}
+
+void testChain()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == CHAIN == " << std::endl;
+  int testIdx = 1;
+
+  // Random revolute joints (v = -w x q for a unit axis w through q) and one prismatic joint.
+  const size_t n = 6;
+  std::vector<screws::Twistd> twists;
+  for (size_t k = 0; k < n; ++k)
+  {
+    if (k == 2)
     {
-      if (i % 10000 == 0)
-        std::cout << "HomogeneousTransform iteration " << i << " of " << maxIter << std::endl;
-      testHomogeneousTransforms();
+      screws::Vector3d v = screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, 1.0).normalised();
+      twists.push_back(screws::Twistd(v(0), v(1), v(2), 0, 0, 0));
+      continue;
     }
-    std::cout << "\n\n" << std::endl;
+    screws::Vector3d w = screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5).normalised();
+    screws::Vector3d q((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+    screws::Vector3d v = q.cross(w);
+    twists.push_back(screws::Twistd(v(0), v(1), v(2), w(0), w(1), w(2)));
+  }
+  screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  screws::HomogeneousTransformd home(S.exp(), screws::Translationd(0.1, 0.2, 1.0));
+  screws::Chaind chain(twists, home);
+  assert(chain.joints() == n);
+  assert(chain.home() == home);
+  assert(chain.twist(3) == twists[3]);
+
+  std::vector<double> q(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    q[k] = 2*M_PI*(double)rand()/RAND_MAX - M_PI;
   }
 
-  if (TEST_SKEWS)
+  screws::HomogeneousTransformd expected;
+  for (size_t k = 0; k < n; ++k)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    expected *= twists[k].exp(q[k]);
+  }
+  expected *= home;
+  screws::HomogeneousTransformd g = chain.forwardKinematics(q);
+  assert(g.approxEq(expected, 1e-12));
+  screws::HomogeneousTransformd gInto;
+  chain.forwardKinematics(&q[0], gInto);
+  assert(gInto == g);
+  std::vector<double> zero(n, 0.0);
+  assert(chain.forwardKinematics(zero).approxEq(home, 1e-12));
+  // A screw joint, with pitch and an axis of non-unit length.
+  screws::Twistd screw(0.3, -0.2, 0.5, 0.0, 1.2, -0.9);
+  screws::Chaind pitched(std::vector<screws::Twistd>(1, screw), home);
+  assert(pitched.forwardKinematics(std::vector<double>(1, 0.8)).approxEq(screw.exp(0.8)*home, 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Forward kinematics test passed." << std::endl;
+
+  // Column k is the spatial velocity twist dg/dq_k g^-1, so g(q + h e_k) = exp(J_k h) g(q) + O(h^2).
+  // (The logarithm of the small difference is not used: its angle may come back as 2pi - h.)
+  screws::Chaind::Jacobian J = chain.spatialJacobian(q);
+  assert(J.rows() == 6 && (size_t)J.cols() == n);
+  const double h = 1e-6;
+  for (size_t k = 0; k < n; ++k)
+  {
+    std::vector<double> qp = q;
+    qp[k] += h;
+    screws::Twistd Jk(J(0, k), J(1, k), J(2, k), J(3, k), J(4, k), J(5, k));
+    assert((Jk.exp(h)*g).approxEq(chain.forwardKinematics(qp), 1e-10));
+  }
+  // The first column is the first twist, whatever the configuration.
+  screws::TwistCoordinates<double> c0 = twists[0].coordinates();
+  for (unsigned int r = 0; r < 6; ++r)
+  {
+    assert(J(r, 0) == c0(r));
+  }
+  screws::Chaind::Jacobian JInto(6, n);
+  chain.spatialJacobian(&q[0], JInto);
+  assert(JInto == J);
+  screws::Chaind::Jacobian JResized;
+  chain.spatialJacobian(&q[0], JResized);
+  assert(JResized == J);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Spatial Jacobian test passed." << std::endl;
+
+  // The Lie bracket is the commutator of the twist matrices.
+  screws::Twistd bracket = twists[0].ad(twists[1]);
+  Eigen::Matrix4d X0, X1;
+  for (unsigned int r = 0; r < 4; ++r)
+  {
+    for (unsigned int s = 0; s < 4; ++s)
     {
-      if (i % 10000 == 0)
-        std::cout << "Skew iteration " << i << " of " << maxIter << std::endl;
-      testSkews();
+      X0(r, s) = twists[0](r, s);
+      X1(r, s) = twists[1](r, s);
     }
-    std::cout << "\n\n" << std::endl;
   }
+  Eigen::Matrix4d commutator = X0*X1 - X1*X0;
+  for (unsigned int r = 0; r < 4; ++r)
+  {
+    for (unsigned int s = 0; s < 4; ++s)
+    {
+      assert(std::abs(bracket(r, s) - commutator(r, s)) < 1e-15);
+    }
+  }
+  // The Jacobian derivative equals the central difference along qd, and its pass gives the same J.
+  std::vector<double> qd(n), qp = q, qm = q;
+  for (size_t k = 0; k < n; ++k)
+  {
+    qd[k] = 2*(double)rand()/RAND_MAX - 1;
+    qp[k] += h*qd[k];
+    qm[k] -= h*qd[k];
+  }
+  screws::Chaind::Jacobian Jdot = chain.spatialJacobianDerivative(q, qd);
+  screws::Chaind::Jacobian difference = (chain.spatialJacobian(qp) - chain.spatialJacobian(qm))/(2*h);
+  assert((Jdot - difference).cwiseAbs().maxCoeff() < 1e-8);
+  assert(Jdot.col(0).isZero(0.0));
+  screws::Chaind::Jacobian JPass, JdotInto;
+  chain.spatialJacobian(&q[0], &qd[0], JPass, JdotInto);
+  assert(JPass == J && JdotInto == Jdot);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Jacobian derivative test passed." << std::endl;
+
+  bool thrown = false;
+  try
+  {
+    std::vector<double> wrong(n + 1, 0.0);
+    chain.forwardKinematics(wrong);
+  }
+  catch (screws::ScrewException& e)
+  {
+    thrown = (std::string(e.what()).find("Number of joint values") != std::string::npos);
+  }
+  assert(thrown);
+  thrown = false;
+  try
+  {
+    chain.spatialJacobian(std::vector<double>(n - 1, 0.0));
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  thrown = false;
+  try
+  {
+    chain.spatialJacobianDerivative(q, std::vector<double>(n - 1, 0.0));
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Joint count mismatch test passed." << std::endl;
+}
 
-  if (TEST_TWISTS)
+void testWrench()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == WRENCH == " << std::endl;
+  int testIdx = 1;
+
+  screws::Wrenchd F(2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1,
+                    2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1);
+  assert(F.force()(1) == F(1) && F.moment()(2) == F(5));
+  screws::TwistCoordinatesd V((double)rand()/RAND_MAX, -0.3, (double)rand()/RAND_MAX, 0.2, (double)rand()/RAND_MAX, -0.1);
+  assert(std::abs(F.power(V) - F.dot(V)) < 1e-15);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Power test passed." << std::endl;
+
+  // A force f through the point c of frame b is the wrench (f; c x f). In a frame a with origin at
+  // c it is a pure force, rotated into the axes of a; and the power on any twist is unchanged.
+  screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  screws::Translationd c((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+  screws::HomogeneousTransformd g(S.exp(), c);
+  screws::Translationd f(0.5, -1.0, 9.81);
+  screws::Wrenchd Fb(f, c.cross(f));
+  screws::Wrenchd Fa = Fb.changeFrame(g);
+  assert(Fa.force().approxEq(g.rotation().inv()*f, 1e-12));
+  assert(Fa.moment().approxEq(screws::Translationd(), 1e-12));
+  screws::TwistCoordinatesd Va = screws::Adjointd(g.inv())*V;
+  assert(std::abs(Fa.power(Va) - Fb.power(V)) < 1e-12);
+  assert(Fa.changeFrame(g.inv()).approxEq(Fb, 1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Frame change test passed." << std::endl;
+
+  // Batch: the same as one at a time, also in place, and the same as the transposed 6x6 matrix.
+  const size_t n = 37;
+  std::vector<screws::Wrenchd> wrenches(n), moved(n);
+  for (size_t k = 0; k < n; ++k)
   {
-    for(int i = 1; i <= maxIter; ++i)
+    wrenches[k] = screws::Wrenchd(2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1,
+                                  2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1, 2*(double)rand()/RAND_MAX - 1);
+  }
+  screws::Wrenchd::changeFrame(g, &wrenches[0], n, &moved[0]);
+  screws::Adjointd::Matrix AdT = screws::Adjointd(g).matrix().transpose();
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(moved[k].approxEq(wrenches[k].changeFrame(g), 1e-14));
+    screws::Adjointd::Coordinates raw;
+    raw << wrenches[k](0), wrenches[k](1), wrenches[k](2), wrenches[k](3), wrenches[k](4), wrenches[k](5);
+    screws::Adjointd::Coordinates expected = AdT*raw;
+    for (unsigned int r = 0; r < 6; ++r)
     {
-      if (i % 10000 == 0)
-        std::cout << "Twist iteration " << i << " of " << maxIter << std::endl;
-      testTwists();
+      assert(std::abs(moved[k](r) - expected(r)) < 1e-12);
+    }
+  }
+  screws::Wrenchd::changeFrame(g, &wrenches[0], n, &wrenches[0]);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(wrenches[k] == moved[k]);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch frame change test passed." << std::endl;
+}
+
+// A random chain of revolute joints with one prismatic joint, and random links.
+screws::Dynamicsd randomDynamics(const size_t& n)
+{
+  std::vector<screws::Twistd> twists;
+  for (size_t k = 0; k < n; ++k)
+  {
+    if (k == 2)
+    {
+      screws::Vector3d v = screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, 1.0).normalised();
+      twists.push_back(screws::Twistd(v(0), v(1), v(2), 0, 0, 0));
+      continue;
+    }
+    screws::Vector3d w = screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5).normalised();
+    screws::Vector3d q((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+    screws::Vector3d v = q.cross(w);
+    twists.push_back(screws::Twistd(v(0), v(1), v(2), w(0), w(1), w(2)));
+  }
+  screws::Dynamicsd dynamics(screws::Chaind(twists, screws::HomogeneousTransformd()));
+  for (size_t k = 0; k < n; ++k)
+  {
+    screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+    screws::HomogeneousTransformd frame(S.exp(), screws::Translationd((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX));
+    screws::Translationd com(0.2*(double)rand()/RAND_MAX - 0.1, 0.2*(double)rand()/RAND_MAX - 0.1, 0.2*(double)rand()/RAND_MAX - 0.1);
+    dynamics.setLink(k, frame, screws::SpatialInertiad(1 + (double)rand()/RAND_MAX, com,
+                                                       0.02 + 0.01*(double)rand()/RAND_MAX,
+                                                       0.02 + 0.01*(double)rand()/RAND_MAX,
+                                                       0.02 + 0.01*(double)rand()/RAND_MAX, 0.001, -0.002, 0.001));
+  }
+
+  return dynamics;
+}
+
+// Mass matrix from inverse dynamics without gravity and velocity: column k is tau(q, 0, e_k).
+Eigen::MatrixXd massMatrixByInverseDynamics(const screws::Dynamicsd& dynamics, const std::vector<double>& q)
+{
+  screws::Dynamicsd noGravity = dynamics;
+  noGravity.setGravity(screws::Translationd(0, 0, 0));
+  const size_t n = dynamics.joints();
+  Eigen::MatrixXd M(n, n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    std::vector<double> qdd(n, 0.0);
+    qdd[k] = 1;
+    std::vector<double> tau = noGravity.inverseDynamics(q, std::vector<double>(n, 0.0), qdd);
+    for (size_t r = 0; r < n; ++r)
+    {
+      M(r, k) = tau[r];
+    }
+  }
+
+  return M;
+}
+
+void testDynamics()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == DYNAMICS == " << std::endl;
+  int testIdx = 1;
+
+  // Adjoint: matrix form, composition, inverse, and g exp(xi t) g^-1 = exp((Ad_g xi) t).
+  screws::Skewd S1(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  screws::Skewd S2(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  screws::HomogeneousTransformd g(S1.exp(), screws::Translationd((double)rand()/RAND_MAX, -(double)rand()/RAND_MAX, 0.5));
+  screws::HomogeneousTransformd h(S2.exp(), screws::Translationd(-0.3, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX));
+  screws::Adjointd Ad(g);
+  screws::Twistd xi((double)rand()/RAND_MAX, (double)rand()/RAND_MAX, -0.2, (double)rand()/RAND_MAX - 0.5, 0.3, (double)rand()/RAND_MAX - 0.5);
+  screws::TwistCoordinatesd c = xi.coordinates();
+  screws::TwistCoordinatesd moved = Ad*c;
+  screws::Adjointd::Coordinates raw, rawMoved;
+  raw << c(0), c(1), c(2), c(3), c(4), c(5);
+  rawMoved = Ad.matrix()*raw;
+  for (unsigned int r = 0; r < 6; ++r)
+  {
+    assert(std::abs(moved(r) - rawMoved(r)) < 1e-12);
+  }
+  assert((Ad*screws::Adjointd(h)).approxEq(screws::Adjointd(g*h), 1e-12));
+  assert(Ad.inv().approxEq(screws::Adjointd(g.inv()), 1e-12));
+  assert((Ad.inv()*Ad).approxEq(screws::Adjointd(), 1e-12));
+  assert(Ad.transform().approxEq(g, 1e-15));
+  const double t = 0.7;
+  assert((g*xi.exp(t)*g.inv()).approxEq((Ad*xi).exp(t), 1e-10));
+  // The power of a wrench on a twist does not depend on the frame: (Ad^T F).xi = F.(Ad xi).
+  screws::Wrenchd F(0.3, -1.2, 2.0, 0.1, 0.4, -0.5);
+  assert(std::abs(Ad.transposeTimes(F).dot(c) - F.dot(moved)) < 1e-12);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Adjoint test passed." << std::endl;
+
+  // Spatial inertia: the compact product equals the 6x6 matrix, which is symmetric, and a body
+  // translating with v has momentum m v and moment c x m v about the origin.
+  screws::Translationd com(0.1, -0.2, 0.3);
+  screws::SpatialInertiad G(2.0, com, 0.03, 0.04, 0.05, 0.001, 0.002, -0.001);
+  assert(G.mass() == 2.0);
+  assert(G.centreOfMass().approxEq(com, 1e-15));
+  screws::SpatialInertiad::Matrix Gm = G.matrix();
+  assert((Gm - Gm.transpose()).cwiseAbs().maxCoeff() < 1e-15);
+  screws::Wrenchd momentum = G*c;
+  screws::SpatialInertiad::Coordinates expectedMomentum = Gm*raw;
+  for (unsigned int r = 0; r < 6; ++r)
+  {
+    assert(std::abs(momentum(r) - expectedMomentum(r)) < 1e-12);
+  }
+  screws::Wrenchd translating = G*screws::TwistCoordinatesd(1, 0, 0, 0, 0, 0);
+  assert(translating.force().approxEq(screws::Translationd(2, 0, 0), 1e-15));
+  assert(translating.moment().approxEq(com.cross(screws::Translationd(2, 0, 0)), 1e-15));
+  // A change of frame equals Ad_g^T G Ad_g, and keeps the mass and the centre of mass.
+  screws::SpatialInertiad Gg = G.changeFrame(g);
+  screws::SpatialInertiad::Matrix X = Ad.matrix();
+  assert((Gg.matrix() - X.transpose()*Gm*X).cwiseAbs().maxCoeff() < 1e-12);
+  assert(Gg.mass() == G.mass());
+  assert((g*Gg.centreOfMass()).approxEq(com, 1e-12));
+  assert(((G + Gg).matrix() - (Gm + Gg.matrix())).cwiseAbs().maxCoeff() < 1e-15);
+  bool thrown = false;
+  try
+  {
+    screws::SpatialInertiad negative(-1.0, com, 1, 1, 1);
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Spatial inertia test passed." << std::endl;
+
+  // Pendulum: a point mass m at distance l from a joint about x, with z up:
+  // tau = m l^2 qdd + m g l cos(q).
+  {
+    const double m = 1.5, l = 0.8, gravity = 9.81;
+    std::vector<screws::Twistd> joint(1, screws::Twistd(0, 0, 0, 1, 0, 0));
+    screws::Dynamicsd pendulum(screws::Chaind(joint, screws::HomogeneousTransformd()));
+    pendulum.setLink(0, screws::HomogeneousTransformd(screws::Rotationd(), screws::Translationd(0, l, 0)),
+                     screws::SpatialInertiad(m, screws::Translationd(), 0, 0, 0));
+    const double q = 2*M_PI*(double)rand()/RAND_MAX - M_PI, qd = (double)rand()/RAND_MAX, qdd = (double)rand()/RAND_MAX - 0.5;
+    std::vector<double> tau = pendulum.inverseDynamics(std::vector<double>(1, q), std::vector<double>(1, qd), std::vector<double>(1, qdd));
+    assert(std::abs(tau[0] - (m*l*l*qdd + m*gravity*l*cos(q))) < 1e-12);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Pendulum test passed." << std::endl;
+
+  const size_t n = 6;
+  screws::Dynamicsd dynamics = randomDynamics(n);
+  std::vector<double> q(n), qd(n), qdd(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    q[k] = 2*M_PI*(double)rand()/RAND_MAX - M_PI;
+    qd[k] = 2*(double)rand()/RAND_MAX - 1;
+    qdd[k] = 2*(double)rand()/RAND_MAX - 1;
+  }
+
+  // Gravity torques are the gradient of the potential energy -sum m_i g.c_i(q), with the centre of
+  // mass c_i(q) = exp(xi_1 q_1)...exp(xi_i q_i) M_i c_i.
+  std::vector<double> zero(n, 0.0);
+  std::vector<double> gravityTorques = dynamics.inverseDynamics(q, zero, zero);
+  screws::Translationd gravity = dynamics.gravity();
+  auto potential = [&](const std::vector<double>& qp)
+  {
+    double P = 0;
+    screws::HomogeneousTransformd gi;
+    for (size_t i = 0; i < n; ++i)
+    {
+      gi *= dynamics.chain().twist(i).exp(qp[i]);
+      screws::Translationd ci = gi*dynamics.linkFrame(i)*dynamics.inertia(i).centreOfMass();
+      P -= dynamics.inertia(i).mass()*gravity.dot(ci);
+    }
+    return P;
+  };
+  const double step = 1e-6;
+  for (size_t k = 0; k < n; ++k)
+  {
+    std::vector<double> qp = q, qm = q;
+    qp[k] += step;
+    qm[k] -= step;
+    assert(std::abs(gravityTorques[k] - (potential(qp) - potential(qm))/(2*step)) < 1e-6);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Gravity test passed." << std::endl;
+
+  // The mass matrix is symmetric positive definite, and the velocity torques satisfy
+  // qd.C(q, qd) qd = qd.dM/dt qd/2 (the power of the Coriolis forces is the change of kinetic energy).
+  Eigen::MatrixXd M = massMatrixByInverseDynamics(dynamics, q);
+  assert((M - M.transpose()).cwiseAbs().maxCoeff() < 1e-10);
+  assert(Eigen::LLT<Eigen::MatrixXd>(M).info() == Eigen::Success);
+  screws::Dynamicsd noGravity = dynamics;
+  noGravity.setGravity(screws::Translationd(0, 0, 0));
+  std::vector<double> velocityTorques = noGravity.inverseDynamics(q, qd, zero);
+  std::vector<double> qp = q, qm = q;
+  Eigen::VectorXd v(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    qp[k] += step*qd[k];
+    qm[k] -= step*qd[k];
+    v(k) = qd[k];
+  }
+  Eigen::MatrixXd dM = (massMatrixByInverseDynamics(dynamics, qp) - massMatrixByInverseDynamics(dynamics, qm))/(2*step);
+  double power = 0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    power += qd[k]*velocityTorques[k];
+  }
+  assert(std::abs(power - 0.5*v.dot(dM*v)) < 1e-6);
+
+  // The full torque is the sum of the parts, and the workspace form agrees with the vector form.
+  std::vector<double> tau = dynamics.inverseDynamics(q, qd, qdd);
+  Eigen::VectorXd a(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    a(k) = qdd[k];
+  }
+  Eigen::VectorXd Ma = M*a;
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(tau[k] - (Ma(k) + velocityTorques[k] + gravityTorques[k])) < 1e-10);
+  }
+  screws::Dynamicsd::Workspace ws;
+  std::vector<double> tauInto(n);
+  dynamics.inverseDynamics(&q[0], &qd[0], &qdd[0], &tauInto[0], ws);
+  assert(ws.joints() == n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(tauInto[k] == tau[k]);
+    // tau_k is the power of the joint wrench on the joint axis, both in the link frame.
+    screws::TwistCoordinatesd axis = screws::Adjointd(dynamics.linkFrame(k).inv())*dynamics.chain().twist(k).coordinates();
+    assert(std::abs(ws.wrench(k).dot(axis) - tau[k]) < 1e-10);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Inverse dynamics test passed." << std::endl;
+
+  // Forward dynamics inverts inverse dynamics, and equals the solution with the mass matrix.
+  std::vector<double> accelerations = dynamics.forwardDynamics(q, qd, tau);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(accelerations[k] - qdd[k]) < 1e-9);
+  }
+  Eigen::VectorXd rhs(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    rhs(k) = -(velocityTorques[k] + gravityTorques[k]);
+  }
+  Eigen::VectorXd fall = M.ldlt().solve(rhs);
+  std::vector<double> falling = dynamics.forwardDynamics(q, qd, zero);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(falling[k] - fall(k)) < 1e-9);
+  }
+
+  // A batch of states with one workspace equals the states one at a time.
+  const size_t states = 3;
+  std::vector<double> qs, qds, taus, qdds(states*n);
+  for (size_t s = 0; s < states; ++s)
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      qs.push_back(q[k] + 0.1*s);
+      qds.push_back(qd[k] - 0.2*s);
+      taus.push_back(tau[k]*s);
+    }
+  }
+  std::vector<screws::Dynamicsd::Workspace> workspaces(2);
+  dynamics.forwardDynamics(&qs[0], &qds[0], &taus[0], &qdds[0], states, workspaces);
+  for (size_t s = 0; s < states; ++s)
+  {
+    std::vector<double> single = dynamics.forwardDynamics(std::vector<double>(qs.begin() + s*n, qs.begin() + (s + 1)*n),
+                                                          std::vector<double>(qds.begin() + s*n, qds.begin() + (s + 1)*n),
+                                                          std::vector<double>(taus.begin() + s*n, taus.begin() + (s + 1)*n));
+    for (size_t k = 0; k < n; ++k)
+    {
+      assert(qdds[s*n + k] == single[k]);
+    }
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Forward dynamics test passed." << std::endl;
+
+  // The composite rigid body mass matrix equals the one from unit accelerations, the bias forces
+  // are the torques without acceleration, and the combined call equals both.
+  Eigen::MatrixXd crba = dynamics.massMatrix(q);
+  assert((crba - M).cwiseAbs().maxCoeff() < 1e-10);
+  std::vector<double> bias = dynamics.biasForces(q, qd);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(bias[k] - (velocityTorques[k] + gravityTorques[k])) < 1e-10);
+  }
+  screws::Dynamicsd::MassMatrix upper = screws::Dynamicsd::MassMatrix::Zero(n, n);
+  std::vector<double> biasInto(n);
+  dynamics.massMatrixAndBias(&q[0], &qd[0], upper, &biasInto[0], ws, true);
+  for (size_t j = 0; j < n; ++j)
+  {
+    assert(biasInto[j] == bias[j]);
+    for (size_t k = 0; k < n; ++k)
+    {
+      assert(upper(k, j) == ((k <= j) ? crba(k, j) : 0.0));
+    }
+  }
+  Eigen::VectorXd fallUpper = Eigen::LLT<Eigen::MatrixXd, Eigen::Upper>(upper).solve(rhs);
+  assert((fallUpper - fall).cwiseAbs().maxCoeff() < 1e-9);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Mass matrix test passed." << std::endl;
+
+  // The gravity fast path equals inverse dynamics at rest. A payload in the tool frame equals the
+  // same body added to the last link, and a batch equals the configurations one at a time.
+  std::vector<double> holding = dynamics.gravityTorques(q);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(holding[k] - gravityTorques[k]) < 1e-10);
+  }
+  screws::SpatialInertiad payload(0.7, screws::Translationd(0.02, -0.01, 0.05), 0.001, 0.001, 0.001);
+  screws::Dynamicsd loaded = dynamics;
+  screws::HomogeneousTransformd lastFrame = dynamics.linkFrame(n - 1);
+  loaded.setLink(n - 1, lastFrame, dynamics.inertia(n - 1) + payload.changeFrame(dynamics.chain().home().inv()*lastFrame));
+  std::vector<double> carrying = dynamics.gravityTorques(q, payload);
+  std::vector<double> carryingRnea = loaded.inverseDynamics(q, zero, zero);
+  for (size_t k = 0; k < n; ++k)
+  {
+    assert(std::abs(carrying[k] - carryingRnea[k]) < 1e-10);
+  }
+  std::vector<double> holdingBatch(states*n);
+  dynamics.gravityTorques(&qs[0], &holdingBatch[0], states, ws, payload);
+  for (size_t s = 0; s < states; ++s)
+  {
+    std::vector<double> single = dynamics.gravityTorques(std::vector<double>(qs.begin() + s*n, qs.begin() + (s + 1)*n), payload);
+    for (size_t k = 0; k < n; ++k)
+    {
+      assert(holdingBatch[s*n + k] == single[k]);
+    }
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Gravity compensation test passed." << std::endl;
+
+  thrown = false;
+  try
+  {
+    dynamics.inverseDynamics(q, qd, std::vector<double>(n + 1, 0.0));
+  }
+  catch (screws::ScrewException& e)
+  {
+    thrown = (std::string(e.what()).find("Number of joint values") != std::string::npos);
+  }
+  assert(thrown);
+  thrown = false;
+  try
+  {
+    dynamics.setLink(n, screws::HomogeneousTransformd(), screws::SpatialInertiad());
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  thrown = false;
+  try
+  {
+    screws::Dynamicsd massless(dynamics.chain());
+    massless.forwardDynamics(q, qd, tau);
+  }
+  catch (screws::ScrewException& e)
+  {
+    thrown = (std::string(e.what()).find("no inertia") != std::string::npos);
+  }
+  assert(thrown);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Dynamics size mismatch test passed." << std::endl;
+}
+
+// Largest element difference of two poses.
+double poseError(const screws::HomogeneousTransformd& a, const screws::HomogeneousTransformd& b)
+{
+  double e = 0;
+  for (unsigned int r = 0; r < 3; ++r)
+  {
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+      e = std::max(e, std::abs(a(r, c) - b(r, c)));
+    }
+  }
+  return e;
+}
+
+void testLieIntegrator()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == LIE INTEGRATOR == " << std::endl;
+  int testIdx = 1;
+  typedef screws::LieIntegratord L;
+
+  screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  const screws::HomogeneousTransformd g0(S.exp(), screws::Translationd((double)rand()/RAND_MAX, 0.2, -(double)rand()/RAND_MAX));
+  const L::Method methods[3] = { L::RKMK4, L::CROUCH_GROSSMAN3, L::MAGNUS4 };
+
+  // A constant body velocity is integrated exactly by every method: g(T) = g0 exp(V T).
+  const screws::TwistCoordinatesd constant(0.3, -0.2, 0.5, 0.4, 0.7, -0.6);
+  auto still = [&](const double&, const screws::HomogeneousTransformd&) { return constant; };
+  const screws::HomogeneousTransformd exact = g0*screws::Twistd(constant).exp(1.3);
+  for (int m = 0; m < 3; ++m)
+  {
+    assert(poseError(L::integrate(still, 0.0, g0, 0.13, 10, methods[m]), exact) < 1e-12);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Constant velocity test passed." << std::endl;
+
+  // Halving the step divides the error by 2^order: 4 for RKMK4, 3 for Crouch-Grossman, with a
+  // velocity of time and pose; 4 for Magnus, with a velocity of time only.
+  auto ofPose = [](const double& t, const screws::HomogeneousTransformd& g)
+  {
+    return screws::TwistCoordinatesd(0.5 + 0.3*sin(2*t), -g(2, 3), g(1, 3), g(2, 0), 0.8*cos(t), -0.5*g(0, 3));
+  };
+  auto ofTime = [](const double& t, const screws::HomogeneousTransformd&)
+  {
+    return screws::TwistCoordinatesd(0.5 + 0.3*sin(2*t), -0.2*t, cos(3*t), 0.6*sin(t), 0.8*cos(t), 1.0 - t*t);
+  };
+  const screws::HomogeneousTransformd poseReference = L::integrate(ofPose, 0.0, g0, 1.0/512, 512);
+  const screws::HomogeneousTransformd timeReference = L::integrate(ofTime, 0.0, g0, 1.0/512, 512);
+  const double orders[3] = { 4, 3, 4 };
+  for (int m = 0; m < 3; ++m)
+  {
+    const bool timeOnly = (methods[m] == L::MAGNUS4);
+    const screws::HomogeneousTransformd& reference = timeOnly ? timeReference : poseReference;
+    double coarse, fine;
+    if (timeOnly)
+    {
+      coarse = poseError(L::integrate(ofTime, 0.0, g0, 1.0/8, 8, methods[m]), reference);
+      fine = poseError(L::integrate(ofTime, 0.0, g0, 1.0/16, 16, methods[m]), reference);
+    }
+    else
+    {
+      coarse = poseError(L::integrate(ofPose, 0.0, g0, 1.0/8, 8, methods[m]), reference);
+      fine = poseError(L::integrate(ofPose, 0.0, g0, 1.0/16, 16, methods[m]), reference);
+    }
+    assert(coarse/fine > 0.7*pow(2.0, orders[m]));
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Convergence order test passed." << std::endl;
+
+  // Many steps stay on the group, with no re-orthonormalisation.
+  screws::HomogeneousTransformd far = L::integrate(ofPose, 0.0, g0, 0.01, 1000);
+  assert(far.isValid(1e-12));
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Group drift test passed." << std::endl;
+
+  // On SO(3), a step equals the rotation of the SE(3) step of the same angular velocity.
+  auto spin = [](const double& t, const screws::Rotationd& R) { return screws::Vector3d(R(2, 0), 0.8*cos(t), 0.3); };
+  auto spinTwist = [](const double& t, const screws::HomogeneousTransformd& g) { return screws::TwistCoordinatesd(0, 0, 0, g(2, 0), 0.8*cos(t), 0.3); };
+  for (int m = 0; m < 3; ++m)
+  {
+    screws::Rotationd R = L::step(spin, 0.2, S.exp(), 0.1, methods[m]);
+    screws::HomogeneousTransformd g = L::step(spinTwist, 0.2, screws::HomogeneousTransformd(S.exp(), screws::Translationd()), 0.1, methods[m]);
+    for (unsigned int r = 0; r < 3; ++r)
+    {
+      for (unsigned int c = 0; c < 3; ++c)
+      {
+        assert(std::abs(R(r, c) - g(r, c)) < 1e-14);
+      }
+    }
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Rotation step test passed." << std::endl;
+
+  // A batch step equals the bodies stepped one at a time.
+  const size_t bodies = 4;
+  std::vector<screws::HomogeneousTransformd> poses(bodies);
+  for (size_t i = 0; i < bodies; ++i)
+  {
+    poses[i] = g0*screws::Twistd(0.1*i, 0.2, -0.1, 0.3, 0.1*i, 0.5).exp();
+  }
+  auto each = [&](const size_t& i, const double& t, const screws::HomogeneousTransformd& g) { return ofPose(t + 0.1*i, g); };
+  std::vector<screws::HomogeneousTransformd> stepped = poses;
+  L::step(each, 0.3, &stepped[0], bodies, 0.05, L::CROUCH_GROSSMAN3);
+  for (size_t i = 0; i < bodies; ++i)
+  {
+    auto one = [&](const double& t, const screws::HomogeneousTransformd& g) { return each(i, t, g); };
+    assert(stepped[i] == L::step(one, 0.3, poses[i], 0.05, L::CROUCH_GROSSMAN3));
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch step test passed." << std::endl;
+}
+
+void testCosseratRod()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == COSSERAT ROD == " << std::endl;
+  int testIdx = 1;
+  typedef screws::CosseratRodd Rod;
+
+  // A nitinol tube: E = 60 GPa, nu = 0.3, 0.5 mm outer and 0.35 mm inner radius, 0.2 m long.
+  const double E = 60e9, G = E/2.6, ro = 0.5e-3, ri = 0.35e-3, L = 0.2;
+  Rod rod(L, E, G, ro, ri, 24);
+  Rod::Workspace ws;
+  screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5));
+  const screws::HomogeneousTransformd base(S.exp(), screws::Translationd((double)rand()/RAND_MAX, 0.1, -0.3));
+
+  // Unloaded and straight, the tip is L along the base z axis.
+  assert(rod.solve(base, screws::Wrenchd(), ws));
+  assert(poseError(ws.tipPose(), base*screws::HomogeneousTransformd(screws::Rotationd(), screws::Translationd(0, 0, L))) < 1e-12);
+  assert(ws.steps() == 24 && ws.pose(0) == base);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Straight rod test passed." << std::endl;
+
+  // Unloaded and precurved, the rod is the exponential of its strain, a helix.
+  Rod curved(L, E, G, ro, ri, 24);
+  curved.setPrecurvature(screws::Translationd(4, -2, 1));
+  ws.reset();
+  assert(curved.solve(base, screws::Wrenchd(), ws));
+  assert(poseError(ws.tipPose(), base*screws::Twistd(0, 0, 1, 4, -2, 1).exp(L)) < 1e-12);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Precurved rod test passed." << std::endl;
+
+  // A small force across the tip deflects a cantilever by F L^3/(3 E I).
+  const double F = 1e-3, I = M_PI/4*(pow(ro, 4) - pow(ri, 4));
+  const screws::HomogeneousTransformd upright;
+  ws.reset();
+  assert(rod.solve(upright, screws::Wrenchd(F, 0, 0, 0, 0, 0), ws));
+  assert(std::abs(ws.tipPose()(0, 3)/(F*L*L*L/(3*E*I)) - 1) < 0.01);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Cantilever test passed." << std::endl;
+
+  // A large load on the precurved rod: the base wrench balances it in world axes, to the
+  // discretisation error, as the frames and the wrench are integrated by different schemes.
+  const screws::Wrenchd load(0.05*((double)rand()/RAND_MAX - 0.5), 0.05, -0.02, 0.001, -0.002*(double)rand()/RAND_MAX, 0.0005);
+  ws.reset();
+  assert(curved.solve(base, load, ws));
+  const screws::Wrenchd internal = ws.internalWrench(0);
+  const screws::Vector3d n = base.rotation()*internal.force(), m = base.rotation()*internal.moment();
+  screws::Vector3d arm = ws.tipPose().translation() - base.translation();
+  const screws::Vector3d f = load.force();
+  const screws::Vector3d lever(arm(1)*f(2) - arm(2)*f(1), arm(2)*f(0) - arm(0)*f(2), arm(0)*f(1) - arm(1)*f(0));
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    assert(std::abs(n(i) - f(i)) < 1e-7);
+    assert(std::abs(m(i) - load.moment()(i) - lever(i)) < 1e-8);
+  }
+  assert(ws.residual() < 1e-9 && ws.iterations() > 0);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Base wrench balance test passed." << std::endl;
+
+  // The analytic shooting Jacobian matches central differences.
+  Rod::Coordinates W, r, rPlus, rMinus;
+  W << 0.02, -0.01, 0.03, 0.002, 0.001, -0.003;
+  Rod::Matrix6 J, Jd;
+  curved.residual(base, load, W, r, J, ws);
+  const double step = 1e-7;
+  for (int c = 0; c < 6; ++c)
+  {
+    Rod::Coordinates Wd = W;
+    Wd(c) += step;
+    curved.residual(base, load, Wd, rPlus, Jd, ws);
+    Wd(c) -= 2*step;
+    curved.residual(base, load, Wd, rMinus, Jd, ws);
+    const Rod::Coordinates column = (rPlus - rMinus)/(2*step);
+    assert((column - J.col(c)).cwiseAbs().maxCoeff() < 1e-6*std::max(1.0, J.col(c).cwiseAbs().maxCoeff()));
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Shooting Jacobian test passed." << std::endl;
+
+  // The last solution starts the next solve: none for the same load, few for a nearby one.
+  ws.reset();
+  assert(curved.solve(base, load, ws));
+  assert(curved.solve(base, load, ws) && ws.iterations() == 0);
+  const screws::Wrenchd nearby(load(0) + 1e-4, load(1), load(2), load(3), load(4), load(5));
+  assert(curved.solve(base, nearby, ws) && ws.iterations() <= 2);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Warm start test passed." << std::endl;
+
+  // A batch over two threads gives the tips of the samples solved one at a time, to the tolerance.
+  const size_t samples = 6;
+  std::vector<screws::HomogeneousTransformd> bases(samples, base), tips(samples);
+  std::vector<screws::Wrenchd> loads(samples);
+  for (size_t i = 0; i < samples; ++i)
+  {
+    loads[i] = screws::Wrenchd(0.01*i, -0.02, 0.01, 0.0005*i, 0, 0);
+  }
+  std::vector<Rod::Workspace> workspaces(2);
+  assert(curved.solve(&bases[0], &loads[0], samples, &tips[0], workspaces) == samples);
+  for (size_t i = 0; i < samples; ++i)
+  {
+    ws.reset();
+    assert(curved.solve(bases[i], loads[i], ws));
+    assert(poseError(tips[i], ws.tipPose()) < 1e-7);
+  }
+  bool thrown = false;
+  try
+  {
+    std::vector<Rod::Workspace> none;
+    curved.solve(&bases[0], &loads[0], samples, &tips[0], none);
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Batch solve test passed." << std::endl;
+}
+
+void testConstantCurvature()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == CONSTANT CURVATURE == " << std::endl;
+  int testIdx = 1;
+  typedef screws::ConstantCurvatureSegmentd Segment;
+  typedef Eigen::Matrix<double, 4, 4> Matrix4;
+  auto matrix = [](const screws::HomogeneousTransformd& g)
+  {
+    Matrix4 G;
+    for (unsigned int r = 0; r < 4; ++r)
+    {
+      for (unsigned int c = 0; c < 4; ++c)
+      {
+        G(r, c) = g(r, c);
+      }
+    }
+    return G;
+  };
+  // (v; w) of a 4x4 twist matrix.
+  auto vee = [](const Matrix4& X)
+  {
+    Eigen::Matrix<double, 6, 1> xi;
+    xi << X(0, 3), X(1, 3), X(2, 3), X(2, 1), X(0, 2), X(1, 0);
+    return xi;
+  };
+
+  const double kappa = 20*((double)rand()/RAND_MAX - 0.5), phi = 2*M_PI*(double)rand()/RAND_MAX, l = 0.02 + 0.1*(double)rand()/RAND_MAX;
+  const Segment segment(kappa, phi, l);
+
+  // The closed form equals the rotation products, and the exponential of the twist. The axis
+  // rotations take angles in [0, 2pi).
+  const double theta = kappa*l;
+  const screws::HomogeneousTransformd products = screws::HomogeneousTransformd(screws::Rotationd('z', phi), screws::Translationd())*
+      screws::HomogeneousTransformd(screws::Rotationd('y', theta < 0 ? theta + 2*M_PI : theta),
+                                    screws::Translationd((1 - cos(theta))/kappa, 0, sin(theta)/kappa))*
+      screws::HomogeneousTransformd(screws::Rotationd('z', phi > 0 ? 2*M_PI - phi : 0), screws::Translationd());
+  assert(poseError(segment.transform(), products) < 1e-12);
+  assert(poseError(segment.transform(), segment.twist().exp(l)) < 1e-12);
+  assert(poseError(segment.transform(0.3*l), segment.twist().exp(0.3*l)) < 1e-12);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Arc transform test passed." << std::endl;
+
+  // Straight and nearly straight segments, on both sides of the series.
+  assert(poseError(Segment(0, phi, l).transform(), screws::HomogeneousTransformd(screws::Rotationd(), screws::Translationd(0, 0, l))) < 1e-15);
+  const double tiny = 1e-9;
+  const screws::HomogeneousTransformd firstOrder(screws::Rotationd(screws::Vector3d(-sin(phi), cos(phi), 0), tiny),
+                                                 screws::Translationd(l*tiny/2*cos(phi), l*tiny/2*sin(phi), l));
+  assert(poseError(Segment(tiny/l, phi, l).transform(), firstOrder) < 1e-16);
+  const double angles[3] = { 0.5e-2, 0.999e-2, 1.001e-2 };
+  for (int i = 0; i < 3; ++i)
+  {
+    const Segment bent(angles[i]/l, phi, l);
+    assert(poseError(bent.transform(), bent.twist().exp(l)) < 1e-15);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Small curvature test passed." << std::endl;
+
+  // The body and spatial Jacobians match central differences, also when straight.
+  const double h = 1e-6;
+  const double curvatures[2] = { kappa, 0 };
+  for (int k = 0; k < 2; ++k)
+  {
+    const Segment arc(curvatures[k], phi, l);
+    const Matrix4 G = matrix(arc.transform()), Ginv = G.inverse();
+    const Segment::Jacobian Jb = arc.bodyJacobian(), Js = arc.spatialJacobian();
+    for (int c = 0; c < 3; ++c)
+    {
+      double plus[3] = { curvatures[k], phi, l }, minus[3] = { curvatures[k], phi, l };
+      plus[c] += h;
+      minus[c] -= h;
+      const Matrix4 dG = (matrix(Segment(plus[0], plus[1], plus[2]).transform()) - matrix(Segment(minus[0], minus[1], minus[2]).transform()))/(2*h);
+      assert((vee(Ginv*dG) - Jb.col(c)).cwiseAbs().maxCoeff() < 1e-8);
+      assert((vee(dG*Ginv) - Js.col(c)).cwiseAbs().maxCoeff() < 1e-8);
+    }
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Segment Jacobian test passed." << std::endl;
+
+  // Three segments compose as the product of their transforms, and the robot Jacobian stacks the
+  // segment Jacobians moved to the base.
+  Segment segments[3] = { segment, Segment(-5, 1.0, 0.05), Segment(8*(double)rand()/RAND_MAX, -2.0, 0.03) };
+  const screws::HomogeneousTransformd tip = segments[0].transform()*segments[1].transform()*segments[2].transform();
+  assert(poseError(Segment::compose(segments, 3), tip) < 1e-14);
+  Segment::RobotJacobian J;
+  Segment::spatialJacobian(segments, 3, J);
+  assert(J.cols() == 9);
+  const Matrix4 Tinv = matrix(tip).inverse();
+  for (int c = 0; c < 9; ++c)
+  {
+    Segment plus[3] = { segments[0], segments[1], segments[2] }, minus[3] = { segments[0], segments[1], segments[2] };
+    double p[3] = { plus[c/3].curvature(), plus[c/3].bendingPlane(), plus[c/3].length() }, m[3] = { p[0], p[1], p[2] };
+    p[c % 3] += h;
+    m[c % 3] -= h;
+    plus[c/3].set(p[0], p[1], p[2]);
+    minus[c/3].set(m[0], m[1], m[2]);
+    const Matrix4 dT = (matrix(Segment::compose(plus, 3)) - matrix(Segment::compose(minus, 3)))/(2*h);
+    assert((vee(dT*Tinv) - J.col(c)).cwiseAbs().maxCoeff() < 1e-8);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Multi-segment test passed." << std::endl;
+
+  // A batch gives the segments one at a time.
+  const size_t n = 5;
+  std::vector<double> kappas(n), phis(n), lengths(n);
+  std::vector<screws::HomogeneousTransformd> tips(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    kappas[i] = kappa*(double)i/n;
+    phis[i] = phi + 0.5*i;
+    lengths[i] = l*(i + 1);
+  }
+  Segment::transform(&kappas[0], &phis[0], &lengths[0], n, &tips[0]);
+  for (size_t i = 0; i < n; ++i)
+  {
+    assert(tips[i] == Segment(kappas[i], phis[i], lengths[i]).transform());
+  }
+  bool thrown = false;
+  try
+  {
+    Segment negative(1, 0, -0.1);
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Segment batch test passed." << std::endl;
+}
+
+void testConcentricTubeRobot()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == CONCENTRIC TUBE ROBOT == " << std::endl;
+  int testIdx = 1;
+  typedef screws::ConcentricTubeRobotd Robot;
+  typedef screws::ConstantCurvatureSegmentd Segment;
+
+  // Nitinol tubes, outer first: lengths, precurved lengths, curvatures and radii.
+  const double E = 60e9, G = E/2.6;
+  const double L1 = 0.10, Lc1 = 0.05, kappa1 = 8, L2 = 0.15, Lc2 = 0.06, kappa2 = 12;
+  const double k1 = E*M_PI/4*(pow(0.8e-3, 4) - pow(0.65e-3, 4)), k2 = E*M_PI/4*(pow(0.55e-3, 4) - pow(0.4e-3, 4));
+  const double alpha = 2*M_PI*(double)rand()/RAND_MAX;
+
+  // One tube is a straight part and an arc in the plane of its rotation.
+  Robot single;
+  single.addTube(L2, Lc2, kappa2, E, G, 0.55e-3, 0.4e-3);
+  single.setRotation(0, alpha);
+  single.setTranslation(0, -0.02);
+  assert(single.update() && single.iterations() == 0);
+  const screws::HomogeneousTransformd straight(screws::Rotationd(), screws::Translationd(0, 0, L2 - Lc2 - 0.02));
+  assert(poseError(single.tipPose(), straight*Segment(kappa2, alpha - M_PI/2, Lc2).transform()) < 1e-12);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Single tube test passed." << std::endl;
+
+  // Two aligned tubes do not twist, and bend with the stiffness weighted curvature of each section.
+  Robot robot;
+  robot.addTube(L1, Lc1, kappa1, E, G, 0.8e-3, 0.65e-3);
+  robot.addTube(L2, Lc2, kappa2, E, G, 0.55e-3, 0.4e-3);
+  robot.setRotation(0, alpha);
+  robot.setRotation(1, alpha);
+  assert(robot.tubes() == 2 && robot.update());
+  const double phi = alpha - M_PI/2;
+  const Segment sections[4] = { Segment(0, phi, L1 - Lc1), Segment(k1*kappa1/(k1 + k2), phi, L2 - Lc2 - (L1 - Lc1)),
+                                Segment((k1*kappa1 + k2*kappa2)/(k1 + k2), phi, L1 - (L2 - Lc2)), Segment(kappa2, phi, L2 - L1) };
+  assert(poseError(robot.tipPose(), Segment::compose(sections, 4)) < 1e-12);
+  assert(std::abs(robot.arcLength(robot.backbone().size() - 1) - L2) < 1e-15);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Aligned tubes test passed." << std::endl;
+
+  // Turned tubes twist where both are precurved, with the transmission in psi(0) and no torsion
+  // at the tips.
+  robot.setRotation(1, alpha + 1.5);
+  robot.setTranslation(0, -0.01);
+  robot.setTranslation(1, -0.03);
+  assert(robot.update() && robot.residual() < 1e-9);
+  const double baseRate = robot.tubeTwistRate(1, 0);
+  assert(std::abs(baseRate) > 1e-3);
+  assert(std::abs(robot.tubeAngle(1, 0) - (alpha + 1.5 + 0.03*baseRate)) < 1e-12);
+  const double ends[2] = { L1 - 0.01, L2 - 0.03 };
+  for (size_t i = 0; i < 2; ++i)
+  {
+    size_t k = 0;
+    while (robot.arcLength(k) < ends[i] - 1e-12)
+    {
+      ++k;
+    }
+    assert(std::abs(robot.tubeTwistRate(i, k)) < 1e-9);
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Torsion test passed." << std::endl;
+
+  // Two identical, fully precurved tubes turned apart by a small angle: the linearised difference
+  // theta = psi_1 - psi_2 obeys theta'' = lambda^2 theta, lambda^2 = E kappa^2/(2 G), over the
+  // length l = L + beta beyond the base, with theta' = 0 at the tips and theta(0) = dalpha - beta
+  // theta'(0), so the tips lag the actuation by theta(l) = dalpha/(cosh lambda l - beta lambda sinh lambda l).
+  const double L = 0.15, kappa = 10, beta = -0.1, dalpha = 1e-3;
+  Robot pair;
+  pair.addTube(L, L, kappa, E, G, 0.55e-3, 0.4e-3);
+  pair.addTube(L, L, kappa, E, G, 0.55e-3, 0.4e-3);
+  pair.setRotation(0, alpha + dalpha);
+  pair.setRotation(1, alpha);
+  pair.setTranslation(0, beta);
+  pair.setTranslation(1, beta);
+  assert(pair.update());
+  const double lambda = kappa*std::sqrt(E/(2*G)), l = L + beta;
+  const double tipLag = dalpha/(std::cosh(lambda*l) - beta*lambda*std::sinh(lambda*l));
+  const size_t tipNode = pair.backbone().size() - 1;
+  assert(std::abs(pair.tubeAngle(0, tipNode) - pair.tubeAngle(1, tipNode) - tipLag) < 1e-4*tipLag);
+  assert(tipLag < dalpha);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Linearised transmission test passed." << std::endl;
+
+  // Turning one tube is predicted from the last solution, and gives the cold solution.
+  robot.setRotation(1, alpha + 1.51);
+  assert(robot.update() && robot.iterations() <= 1);
+  const screws::HomogeneousTransformd warm = robot.tipPose();
+  robot.reset();
+  assert(robot.update() && robot.iterations() > 1);
+  assert(poseError(warm, robot.tipPose()) < 1e-9);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Incremental rotation test passed." << std::endl;
+
+  // A translation moves the transition points.
+  Robot rod;
+  rod.addTube(0.2, 0, 0, E, G, 0.5e-3, 0);
+  rod.setTranslation(0, -0.05);
+  assert(rod.update() && std::abs(rod.tipPose()(2, 3) - 0.15) < 1e-15);
+  rod.setTranslation(0, -0.08);
+  assert(rod.update() && std::abs(rod.tipPose()(2, 3) - 0.12) < 1e-15 && rod.translation(0) == -0.08);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Translation test passed." << std::endl;
+
+  int thrown = 0;
+  try
+  {
+    Robot empty;
+    empty.update();
+  }
+  catch (screws::ScrewException&)
+  {
+    ++thrown;
+  }
+  try
+  {
+    robot.setRotation(2, 0);
+  }
+  catch (screws::ScrewException&)
+  {
+    ++thrown;
+  }
+  try
+  {
+    robot.setTranslation(0, 0.01);
+  }
+  catch (screws::ScrewException&)
+  {
+    ++thrown;
+  }
+  try
+  {
+    robot.addTube(0.1, 0.2, 5, E, G, 0.3e-3, 0);
+  }
+  catch (screws::ScrewException&)
+  {
+    ++thrown;
+  }
+  assert(thrown == 4 && robot.tubes() == 2);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Concentric tube exceptions test passed." << std::endl;
+}
+
+void testInstrumentation()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == INSTRUMENTATION == " << std::endl;
+  int testIdx = 1;
+
+  typedef screws::Instrumentation I;
+  const uint64_t k = 10;
+  screws::Skewd S(screws::Vector3d((double)rand()/RAND_MAX - 0.5, (double)rand()/RAND_MAX - 0.5, 1.0));
+  screws::Twistd xi(0.1, 0.2, 0.3, 0.5, -0.2, 0.7);
+  screws::HomogeneousTransformd H = xi.exp(0.4);
+
+  I::Snapshot before = I::snapshot();
+  for (uint64_t i = 0; i < k; ++i)
+  {
+    S.exp(0.3);
+    xi.exp(0.3);
+    H.log();
+    H.inv();
+    H*H;
+    screws::Vector3d(1.0, 2.0, 3.0).normalised();
+  }
+  // A failed validation, and the exception it throws.
+  screws::Rotationd Rperturbed(screws::Vector3d(1.0 + 1e-9, 0.0, 0.0),
+                               screws::Vector3d(0.0, 1.0, 0.0),
+                               screws::Vector3d(0.0, 0.0, 1.0));
+  try
+  {
+    Rperturbed.isValid(1e-12);
+    exit(1);
+  }
+  catch (screws::ScrewException&)
+  {
+  }
+  I::Snapshot d = I::snapshot() - before;
+
+  if (I::enabled())
+  {
+    // Counters only grow, and other suites may run in between, so only lower bounds hold.
+    assert(d.calls[I::SKEW_EXP] >= 2*k);  // Twist::exp calls Skew::exp
+    assert(d.calls[I::TWIST_EXP] >= k);
+    assert(d.calls[I::TRANSFORM_LOG] >= k);
+    assert(d.calls[I::TRANSFORM_INV] >= k);
+    assert(d.calls[I::TRANSFORM_PRODUCT] >= k);
+    assert(d.calls[I::NORMALISED] >= k);
+    assert(d.calls[I::ROTATION_IS_VALID] >= 1);
+    assert(d.calls[I::VALIDATION_FAILURES] >= 1);
+    assert(d.calls[I::EXCEPTIONS] >= 1);
+    assert(d.ticks[I::EXCEPTIONS] == 0 && d.ticks[I::VALIDATION_FAILURES] == 0);
+  }
+  else
+  {
+    for (unsigned int i = 0; i < I::COUNTERS; ++i)
+    {
+      assert(d.calls[i] == 0 && d.ticks[i] == 0);
+    }
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Counter test passed." << std::endl;
+
+  // The ticks are exclusive, so nested primitives, e.g. Skew::exp in Twist::exp, are not counted twice.
+  before = I::snapshot();
+  const uint64_t start = I::ticks();
+  for (uint64_t i = 0; i < k; ++i)
+  {
+    xi.exp(0.3);
+    H*H;
+  }
+  const uint64_t elapsed = I::ticks() - start;
+  d = I::snapshot() - before;
+  uint64_t total = 0;
+  for (unsigned int i = 0; i < I::COUNTERS; ++i)
+  {
+    total += d.ticks[i];
+  }
+  assert(total <= elapsed);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Exclusive ticks test passed." << std::endl;
+
+  // Each thread counts into its own block; the counts of finished threads remain in the snapshot.
+  before = I::snapshot();
+  std::thread t1([&]() { for (uint64_t i = 0; i < 100*k; ++i) S.exp(0.3); });
+  std::thread t2([&]() { for (uint64_t i = 0; i < 100*k; ++i) S.exp(0.7); });
+  t1.join();
+  t2.join();
+  d = I::snapshot() - before;
+  assert(d.calls[I::SKEW_EXP] == (I::enabled() ? 200*k : 0));
+  if (SHOW_PRINT_OUTS)
+  {
+    std::cout << testIdx++ << ") Per-thread counter test passed." << std::endl;
+    I::dump(std::cout, d);
+  }
+}
+
+// Number of occurrences of pattern in text.
+size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+  size_t count = 0;
+  for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + pattern.size()))
+  {
+    ++count;
+  }
+  return count;
+}
+
+void testTrace()
+{
+  if (SHOW_PRINT_OUTS) std::cout << " == TRACE == " << std::endl;
+  int testIdx = 1;
+
+  typedef screws::Trace T;
+  std::vector<screws::Twistd> twists;
+  twists.push_back(screws::Twistd(0, 0, 0, 0, 0, 1));
+  twists.push_back(screws::Twistd(0, -0.3, 0, 1, 0, 0));
+  twists.push_back(screws::Twistd(0, 0, 1, 0, 0, 0));
+  screws::Chaind chain(twists, screws::HomogeneousTransformd());
+  double q[3] = { (double)rand()/RAND_MAX, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX };
+  screws::HomogeneousTransformd g;
+
+  // Spans of two threads; nothing is recorded while disabled.
+  T::clear();
+  T::setEnabled(true);
+  assert(T::isEnabled() == T::compiled());
+  for (int k = 0; k < 3; ++k)
+  {
+    chain.forwardKinematics(q, g);
+  }
+  std::thread worker([&]()
+  {
+    screws::HomogeneousTransformd gWorker;
+    for (int k = 0; k < 5; ++k)
+    {
+      chain.forwardKinematics(q, gWorker);
+    }
+  });
+  worker.join();
+  T::setEnabled(false);
+  chain.forwardKinematics(q, g);
+
+  std::ostringstream os;
+  T::write(os);
+  std::string json = os.str();
+  const std::string head = "{\"traceEvents\":[", tail = "],\"displayTimeUnit\":\"ns\"}\n";
+  assert(json.compare(0, head.size(), head) == 0);
+  assert(json.compare(json.size() - tail.size(), tail.size(), tail) == 0);
+  const std::string fk = "\"name\":\"Chain::forwardKinematics\"";
+  if (T::compiled())
+  {
+    assert(countOccurrences(json, fk) == 8);
+    assert(countOccurrences(json, "\"ph\":\"X\"") == 8);
+    assert(countOccurrences(json, "\"args\":{\"n\":3}") == 8);
+  }
+  else
+  {
+    assert(json == "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\"}\n");
+  }
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Span recording and JSON test passed." << std::endl;
+
+  // A full ring keeps the newest spans.
+  const size_t capacity = T::capacity();
+  T::setCapacity(4);
+  T::clear();
+  T::setEnabled(true);
+  std::thread busy([&]()
+  {
+    screws::Chaind::Jacobian J;
+    for (int k = 0; k < 10; ++k)
+    {
+      chain.spatialJacobian(q, J);
+    }
+  });
+  busy.join();
+  T::setEnabled(false);
+  os.str("");
+  T::write(os);
+  assert(countOccurrences(os.str(), "\"name\":\"Chain::spatialJacobian\"") == (T::compiled() ? 4u : 0u));
+  T::setCapacity(capacity);
+  T::clear();
+
+  bool thrown = false;
+  try
+  {
+    T::setCapacity(0);
+  }
+  catch (screws::ScrewException&)
+  {
+    thrown = true;
+  }
+  assert(thrown && T::capacity() == capacity);
+  if (SHOW_PRINT_OUTS) std::cout << testIdx++ << ") Ring buffer test passed." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  srand(time(NULL));
+
+  // The iteration count can be lowered from the command line, e.g. for CTest.
+  const int maxIter = (argc > 1) ? atoi(argv[1]) : 5000000;
+  if (TEST_VECTOR6)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Vector6 iteration " << i << " of " << maxIter << std::endl;
+      testVector6();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TRANSLATIONS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Translation iteration " << i << " of " << maxIter << std::endl;
+      testTranslations();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_ROTATIONS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Rotation iteration " << i << " of " << maxIter << std::endl;
+      testRotations();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_HOMOGENEOUS_TRANSFORMS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "HomogeneousTransform iteration " << i << " of " << maxIter << std::endl;
+      testHomogeneousTransforms();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_SKEWS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Skew iteration " << i << " of " << maxIter << std::endl;
+      testSkews();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TWISTS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Twist iteration " << i << " of " << maxIter << std::endl;
+      testTwists();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_SINGLE_PRECISION)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Single precision iteration " << i << " of " << maxIter << std::endl;
+      testSinglePrecision();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_MIXED_PRECISION)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Mixed precision iteration " << i << " of " << maxIter << std::endl;
+      testMixedPrecision();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TWIST_EXP_CACHE)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Twist exp cache iteration " << i << " of " << maxIter << std::endl;
+      testTwistExpCache();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_ROTATION_BATCH)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Rotation batch iteration " << i << " of " << maxIter << std::endl;
+      testRotationBatch();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_BATCH_KERNELS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Batch kernels iteration " << i << " of " << maxIter << std::endl;
+      testBatchKernels();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TRANSFORM_EXPRESSION)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Transform expression iteration " << i << " of " << maxIter << std::endl;
+      testTransformExpression();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TRANSFORM_BATCH)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Transform batch iteration " << i << " of " << maxIter << std::endl;
+      testTransformBatch();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_CHAIN)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Chain iteration " << i << " of " << maxIter << std::endl;
+      testChain();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_WRENCH)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Wrench iteration " << i << " of " << maxIter << std::endl;
+      testWrench();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_DYNAMICS)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Dynamics iteration " << i << " of " << maxIter << std::endl;
+      testDynamics();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_LIE_INTEGRATOR)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Lie integrator iteration " << i << " of " << maxIter << std::endl;
+      testLieIntegrator();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_COSSERAT_ROD)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Cosserat rod iteration " << i << " of " << maxIter << std::endl;
+      testCosseratRod();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_CONSTANT_CURVATURE)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Constant curvature iteration " << i << " of " << maxIter << std::endl;
+      testConstantCurvature();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_CONCENTRIC_TUBE_ROBOT)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Concentric tube robot iteration " << i << " of " << maxIter << std::endl;
+      testConcentricTubeRobot();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_INSTRUMENTATION)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Instrumentation iteration " << i << " of " << maxIter << std::endl;
+      testInstrumentation();
+    }
+    std::cout << "\n\n" << std::endl;
+  }
+
+  if (TEST_TRACE)
+  {
+    for(int i = 1; i <= maxIter; ++i)
+    {
+      if (i % 10000 == 0)
+        std::cout << "Trace iteration " << i << " of " << maxIter << std::endl;
+      testTrace();
     }
   }
   return 0;
@@ -0,0 +1,351 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace screws
+{
+  /*!
+   * \class Trace
+   * \ingroup libScrews
+   * \brief Timeline of library-level spans, written as Chrome trace-event JSON, compiled in with SCREWS_TRACE.
+   *
+   * SCREWS_TRACE_SCOPE("name") records a span from that point to the end of the scope; the chain
+   * kinematics and the batch jobs are traced this way, and applications can wrap their own work
+   * (e.g. one IK iteration) the same way. Each thread appends to its own ring buffer of capacity()
+   * spans, without locks, overwriting its oldest spans when full. write() emits the spans of all
+   * threads as a JSON file that chrome://tracing or ui.perfetto.dev open offline. Recording also
+   * needs setEnabled(true) at run time; while disabled a span costs one relaxed load. Without
+   * SCREWS_TRACE the macros expand to nothing and write() emits an empty trace.
+   * \note Span names must be string literals or otherwise outlive the trace. write() and clear()
+   * read the buffers of running threads, so call them when the traced threads are idle, otherwise
+   * the oldest spans of a busy thread may be torn.
+   */
+  class SCREWS_EXPORT Trace
+  {
+  public:
+    /// @return true if the library was compiled with SCREWS_TRACE.
+    static bool compiled()
+    {
+#ifdef SCREWS_TRACE
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    /// @brief Start or stop recording spans.
+    static void setEnabled(const bool& enabled)
+    {
+      state().enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    /// @return true if spans are being recorded.
+    static bool isEnabled()
+    {
+#ifdef SCREWS_TRACE
+      return state().enabled.load(std::memory_order_relaxed);
+#else
+      return false;
+#endif
+    }
+
+    /// @brief Set the number of spans kept per thread [default: 65536]. Applies to the buffers of
+    /// threads that start tracing afterwards.
+    /// @throw screws::ScrewException for zero capacity.
+    static void setCapacity(const size_t& spans)
+    {
+      if (spans == 0)
+      {
+        ScrewException e("Trace buffers need room for at least one span.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+      state().capacity.store(spans, std::memory_order_relaxed);
+    }
+
+    /// @return the number of spans kept per thread.
+    static size_t capacity()
+    {
+      return state().capacity.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Nanoseconds of the trace clock.
+    static uint64_t now()
+    {
+      return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// @brief Record a span of the calling thread.
+    /// @param name the span name; must outlive the trace.
+    /// @param begin, end the span, in now() nanoseconds.
+    /// @param size an optional problem size shown with the span (0 for none).
+    static void record(const char* name, const uint64_t& begin, const uint64_t& end, const uint64_t& size = 0)
+    {
+#ifdef SCREWS_TRACE
+      Buffer& b = local();
+      uint64_t i = b.written.load(std::memory_order_relaxed);
+      Span& s = b.spans[(size_t)(i % b.spans.size())];
+      s.name = name;
+      s.begin = begin;
+      s.end = end;
+      s.size = size;
+      s.thread = b.thread;
+      b.written.store(i + 1, std::memory_order_release);
+#else
+      (void)name;
+      (void)begin;
+      (void)end;
+      (void)size;
+#endif
+    }
+
+    /// @brief Drop the recorded spans of all threads.
+    static void clear()
+    {
+#ifdef SCREWS_TRACE
+      for (Buffer* b = state().head.load(std::memory_order_acquire); b != 0; b = b->next)
+      {
+        b->written.store(0, std::memory_order_release);
+      }
+#endif
+    }
+
+    /// @brief Write the recorded spans as Chrome trace-event JSON ("X" events, microseconds).
+    static void write(std::ostream& os)
+    {
+      std::ios::fmtflags flags = os.flags();
+      std::streamsize precision = os.precision();
+      os << "{\"traceEvents\":[";
+      os << std::fixed << std::setprecision(3);
+#ifdef SCREWS_TRACE
+      bool first = true;
+      const uint64_t origin = state().origin;
+      for (Buffer* b = state().head.load(std::memory_order_acquire); b != 0; b = b->next)
+      {
+        uint64_t written = b->written.load(std::memory_order_acquire);
+        uint64_t kept = (written < b->spans.size()) ? written : b->spans.size();
+        for (uint64_t i = written - kept; i < written; ++i)
+        {
+          const Span& s = b->spans[(size_t)(i % b->spans.size())];
+          os << (first ? "\n" : ",\n");
+          first = false;
+          os << "{\"name\":\"";
+          escape(os, s.name);
+          os << "\",\"cat\":\"screws\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+             << ",\"ts\":" << (double)(s.begin - origin)/1000.0
+             << ",\"dur\":" << (double)(s.end - s.begin)/1000.0;
+          if (s.size != 0)
+          {
+            os << ",\"args\":{\"n\":" << s.size << "}";
+          }
+          os << "}";
+        }
+      }
+#endif
+      os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+      os.flags(flags);
+      os.precision(precision);
+    }
+
+    /// @brief Write the recorded spans to a JSON file, see write().
+    /// @throw screws::ScrewException if the file cannot be written.
+    static void write(const std::string& filename)
+    {
+      std::ofstream file(filename.c_str());
+      if (file)
+      {
+        write(file);
+      }
+      if (!file)
+      {
+        ScrewException e("Cannot write the trace file.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+    }
+
+  private:
+    struct Span
+    {
+      const char* name;
+      uint64_t begin;
+      uint64_t end;
+      uint64_t size;
+      uint64_t thread;
+    };
+
+    // The ring buffer of one thread. Buffers are never freed: a buffer is released when its
+    // thread exits, keeps its spans, and is reused (under a new thread number) by the next new thread.
+    struct Buffer
+    {
+      std::vector<Span> spans;
+      std::atomic<uint64_t> written;
+      std::atomic<bool> inUse;
+      uint64_t thread;
+      Buffer* next;
+    };
+
+    struct State
+    {
+      State() : enabled(false), capacity(65536), threads(0), head(0), origin(now())
+      {
+
+      }
+
+      std::atomic<bool> enabled;
+      std::atomic<size_t> capacity;
+      std::atomic<uint64_t> threads;
+      std::atomic<Buffer*> head;
+      uint64_t origin;
+    };
+
+    static State& state()
+    {
+      static State s;
+      return s;
+    }
+
+#ifdef SCREWS_TRACE
+    // Claims a buffer for the lifetime of the thread.
+    struct Owner
+    {
+      Owner() : buffer(claim())
+      {
+
+      }
+
+      ~Owner()
+      {
+        buffer->inUse.store(false, std::memory_order_release);
+      }
+
+      Buffer* buffer;
+    };
+
+    static Buffer* claim()
+    {
+      State& st = state();
+      Buffer* b = 0;
+      for (Buffer* c = st.head.load(std::memory_order_acquire); c != 0 && b == 0; c = c->next)
+      {
+        bool free = false;
+        if (c->inUse.compare_exchange_strong(free, true, std::memory_order_acq_rel))
+        {
+          b = c;
+        }
+      }
+
+      // Spans of the previous owner are kept until they are overwritten, unless the capacity changed.
+      const size_t cap = capacity();
+      if (b == 0)
+      {
+        b = new Buffer;
+        b->spans.resize(cap);
+        b->written.store(0, std::memory_order_relaxed);
+        b->inUse.store(true, std::memory_order_relaxed);
+        b->thread = st.threads.fetch_add(1, std::memory_order_relaxed);
+        b->next = st.head.load(std::memory_order_relaxed);
+        while (!st.head.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        return b;
+      }
+
+      if (b->spans.size() != cap)
+      {
+        b->written.store(0, std::memory_order_release);
+        b->spans.assign(cap, Span());
+      }
+      b->thread = st.threads.fetch_add(1, std::memory_order_relaxed);
+      return b;
+    }
+
+    static Buffer& local()
+    {
+      static thread_local Owner owner;
+      return *owner.buffer;
+    }
+
+    static void escape(std::ostream& os, const char* s)
+    {
+      for (; *s != '\0'; ++s)
+      {
+        if (*s == '"' || *s == '\\')
+        {
+          os << '\\';
+        }
+        os << *s;
+      }
+    }
+#endif
+  };
+
+#ifdef SCREWS_TRACE
+  /*!
+   * \class TraceScope
+   * \ingroup libScrews
+   * \brief Records a span from construction to the end of the scope, see SCREWS_TRACE_SCOPE.
+   */
+  class TraceScope
+  {
+  public:
+    explicit TraceScope(const char* name, const uint64_t& size = 0)
+      : _name(name), _size(size), _begin(Trace::isEnabled() ? Trace::now() : 0)
+    {
+
+    }
+
+    ~TraceScope()
+    {
+      if (_begin != 0)
+      {
+        Trace::record(_name, _begin, Trace::now(), _size);
+      }
+    }
+
+  private:
+    const char* _name;
+    uint64_t _size;
+    uint64_t _begin;
+  };
+#endif
+};
+
+/// @brief Record the rest of the enclosing scope as a span, e.g. SCREWS_TRACE_SCOPE("Chain::forwardKinematics").
+/// @brief SCREWS_TRACE_SCOPE_SIZE also records a problem size, e.g. the batch size.
+#ifdef SCREWS_TRACE
+#define SCREWS_TRACE_CONCAT(a, b) a##b
+#define SCREWS_TRACE_NAME(line) SCREWS_TRACE_CONCAT(screwsTraceScope, line)
+#define SCREWS_TRACE_SCOPE(name) screws::TraceScope SCREWS_TRACE_NAME(__LINE__)(name)
+#define SCREWS_TRACE_SCOPE_SIZE(name, size) screws::TraceScope SCREWS_TRACE_NAME(__LINE__)(name, (uint64_t)(size))
+#else
+#define SCREWS_TRACE_SCOPE(name)
+#define SCREWS_TRACE_SCOPE_SIZE(name, size)
+#endif
+
+#endif // TRACE_HPP
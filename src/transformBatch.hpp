@@ -0,0 +1,351 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef TRANSFORMBATCH_HPP
+#define TRANSFORMBATCH_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "fastMath.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "rotationBatch.hpp"
+#include "trace.hpp"
+#include <Eigen/Eigen>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace screws
+{
+  /*!
+   * \class TransformBatch
+   * \ingroup libScrews
+   * \brief N homogeneous transforms stored as structure of arrays, with batched relative poses and logs.
+   *
+   * Element (r, c) of all transforms is contiguous; c = 3 is the translation. The relative pose
+   * kernels compute inv(Hi)*Hj as (Ri^T*Rj, Ri^T*(Tj - Ti)), using the transpose implicitly, either for
+   * pairs of batches or for index pairs into a pose vector (e.g. the edges of a pose graph).
+   * relativeLog() goes straight to twist coordinates block by block, so the relative poses
+   * themselves are never stored. It returns the principal logs (rotation angles in [0, pi]), which
+   * are continuous around the identity, as residuals need.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT TransformBatch
+  {
+  public:
+    /// @brief Create n identity transforms.
+    explicit TransformBatch(const size_t& n = 0)
+    {
+      resize(n);
+    }
+
+    /// Default destructor.
+    ~TransformBatch()
+    {
+
+    }
+
+    /// @return the number of transforms.
+    size_t size() const
+    {
+      return _R.size();
+    }
+
+    /// @brief Change the number of transforms. Nothing is reallocated if the size is unchanged;
+    /// new contents are identities.
+    void resize(const size_t& n)
+    {
+      if (size() != n)
+      {
+        _R.resize(n);
+        _T.resize(n, 3);
+        setIdentity();
+      }
+    }
+
+    /// @brief Set every transform to the identity.
+    void setIdentity()
+    {
+      _R.setIdentity();
+      _T.setZero();
+    }
+
+    /// @return the rotational parts.
+    const RotationBatch<NumType>& rotations() const
+    {
+      return _R;
+    }
+
+    /// @brief Contiguous array with element (r, c) of every transform; c = 3 is the translation.
+    NumType* plane(const unsigned int& r, const unsigned int& c)
+    {
+      assert(r < 3 && c < 4);
+      return (c < 3) ? _R.plane(r, c) : _T.col(r).data();
+    }
+
+    /// @brief Contiguous array with element (r, c) of every transform (read).
+    const NumType* plane(const unsigned int& r, const unsigned int& c) const
+    {
+      assert(r < 3 && c < 4);
+      return (c < 3) ? _R.plane(r, c) : _T.col(r).data();
+    }
+
+    /// @brief Return element (r, c) of transform i.
+    /// @note No boundary check is performed.
+    const NumType& operator () (const unsigned int& r, const unsigned int& c, const size_t& i) const
+    {
+      assert(r < 3 && c < 4 && i < size());
+      return (c < 3) ? _R(r, c, i) : _T(i, r);
+    }
+
+    /// @brief Copy out transform i.
+    HomogeneousTransform<NumType> transform(const size_t& i) const
+    {
+      assert(i < size());
+      HomogeneousTransform<NumType> H;
+      H.setUnchecked(_R.rotation(i).matrix(), _T.row(i).transpose());
+
+      return H;
+    }
+
+    /// @brief Overwrite transform i.
+    void set(const size_t& i, const HomogeneousTransform<NumType>& H)
+    {
+      assert(i < size());
+      _R.set(i, H.rotation());
+      _T.row(i) = H.translation().vector().transpose();
+    }
+
+    /// @brief Twist coordinates of every transform, see Twist(const HomogeneousTransform&, bool).
+    /// @param vx, vy, vz, wx, wy, wz arrays of size() elements: velocity, then rotation.
+    /// @param principal if true, the principal logs (rotation angles in [0, pi]).
+    void log(NumType* vx, NumType* vy, NumType* vz, NumType* wx, NumType* wy, NumType* wz,
+             bool principal = false) const
+    {
+      SCREWS_TRACE_SCOPE_SIZE("TransformBatch::log", size());
+      _R.log(wx, wy, wz, principal);
+      const size_t n = size();
+      for (size_t start = 0; start < n; start += BATCH_BLOCK)
+      {
+        const size_t m = std::min((size_t)BATCH_BLOCK, n - start);
+        velocityBlock(start, m, wx + start, wy + start, wz + start, vx + start, vy + start, vz + start);
+      }
+    }
+
+    /// @brief Relative poses out[k] = inv(Hi[k])*Hj[k].
+    /// @param out the relative poses. Resized only if its size differs.
+    /// @throw screws::ScrewException if Hi and Hj differ in size.
+    static void relative(const TransformBatch<NumType>& Hi, const TransformBatch<NumType>& Hj,
+                         TransformBatch<NumType>& out)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("TransformBatch::relative", Hi.size());
+      if (Hi.size() != Hj.size())
+      {
+        ScrewException e("Batches of different sizes.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+
+      out.resize(Hi.size());
+      relativeRange(Hi, Hj, 0, Hi.size(), out);
+    }
+
+    /// @brief Relative poses out[k] = inv(poses[i[k]])*poses[j[k]].
+    /// @param poses the absolute poses.
+    /// @param i, j the index pairs, e.g. the edges of a pose graph.
+    /// @param n the number of pairs.
+    /// @param out the relative poses. Resized only if its size differs.
+    static void relative(const std::vector< HomogeneousTransform<NumType> >& poses,
+                         const size_t* i, const size_t* j, const size_t& n, TransformBatch<NumType>& out)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("TransformBatch::relative", n);
+      out.resize(n);
+      for (size_t k = 0; k < n; ++k)
+      {
+        assert(i[k] < poses.size() && j[k] < poses.size());
+        const HomogeneousTransform<NumType>& Hi = poses[i[k]];
+        const HomogeneousTransform<NumType>& Hj = poses[j[k]];
+        const Matrix3& Ri = Hi.rotation().matrix();
+        Matrix3 R;
+        Vector3 T;
+        R.noalias() = Ri.transpose()*Hj.rotation().matrix();
+        T.noalias() = Ri.transpose()*(Hj.translation().vector() - Hi.translation().vector());
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+          for (unsigned int r = 0; r < 3; ++r)
+          {
+            out._R.plane(r, c)[k] = R(r, c);
+          }
+        }
+        out._T.row(k) = T.transpose();
+      }
+    }
+
+    /// @brief Twist coordinates of the relative poses inv(Hi[k])*Hj[k].
+    /// @param vx, vy, vz, wx, wy, wz arrays of Hi.size() elements.
+    /// @throw screws::ScrewException if Hi and Hj differ in size.
+    static void relativeLog(const TransformBatch<NumType>& Hi, const TransformBatch<NumType>& Hj,
+                            NumType* vx, NumType* vy, NumType* vz, NumType* wx, NumType* wy, NumType* wz)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("TransformBatch::relativeLog", Hi.size());
+      if (Hi.size() != Hj.size())
+      {
+        ScrewException e("Batches of different sizes.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+
+      TransformBatch<NumType> block;
+      for (size_t start = 0; start < Hi.size(); start += BATCH_BLOCK)
+      {
+        const size_t m = std::min((size_t)BATCH_BLOCK, Hi.size() - start);
+        block.resize(m);
+        relativeRange(Hi, Hj, start, m, block);
+        block.log(vx + start, vy + start, vz + start, wx + start, wy + start, wz + start, true);
+      }
+    }
+
+    /// @brief Twist coordinates of the relative poses inv(poses[i[k]])*poses[j[k]].
+    /// @param vx, vy, vz, wx, wy, wz arrays of n elements.
+    static void relativeLog(const std::vector< HomogeneousTransform<NumType> >& poses,
+                            const size_t* i, const size_t* j, const size_t& n,
+                            NumType* vx, NumType* vy, NumType* vz, NumType* wx, NumType* wy, NumType* wz)
+    {
+      SCREWS_TRACE_SCOPE_SIZE("TransformBatch::relativeLog", n);
+      TransformBatch<NumType> block;
+      for (size_t start = 0; start < n; start += BATCH_BLOCK)
+      {
+        const size_t m = std::min((size_t)BATCH_BLOCK, n - start);
+        relative(poses, i + start, j + start, m, block);
+        block.log(vx + start, vy + start, vz + start, wx + start, wy + start, wz + start, true);
+      }
+    }
+
+  protected:
+
+    // Number of transforms the fused kernels process per pass.
+    enum { BATCH_BLOCK = 256 };
+
+    typedef Eigen::Matrix<NumType, 3, 3> Matrix3;
+    typedef Eigen::Matrix<NumType, 3, 1> Vector3;
+
+    // out[k] = inv(Hi[start + k])*Hj[start + k] for k < m.
+    static void relativeRange(const TransformBatch<NumType>& Hi, const TransformBatch<NumType>& Hj,
+                              const size_t& start, const size_t& m, TransformBatch<NumType>& out)
+    {
+      const NumType* a[12];
+      const NumType* b[12];
+      NumType* o[12];
+      for (unsigned int c = 0; c < 4; ++c)
+      {
+        for (unsigned int r = 0; r < 3; ++r)
+        {
+          a[r + 3*c] = Hi.plane(r, c) + start;
+          b[r + 3*c] = Hj.plane(r, c) + start;
+          o[r + 3*c] = out.plane(r, c);
+        }
+      }
+
+      // Element (r, c) of Ri^T*Rj is column r of Ri dotted with column c of Rj.
+      for (unsigned int c = 0; c < 3; ++c)
+      {
+        for (unsigned int r = 0; r < 3; ++r)
+        {
+          const NumType* a0 = a[3*r];
+          const NumType* a1 = a[3*r + 1];
+          const NumType* a2 = a[3*r + 2];
+          const NumType* b0 = b[3*c];
+          const NumType* b1 = b[3*c + 1];
+          const NumType* b2 = b[3*c + 2];
+          NumType* p = o[r + 3*c];
+          for (size_t k = 0; k < m; ++k)
+          {
+            p[k] = a0[k]*b0[k] + a1[k]*b1[k] + a2[k]*b2[k];
+          }
+        }
+      }
+      for (unsigned int r = 0; r < 3; ++r)
+      {
+        const NumType* a0 = a[3*r];
+        const NumType* a1 = a[3*r + 1];
+        const NumType* a2 = a[3*r + 2];
+        NumType* p = o[9 + r];
+        for (size_t k = 0; k < m; ++k)
+        {
+          p[k] = a0[k]*(b[9][k] - a[9][k]) + a1[k]*(b[10][k] - a[10][k]) + a2[k]*(b[11][k] - a[11][k]);
+        }
+      }
+    }
+
+    // v = A^-1*T for transforms start..start + m, given w (the rotation log) of the same transforms:
+    // A^-1 = I - K/2 + f(theta)*K^2 with f = (1 - (theta/2)*cot(theta/2))/theta^2, as in Twist.
+    // f is written with sin/(1 - cos), which is finite at theta = pi, and with its series for small theta.
+    void velocityBlock(const size_t& start, const size_t& m,
+                       const NumType* wx, const NumType* wy, const NumType* wz,
+                       NumType* vx, NumType* vy, NumType* vz) const
+    {
+      // The series 1/12 + theta^2/720 + theta^4/30240 is accurate to rounding below this bound, and the
+      // closed form loses fewer digits to cancellation above it.
+      const NumType seriesBound = (std::numeric_limits<NumType>::digits > 24) ? (NumType)0.1 : (NumType)1;
+      const NumType* tx = _T.col(0).data() + start;
+      const NumType* ty = _T.col(1).data() + start;
+      const NumType* tz = _T.col(2).data() + start;
+
+      NumType theta[BATCH_BLOCK] = {}, s[BATCH_BLOCK], c[BATCH_BLOCK];
+      for (size_t k = 0; k < m; ++k)
+      {
+        theta[k] = std::sqrt(wx[k]*wx[k] + wy[k]*wy[k] + wz[k]*wz[k]);
+      }
+      MathPolicy<NumType>::sinCos(theta, s, c, m);
+
+      NumType ox[BATCH_BLOCK], oy[BATCH_BLOCK], oz[BATCH_BLOCK];
+      for (size_t k = 0; k < m; ++k)
+      {
+        NumType t2 = theta[k]*theta[k];
+        bool series = theta[k] < seriesBound;
+        NumType closedDen = series ? (NumType)1 : t2;
+        NumType oneMinusC = series ? (NumType)1 : 1 - c[k];
+        NumType closed = (1 - theta[k]*s[k]/(2*oneMinusC))/closedDen;
+        NumType f = series ? (NumType)1/12 + t2*((NumType)1/720 + t2*(NumType)1/30240) : closed;
+
+        // K*T = w x T, K^2*T = w x (w x T)
+        NumType ax = wy[k]*tz[k] - wz[k]*ty[k];
+        NumType ay = wz[k]*tx[k] - wx[k]*tz[k];
+        NumType az = wx[k]*ty[k] - wy[k]*tx[k];
+        NumType bx = wy[k]*az - wz[k]*ay;
+        NumType by = wz[k]*ax - wx[k]*az;
+        NumType bz = wx[k]*ay - wy[k]*ax;
+        ox[k] = tx[k] - (NumType)0.5*ax + f*bx;
+        oy[k] = ty[k] - (NumType)0.5*ay + f*by;
+        oz[k] = tz[k] - (NumType)0.5*az + f*bz;
+      }
+      std::copy(ox, ox + m, vx);
+      std::copy(oy, oy + m, vy);
+      std::copy(oz, oz + m, vz);
+    }
+
+    // The rotational parts.
+    RotationBatch<NumType> _R;
+    // One column per translation element.
+    Eigen::Matrix<NumType, Eigen::Dynamic, 3> _T;
+  };
+
+  // Convenience names
+  using TransformBatchd = TransformBatch < double >;
+  using TransformBatchf = TransformBatch < float >;
+};
+
+#endif // TRANSFORMBATCH_HPP
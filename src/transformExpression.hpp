@@ -0,0 +1,435 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef TRANSFORMEXPRESSION_HPP
+#define TRANSFORMEXPRESSION_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include <Eigen/Eigen>
+
+namespace screws
+{
+  template<class Left, class Right>
+  class TransformProduct;
+  template<class Expression>
+  class TransformInverse;
+  template<class NumType>
+  class TransformRef;
+  template<class NumType>
+  class RotationRef;
+
+  /*!
+   * \class TransformExpression
+   * \ingroup libScrews
+   * \brief Base of the lazy products and inverses of homogeneous transforms and rotations.
+   *
+   * Start an expression with lazy(), e.g. screws::lazy(H1)*H2*screws::lazy(H3).inv()*p. Nothing is
+   * computed until the expression is applied to a point or converted to a HomogeneousTransform:
+   * - applied to a point, the factors are applied to it from right to left, so no matrix product
+   *   is formed (3x3 times vector per factor instead of 3x3 times 3x3);
+   * - evaluated, the factors are accumulated from right to left in one pair of 3x3/3x1 buffers.
+   * Inverses are never materialised: the factors apply R^T(p - T), and inv() of a product applies
+   * the inverses of its factors in reverse order.
+   * Unlike the eager operators, evaluation does not go through Rotation::setData, so the result
+   * is not validated. Products of valid rotations are valid to rounding.
+   * \note The expressions keep references to their operands; evaluate them within the statement
+   * that builds them, and do not store them with auto.
+   */
+  template<class Derived, class NumType>
+  class SCREWS_EXPORT TransformExpression
+  {
+  public:
+    typedef NumType Scalar;
+    typedef Eigen::Matrix<NumType, 3, 3> Matrix3;
+    typedef Eigen::Matrix<NumType, 3, 1> Vector3;
+
+    /// @return the expression as its concrete type.
+    const Derived& derived() const
+    {
+      return static_cast<const Derived&>(*this);
+    }
+
+    /// @brief Evaluate the expression.
+    /// @return the homogeneous transform, not validated.
+    HomogeneousTransform<NumType> eval() const
+    {
+      Matrix3 R;
+      Vector3 T;
+      derived().evalInto(R, T);
+      HomogeneousTransform<NumType> H;
+      H.setUnchecked(R, T);
+
+      return H;
+    }
+
+    /// @brief Evaluate the expression on assignment to a homogeneous transform.
+    operator HomogeneousTransform<NumType>() const
+    {
+      return eval();
+    }
+
+    /// @return the rotational part of the evaluated expression.
+    Rotation<NumType> rotation() const
+    {
+      return eval().rotation();
+    }
+
+    /// @return the translational part of the evaluated expression.
+    Translation<NumType> translation() const
+    {
+      return eval().translation();
+    }
+
+    /// @return the lazy inverse of the expression.
+    TransformInverse<Derived> inv() const
+    {
+      return TransformInverse<Derived>(derived());
+    }
+
+    /// @return the lazy product with another expression.
+    template<class Other>
+    TransformProduct<Derived, Other> operator *(const TransformExpression<Other, NumType>& E) const
+    {
+      return TransformProduct<Derived, Other>(derived(), E.derived());
+    }
+
+    /// @return the lazy product with a homogeneous transform.
+    TransformProduct< Derived, TransformRef<NumType> > operator *(const HomogeneousTransform<NumType>& H) const
+    {
+      return TransformProduct< Derived, TransformRef<NumType> >(derived(), TransformRef<NumType>(H));
+    }
+
+    /// @return the lazy product with a rotation.
+    TransformProduct< Derived, RotationRef<NumType> > operator *(const Rotation<NumType>& R) const
+    {
+      return TransformProduct< Derived, RotationRef<NumType> >(derived(), RotationRef<NumType>(R));
+    }
+
+    /// @brief Transform a point by applying the factors to it from right to left.
+    /// @return the transformed point.
+    Translation<NumType> operator *(const Translation<NumType>& p) const
+    {
+      Vector3 q = p.vector();
+      derived().apply(q);
+
+      return Translation<NumType>(q(0), q(1), q(2));
+    }
+
+    /// @brief Transform n points given as structure of arrays, see HomogeneousTransform::transform().
+    /// The expression is evaluated once.
+    void transform(const NumType* x, const NumType* y, const NumType* z, const size_t& n,
+                   NumType* ox, NumType* oy, NumType* oz) const
+    {
+      eval().transform(x, y, z, n, ox, oy, oz);
+    }
+
+  protected:
+
+    static const Matrix3& rotationData(const HomogeneousTransform<NumType>& H)
+    {
+      return H.rotation().matrix();
+    }
+
+    static const Vector3& translationData(const HomogeneousTransform<NumType>& H)
+    {
+      return H.translation().vector();
+    }
+
+    static const Matrix3& rotationData(const Rotation<NumType>& R)
+    {
+      return R.matrix();
+    }
+  };
+
+  /*!
+   * \class TransformRef
+   * \ingroup libScrews
+   * \brief Leaf of a transform expression: a homogeneous transform, by reference.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT TransformRef : public TransformExpression<TransformRef<NumType>, NumType>
+  {
+    typedef TransformExpression<TransformRef<NumType>, NumType> Base;
+
+  public:
+    typedef typename Base::Matrix3 Matrix3;
+    typedef typename Base::Vector3 Vector3;
+
+    explicit TransformRef(const HomogeneousTransform<NumType>& H)
+      : _H(H)
+    {
+
+    }
+
+    /// @brief (R, T) = this.
+    void evalInto(Matrix3& R, Vector3& T) const
+    {
+      R = Base::rotationData(_H);
+      T = Base::translationData(_H);
+    }
+
+    /// @brief (R, T) = inverse of this.
+    void evalInverseInto(Matrix3& R, Vector3& T) const
+    {
+      R = Base::rotationData(_H).transpose();
+      T = -(R*Base::translationData(_H));
+    }
+
+    /// @brief (R, T) = this*(R, T).
+    void premultiply(Matrix3& R, Vector3& T) const
+    {
+      T = Base::rotationData(_H)*T + Base::translationData(_H);
+      R = Base::rotationData(_H)*R;
+    }
+
+    /// @brief (R, T) = inverse of this*(R, T).
+    void premultiplyInverse(Matrix3& R, Vector3& T) const
+    {
+      T = Base::rotationData(_H).transpose()*(T - Base::translationData(_H));
+      R = Base::rotationData(_H).transpose()*R;
+    }
+
+    /// @brief p = this*p.
+    void apply(Vector3& p) const
+    {
+      p = Base::rotationData(_H)*p + Base::translationData(_H);
+    }
+
+    /// @brief p = inverse of this*p.
+    void applyInverse(Vector3& p) const
+    {
+      p = Base::rotationData(_H).transpose()*(p - Base::translationData(_H));
+    }
+
+  private:
+
+    const HomogeneousTransform<NumType>& _H;
+  };
+
+  /*!
+   * \class RotationRef
+   * \ingroup libScrews
+   * \brief Leaf of a transform expression: a rotation with no translation, by reference.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT RotationRef : public TransformExpression<RotationRef<NumType>, NumType>
+  {
+    typedef TransformExpression<RotationRef<NumType>, NumType> Base;
+
+  public:
+    typedef typename Base::Matrix3 Matrix3;
+    typedef typename Base::Vector3 Vector3;
+
+    explicit RotationRef(const Rotation<NumType>& R)
+      : _R(R)
+    {
+
+    }
+
+    void evalInto(Matrix3& R, Vector3& T) const
+    {
+      R = Base::rotationData(_R);
+      T.setZero();
+    }
+
+    void evalInverseInto(Matrix3& R, Vector3& T) const
+    {
+      R = Base::rotationData(_R).transpose();
+      T.setZero();
+    }
+
+    void premultiply(Matrix3& R, Vector3& T) const
+    {
+      T = Base::rotationData(_R)*T;
+      R = Base::rotationData(_R)*R;
+    }
+
+    void premultiplyInverse(Matrix3& R, Vector3& T) const
+    {
+      T = Base::rotationData(_R).transpose()*T;
+      R = Base::rotationData(_R).transpose()*R;
+    }
+
+    void apply(Vector3& p) const
+    {
+      p = Base::rotationData(_R)*p;
+    }
+
+    void applyInverse(Vector3& p) const
+    {
+      p = Base::rotationData(_R).transpose()*p;
+    }
+
+  private:
+
+    const Rotation<NumType>& _R;
+  };
+
+  /*!
+   * \class TransformProduct
+   * \ingroup libScrews
+   * \brief Lazy product Left*Right of two transform expressions.
+   */
+  template<class Left, class Right>
+  class SCREWS_EXPORT TransformProduct
+    : public TransformExpression<TransformProduct<Left, Right>, typename Left::Scalar>
+  {
+    typedef TransformExpression<TransformProduct<Left, Right>, typename Left::Scalar> Base;
+
+  public:
+    typedef typename Base::Matrix3 Matrix3;
+    typedef typename Base::Vector3 Vector3;
+
+    TransformProduct(const Left& left, const Right& right)
+      : _left(left), _right(right)
+    {
+
+    }
+
+    void evalInto(Matrix3& R, Vector3& T) const
+    {
+      _right.evalInto(R, T);
+      _left.premultiply(R, T);
+    }
+
+    // (Left*Right)^-1 = Right^-1*Left^-1
+    void evalInverseInto(Matrix3& R, Vector3& T) const
+    {
+      _left.evalInverseInto(R, T);
+      _right.premultiplyInverse(R, T);
+    }
+
+    void premultiply(Matrix3& R, Vector3& T) const
+    {
+      _right.premultiply(R, T);
+      _left.premultiply(R, T);
+    }
+
+    void premultiplyInverse(Matrix3& R, Vector3& T) const
+    {
+      _left.premultiplyInverse(R, T);
+      _right.premultiplyInverse(R, T);
+    }
+
+    void apply(Vector3& p) const
+    {
+      _right.apply(p);
+      _left.apply(p);
+    }
+
+    void applyInverse(Vector3& p) const
+    {
+      _left.applyInverse(p);
+      _right.applyInverse(p);
+    }
+
+  private:
+
+    Left _left;
+    Right _right;
+  };
+
+  /*!
+   * \class TransformInverse
+   * \ingroup libScrews
+   * \brief Lazy inverse of a transform expression; swaps the forward and inverse operations.
+   */
+  template<class Expression>
+  class SCREWS_EXPORT TransformInverse
+    : public TransformExpression<TransformInverse<Expression>, typename Expression::Scalar>
+  {
+    typedef TransformExpression<TransformInverse<Expression>, typename Expression::Scalar> Base;
+
+  public:
+    typedef typename Base::Matrix3 Matrix3;
+    typedef typename Base::Vector3 Vector3;
+
+    explicit TransformInverse(const Expression& E)
+      : _E(E)
+    {
+
+    }
+
+    void evalInto(Matrix3& R, Vector3& T) const
+    {
+      _E.evalInverseInto(R, T);
+    }
+
+    void evalInverseInto(Matrix3& R, Vector3& T) const
+    {
+      _E.evalInto(R, T);
+    }
+
+    void premultiply(Matrix3& R, Vector3& T) const
+    {
+      _E.premultiplyInverse(R, T);
+    }
+
+    void premultiplyInverse(Matrix3& R, Vector3& T) const
+    {
+      _E.premultiply(R, T);
+    }
+
+    void apply(Vector3& p) const
+    {
+      _E.applyInverse(p);
+    }
+
+    void applyInverse(Vector3& p) const
+    {
+      _E.apply(p);
+    }
+
+  private:
+
+    Expression _E;
+  };
+
+  /// @brief Start a lazy expression with a homogeneous transform.
+  template<class NumType>
+  TransformRef<NumType> lazy(const HomogeneousTransform<NumType>& H)
+  {
+    return TransformRef<NumType>(H);
+  }
+
+  /// @brief Start a lazy expression with a rotation.
+  template<class NumType>
+  RotationRef<NumType> lazy(const Rotation<NumType>& R)
+  {
+    return RotationRef<NumType>(R);
+  }
+
+  /// @return the lazy product of a homogeneous transform with an expression.
+  template<class Derived, class NumType>
+  TransformProduct< TransformRef<NumType>, Derived > operator *(const HomogeneousTransform<NumType>& H,
+                                                                const TransformExpression<Derived, NumType>& E)
+  {
+    return TransformProduct< TransformRef<NumType>, Derived >(TransformRef<NumType>(H), E.derived());
+  }
+
+  /// @return the lazy product of a rotation with an expression.
+  template<class Derived, class NumType>
+  TransformProduct< RotationRef<NumType>, Derived > operator *(const Rotation<NumType>& R,
+                                                               const TransformExpression<Derived, NumType>& E)
+  {
+    return TransformProduct< RotationRef<NumType>, Derived >(RotationRef<NumType>(R), E.derived());
+  }
+};
+
+#endif // TRANSFORMEXPRESSION_HPP
@@ -22,9 +22,12 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
+#include "numericTraits.hpp"
 
 namespace screws
 {
+
   /*!
    * \class Translation
    * \ingroup libScrews
@@ -49,10 +52,15 @@ namespace screws
     }
 
     /// @brief Default destructor.
-    ~Translation()
-    {
+    ~Translation() = default;
 
-    }
+    /// @brief Copy and move constructors: plain copies of the 3x1 storage, without validation.
+    Translation(const Translation<NumType>&) = default;
+    Translation(Translation<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    Translation<NumType>& operator=(const Translation<NumType>&) = default;
+    Translation<NumType>& operator=(Translation<NumType>&&) = default;
 
     /// @brief Value based constructor.
     /// @param x the x-coordinate of the translation.
@@ -248,15 +256,6 @@ namespace screws
       return _data[index];
     }
 
-    /// @brief Assignment operator.
-    /// @return A copy of the right hand side argument.
-    Translation<NumType>& operator=(Translation<NumType> prototype)
-    {
-      _data = prototype._data;
-      
-      return *this;
-    }
-    
     /// @brief Equality operator.
     /// @return true if all element-by-element comparisons return true. Otherwise, false.
     bool operator ==(const Translation<NumType>& T) const
@@ -289,12 +288,13 @@ namespace screws
     }
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param T compared translation.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const Translation<NumType>& T, double eps = FLT_EPSILON) const
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const Translation<NumType>& T,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
-      if (fabs(T(0) - _data[0]) < eps &&
-          fabs(T(1) - _data[1]) < eps &&
-          fabs(T(2) - _data[2]) < eps)
+      if (std::fabs(T(0) - _data[0]) < eps &&
+          std::fabs(T(1) - _data[1]) < eps &&
+          std::fabs(T(2) - _data[2]) < eps)
       {
         return true;
       }
@@ -304,6 +304,28 @@ namespace screws
       }
     }
 
+    /// @brief The 3x1 storage, for Eigen expressions.
+    const Eigen::Matrix<NumType, 3, 1>& vector() const
+    {
+      return _data;
+    }
+
+    /// @brief Overwrite the elements.
+    /// @param T a 3x1 Eigen vector or expression.
+    template<class Derived>
+    void setVector(const Eigen::MatrixBase<Derived>& T)
+    {
+      _data = T;
+    }
+
+    /// @brief Convert to another number type, e.g. Translationd to Translationf.
+    /// @return the translation with elements rounded to NewNumType.
+    template<class NewNumType>
+    Translation<NewNumType> cast() const
+    {
+      return Translation<NewNumType>((NewNumType)_data[0], (NewNumType)_data[1], (NewNumType)_data[2]);
+    }
+
     /// @brief Calculate the norm2 of the translation.
     /// @return the norm of the translation.
     NumType norm() const
@@ -311,14 +333,22 @@ namespace screws
       return (NumType)(_data.norm());
     }
 
+    /// @brief Calculate the squared norm2 of the translation, without taking the square root.
+    /// @return the squared norm of the translation.
+    NumType squaredNorm() const
+    {
+      return _data[0]*_data[0] + _data[1]*_data[1] + _data[2]*_data[2];
+    }
+
     /// @brief Normalise the translation as if it were a vector.
     /// @return the normalised vector.
     /// @throw scews::ScrewException for zero translation.
     Translation<NumType> normalised() const
     {
+      SCREWS_INSTRUMENT(NORMALISED);
       NumType n = _data.norm();
 
-      if (fabs(n) < 1e-10)
+      if (n < NumericTraits<NumType>::zeroTolerance())
       {
         ScrewException s("Cannot normalise when norm is zero.", __FILE__, __FUNCTION__, __LINE__);
         throw s;
@@ -19,7 +19,10 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
 #include "vector6.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
 #include <Eigen/Eigen>
 #include <cfloat>
 
@@ -55,34 +58,38 @@ namespace screws
 
     /// @brief Create a twist by taking the logarithm of a homogeneous transformation matrix.
     /// @param HT a homogeneous transformation matrix.
-    Twist(const HomogeneousTransform<NumType>& HT)
+    /// @param principal if true, the rotation angle is in [0, pi], see Skew(const Rotation&, bool).
+    Twist(const HomogeneousTransform<NumType>& HT, bool principal = false)
     {
       Eigen::Matrix<NumType, 3, 3> Ainv;
 
       // Create the skew matrix from the rotation part of the homogeneous transform
-      _skew = Skew<NumType>(HT.rotation());
+      _skew = Skew<NumType>(HT.rotation(), principal);
 
       // p. 414 from Sastry
       Translation<NumType> trans = HT.translation();
 
       // Get the norm of the rotation
       NumType skewNorm = _skew.norm();
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
 
       // Pure rotation
-      if ( fabs(trans.norm()) < 1e-10)
+      if (trans.squaredNorm() < zero*zero)
       {
         Ainv = Eigen::Matrix<NumType, 3, 3>::Zero();
       }
       // Pure translation
-      else if (fabs(skewNorm) < 1e-10)
+      else if (skewNorm < zero)
       {
         Ainv = Eigen::Matrix<NumType, 3, 3>::Identity();
       }
       else
       {
-        Ainv = Eigen::Matrix<double, 3, 3>::Identity() +
-          _skew._data/2 +
-          (2*sin(skewNorm) - skewNorm*(1 + cos(skewNorm)))/(2*skewNorm*skewNorm*sin(skewNorm))*_skew._data*_skew._data;
+        NumType sn, cs;
+        MathPolicy<NumType>::sinCos(skewNorm, sn, cs);
+        Ainv = Eigen::Matrix<NumType, 3, 3>::Identity() -
+          (NumType)(0.5)*_skew._data +
+          ((2*sn - skewNorm*(1 + cs))/(2*skewNorm*skewNorm*sn))*_skew._data*_skew._data;
 
       }
       _velocity = Translation<NumType>(
@@ -123,10 +130,15 @@ namespace screws
     }
 
     /// Default destructor.
-    ~Twist()
-    {
+    ~Twist() = default;
 
-    }
+    /// @brief Copy and move constructors: plain copies of the skew and velocity, without validation.
+    Twist(const Twist<NumType>&) = default;
+    Twist(Twist<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    Twist<NumType>& operator=(const Twist<NumType>&) = default;
+    Twist<NumType>& operator=(Twist<NumType>&&) = default;
 
     /// @brief Calculate and return the pitch of the twist.
     /// @return the pitch of the twist.
@@ -135,15 +147,16 @@ namespace screws
       NumType p;
 
       Translation<NumType> omega = _skew.coordinates();
-      NumType normOmega = omega.norm();
+      NumType sqNormOmega = omega.squaredNorm();
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
 
-      if (fabs(normOmega) < 1e-10)
+      if (sqNormOmega < zero*zero)
       {
         p = (NumType)1e+10;
       }
       else
       {
-        p = (omega.dot(_velocity))/(normOmega*normOmega);
+        p = (omega.dot(_velocity))/sqNormOmega;
       }
       return p;
     }
@@ -154,15 +167,16 @@ namespace screws
     {
       TwistCoordinates<NumType> ax;
       Translation<NumType> omega = _skew.coordinates();
-      NumType normOmega = omega.norm();
+      NumType sqNormOmega = omega.squaredNorm();
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
 
-      if (fabs(normOmega) < 1e-10)
+      if (sqNormOmega < zero*zero)
       {
         ax._v1 = _velocity;
       }
       else
       {
-        Eigen::Matrix<NumType, 3, 1, 0, 3, 1> m = _skew._data*_velocity._data/(normOmega*normOmega);
+        Eigen::Matrix<NumType, 3, 1, 0, 3, 1> m = _skew._data*_velocity._data/sqNormOmega;
         ax._v0.setData(m(0), m(1), m(2));
         ax._v1 = omega;
       }
@@ -178,18 +192,33 @@ namespace screws
       return TwistCoordinates<NumType>(_velocity, _skew.coordinates());
     }
 
+    /// @brief Lie bracket with another twist, ad_xi1 xi2 = (w1 x v2 + v1 x w2; w1 x w2).
+    /// @param xi the other twist.
+    /// @return the twist of the commutator of the twist matrices, [xi1^, xi2^] = xi1^ xi2^ - xi2^ xi1^.
+    Twist<NumType> ad(const Twist<NumType>& xi) const
+    {
+      const TwistCoordinates<NumType> a = coordinates(), b = xi.coordinates();
+      // w1 = a(3:5), v2 = b(0:2), v1 = a(0:2), w2 = b(3:5)
+      return Twist<NumType>(a(4)*b(2) - a(5)*b(1) + a(1)*b(5) - a(2)*b(4),
+                            a(5)*b(0) - a(3)*b(2) + a(2)*b(3) - a(0)*b(5),
+                            a(3)*b(1) - a(4)*b(0) + a(0)*b(4) - a(1)*b(3),
+                            a(4)*b(5) - a(5)*b(4),
+                            a(5)*b(3) - a(3)*b(5),
+                            a(3)*b(4) - a(4)*b(3));
+    }
+
     /// @brief Calculate and return the norm of the twist.
     /// @return the norm of the twist.
     NumType norm() const
     {
-      NumType omegaNorm = _skew.norm();
-      if (fabs(omegaNorm) < 1e-10)
+      const NumType zero = NumericTraits<NumType>::zeroTolerance();
+      if (_skew.squaredNorm() < zero*zero)
       {
         return _velocity.norm();
       }
       else
       {
-        return omegaNorm;
+        return _skew.norm();
       }
     }
 
@@ -198,10 +227,11 @@ namespace screws
     /// @return the homogeneous transformation matrix.
     HomogeneousTransform<NumType> exp(const NumType& theta = (NumType)1) const
     {
+      SCREWS_INSTRUMENT(TWIST_EXP);
       // p. 413 Sastry
       NumType omegaNorm = _skew.angle();
 
-      if (fabs(omegaNorm) < 1e-10 || theta == (NumType)0) // pure translation or identity matrix
+      if (omegaNorm < NumericTraits<NumType>::zeroTolerance() || theta == (NumType)0) // pure translation or identity matrix
       {
         return HomogeneousTransform<NumType>(Rotation<NumType>(), _velocity*theta);
       }
@@ -211,10 +241,12 @@ namespace screws
         Eigen::Matrix<NumType, 3, 3> temp2 = temp*_skew._data/omegaNorm;
 
         Rotation<NumType> R = _skew.exp(theta);
+        NumType sn, cs;
+        MathPolicy<NumType>::sinCos(omegaNorm*theta, sn, cs);
         Eigen::Matrix<NumType, 3, 3> A =
             Eigen::Matrix<NumType, 3, 3>::Identity() +
-            temp*(1 - cos(omegaNorm*theta)) +
-            temp2*(omegaNorm*theta - sin(omegaNorm*theta));
+            temp*(1 - cs) +
+            temp2*(omegaNorm*theta - sn);
 
         Eigen::Matrix<NumType, 3, 1, 0, 3, 1> v = A*_velocity._data*theta;
 
@@ -223,21 +255,22 @@ namespace screws
     }
 
     /// @brief Perform verification that matrix is indeed in approriate format by checking the Skew component.
-    bool isValid() const
+    /// @param eps allowed deviation [default: NumericTraits<NumType>::validationTolerance()].
+    bool isValid(const NumType& eps = NumericTraits<NumType>::validationTolerance()) const
     {
-      return _skew.isValid();
+      return _skew.isValid(eps);
     }
 
     /// @brief Returns the skew symmetric (rotation) part of the twist.
     /// @return the skew symmetric part of the twist.
-    Skew<NumType> skew() const
+    const Skew<NumType>& skew() const
     {
       return _skew;
     }
 
     /// @brief Returns the velocity part of the twist.
     /// @return the velocity (3x1 vector) part of the twist.
-    Translation<NumType> velocity() const
+    const Translation<NumType>& velocity() const
     {
       return _velocity;
     }
@@ -286,8 +319,9 @@ namespace screws
 
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param T compared twist matrix.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const Twist<NumType>& T, double eps = FLT_EPSILON) const
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const Twist<NumType>& T,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
       if (T.skew().approxEq(_skew, eps) && T.velocity().approxEq(_velocity, eps))
       {
@@ -0,0 +1,304 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef TWISTEXPCACHE_HPP
+#define TWISTEXPCACHE_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "screwException.hpp"
+#include "numericTraits.hpp"
+#include "fastMath.hpp"
+#include "translation.hpp"
+#include "rotation.hpp"
+#include "homogeneousTransform.hpp"
+#include "skew.hpp"
+#include "vector6.hpp"
+#include "twist.hpp"
+#include <Eigen/Eigen>
+#include <vector>
+
+namespace screws
+{
+  /*!
+   * \class TwistExpCache
+   * \ingroup libScrews
+   * \brief Lookup table for the exponential of a joint twist whose angle comes from a quantised encoder.
+   *
+   * An encoder with the given number of bits reports count in [0, 2^bits), i.e. theta = count*2pi/2^bits.
+   * The table is filled lazily in pages of 1024 counts, the first time a count in the page is requested.
+   * SIN_COS stores the (sin, cos) pair of |w|*theta and evaluates the closed-form exponential from it
+   * (2 values per count). TRANSFORM stores the packed rotation and translation (12 values per count) and
+   * only copies. Pages that would exceed maxBytes are never allocated; those counts are computed directly.
+   * \note exp() fills pages from a const method, so a cache shared between threads must be filled
+   * with build() first.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT TwistExpCache
+  {
+  public:
+    /// @brief What the table stores per count.
+    enum Mode
+    {
+      SIN_COS,   ///< sin/cos pair; the exponential is assembled from the per-twist constants.
+      TRANSFORM  ///< packed 3x3 rotation and 3x1 translation.
+    };
+
+    /// @brief Create an empty cache for the given joint twist.
+    /// @param twist the joint twist.
+    /// @param bits the encoder resolution in bits [default: 17].
+    /// @param mode what the table stores [default: SIN_COS].
+    /// @param maxBytes upper bound on the table memory [default: 4 MiB].
+    /// @throw screws::ScrewException for resolutions outside [1, 24] bits.
+    explicit TwistExpCache(const Twist<NumType>& twist,
+                           const unsigned int& bits = 17,
+                           const Mode& mode = SIN_COS,
+                           const size_t& maxBytes = 4 << 20)
+      : _bits(bits), _mode(mode), _maxBytes(maxBytes), _bytesUsed(0)
+    {
+      if (bits < 1 || bits > 24)
+      {
+        ScrewException e("Only encoder resolutions of 1 to 24 bits are supported.", __FILE__, __FUNCTION__, __LINE__);
+        throw e;
+      }
+
+      _counts = 1u << bits;
+      _step = NumericTraits<NumType>::twoPi()/(NumType)_counts;
+      _pages.resize((_counts + PAGE_SIZE - 1)/PAGE_SIZE);
+
+      // Per-twist constants of the closed form, see Twist::exp():
+      // R = I + K1*sin(w*theta) + K2*(1 - cos(w*theta))
+      // T = v*theta + a*(1 - cos(w*theta)) + b*(w*theta - sin(w*theta))
+      Skew<NumType> S = twist.skew();
+      Translation<NumType> v = twist.velocity();
+      _w = S.angle();
+      _v = v.vector();
+      _pure = (_w < NumericTraits<NumType>::zeroTolerance());
+      if (_pure)
+      {
+        _K1.setZero();
+        _K2.setZero();
+        _a.setZero();
+        _b.setZero();
+      }
+      else
+      {
+        _K1 = S.matrix()/_w;
+        _K2 = _K1*_K1;
+        _a = _K1*_v/_w;
+        _b = _K2*_v/_w;
+      }
+    }
+
+    /// Default destructor.
+    ~TwistExpCache()
+    {
+
+    }
+
+    /// @brief Return the exponential of the twist for an encoder count.
+    /// @param count the encoder count; only the lower bits are used, so counts wrap around.
+    /// @return the homogeneous transform exp(twist*count*2pi/2^bits).
+    HomogeneousTransform<NumType> exp(const unsigned int& count) const
+    {
+      Matrix3 R;
+      Vector3 T;
+      expInto(count, R, T);
+      HomogeneousTransform<NumType> H;
+      H.setUnchecked(R, T);
+
+      return H;
+    }
+
+    /// @brief Return the exponential of the twist for the encoder count closest to the angle.
+    /// @param theta the joint angle; any value, it is wrapped to [0, 2pi).
+    HomogeneousTransform<NumType> expAngle(const NumType& theta) const
+    {
+      return exp(count(theta));
+    }
+
+    /// @brief Return only the rotational part of the exponential for an encoder count.
+    Rotation<NumType> rotation(const unsigned int& count) const
+    {
+      Matrix3 E;
+      Vector3 T;
+      expInto(count, E, T);
+      Rotation<NumType> R;
+      R.setMatrixUnchecked(E);
+
+      return R;
+    }
+
+    /// @brief Quantise an angle to the closest encoder count.
+    unsigned int count(const NumType& theta) const
+    {
+      long long k = (long long)std::floor(theta/_step + (NumType)0.5);
+      return (unsigned int)(k & (long long)(_counts - 1));
+    }
+
+    /// @brief Fill every page that fits in the memory budget.
+    void build()
+    {
+      for (unsigned int p = 0; p < _pages.size(); ++p)
+      {
+        page(p);
+      }
+    }
+
+    /// @return the memory currently held by the table.
+    size_t bytesUsed() const
+    {
+      return _bytesUsed;
+    }
+
+    /// @return the number of encoder counts per revolution.
+    unsigned int counts() const
+    {
+      return _counts;
+    }
+
+  protected:
+
+    enum { PAGE_SIZE = 1024 };
+
+    typedef Eigen::Matrix<NumType, 3, 3> Matrix3;
+    typedef Eigen::Matrix<NumType, 3, 1> Vector3;
+
+    // Values stored per count.
+    unsigned int stride() const
+    {
+      return (_mode == SIN_COS) ? 2 : 12;
+    }
+
+    // Return the page, filling it on first use. Null if it does not fit in the budget.
+    const NumType* page(const unsigned int& p) const
+    {
+      std::vector<NumType>& data = _pages[p];
+      if (data.empty())
+      {
+        size_t bytes = (size_t)PAGE_SIZE*stride()*sizeof(NumType);
+        if (_bytesUsed + bytes > _maxBytes)
+        {
+          return 0;
+        }
+        data.resize((size_t)PAGE_SIZE*stride());
+        _bytesUsed += bytes;
+
+        if (_mode == SIN_COS)
+        {
+          NumType wt[PAGE_SIZE], s[PAGE_SIZE], c[PAGE_SIZE];
+          for (unsigned int i = 0; i < PAGE_SIZE; ++i)
+          {
+            wt[i] = _w*(_step*(NumType)(p*PAGE_SIZE + i));
+          }
+          MathPolicy<NumType>::sinCos(wt, s, c, PAGE_SIZE);
+          for (unsigned int i = 0; i < PAGE_SIZE; ++i)
+          {
+            data[2*i] = s[i];
+            data[2*i + 1] = c[i];
+          }
+        }
+        else
+        {
+          Matrix3 R;
+          Vector3 T;
+          for (unsigned int i = 0; i < PAGE_SIZE; ++i)
+          {
+            NumType* entry = &data[(size_t)i*stride()];
+            compute(p*PAGE_SIZE + i, R, T);
+            Eigen::Map<Matrix3> packedR(entry);
+            Eigen::Map<Vector3> packedT(entry + 9);
+            packedR = R;
+            packedT = T;
+          }
+        }
+      }
+
+      return &data[0];
+    }
+
+    // Closed-form exponential from a sin/cos pair.
+    void assemble(const NumType& theta, const NumType& s, const NumType& c, Matrix3& R, Vector3& T) const
+    {
+      R = Matrix3::Identity() + _K1*s + _K2*(1 - c);
+      T = _v*theta + _a*(1 - c) + _b*(_w*theta - s);
+    }
+
+    // Direct computation, without the table.
+    void compute(const unsigned int& k, Matrix3& R, Vector3& T) const
+    {
+      NumType theta = _step*(NumType)k;
+      NumType s, c;
+      MathPolicy<NumType>::sinCos(_w*theta, s, c);
+      assemble(theta, s, c, R, T);
+    }
+
+    void expInto(const unsigned int& count, Matrix3& R, Vector3& T) const
+    {
+      unsigned int k = count & (_counts - 1);
+      NumType theta = _step*(NumType)k;
+
+      if (_pure)
+      {
+        R.setIdentity();
+        T = _v*theta;
+        return;
+      }
+
+      const NumType* data = page(k/PAGE_SIZE);
+      if (data == 0)
+      {
+        compute(k, R, T);
+        return;
+      }
+
+      const NumType* entry = data + (size_t)(k % PAGE_SIZE)*stride();
+      if (_mode == SIN_COS)
+      {
+        assemble(theta, entry[0], entry[1], R, T);
+      }
+      else
+      {
+        R = Eigen::Map<const Matrix3>(entry);
+        T = Eigen::Map<const Vector3>(entry + 9);
+      }
+    }
+
+    unsigned int _bits;
+    unsigned int _counts;
+    Mode _mode;
+    size_t _maxBytes;
+    NumType _step;
+
+    // Per-twist constants.
+    NumType _w;
+    bool _pure;
+    Matrix3 _K1;
+    Matrix3 _K2;
+    Vector3 _v;
+    Vector3 _a;
+    Vector3 _b;
+
+    // Lazily filled table.
+    mutable std::vector< std::vector<NumType> > _pages;
+    mutable size_t _bytesUsed;
+  };
+
+  // Convenience names
+  using TwistExpCached = TwistExpCache < double >;
+  using TwistExpCachef = TwistExpCache < float >;
+};
+
+#endif // TWISTEXPCACHE_HPP
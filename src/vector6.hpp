@@ -19,6 +19,7 @@
 
 #include "screwsInitLibrary.hpp"
 #include "screwException.hpp"
+#include "instrumentation.hpp"
 #include "translation.hpp"
 
 namespace screws
@@ -43,9 +44,15 @@ namespace screws
     }
 
     /// @brief Default destructor.
-    ~Vector6()
-    {
-    }
+    ~Vector6() = default;
+
+    /// @brief Copy and move constructors: plain copies of the two 3x1 halves, without validation.
+    Vector6(const Vector6<NumType>&) = default;
+    Vector6(Vector6<NumType>&&) = default;
+
+    /// @brief Copy and move assignment.
+    Vector6<NumType>& operator=(const Vector6<NumType>&) = default;
+    Vector6<NumType>& operator=(Vector6<NumType>&&) = default;
 
     /// @brief Vector based constructor.
     /// @param v0 the first 3x1 values.
@@ -242,16 +249,6 @@ namespace screws
       }
     }
 
-    /// @brief Assignment operator.
-    /// @return A copy of the right hand side argument.
-    Vector6<NumType>& operator=(Vector6<NumType> prototype)
-    {
-      _v0 = prototype._v0;
-      _v1 = prototype._v1;
-
-      return *this;
-    }
-
     /// @brief Equality operator.
     /// @return true if all element-by-element comparisons return true. Otherwise, false.
     bool operator ==(const Vector6<NumType>& V) const
@@ -266,8 +263,9 @@ namespace screws
     }
     /// @brief Approximal equality operator, within a given epsilon or system precision.
     /// @param V compared vector.
-    /// @param eps desired precision [default: machine precision].
-    bool approxEq(const Vector6<NumType>& V, double eps = FLT_EPSILON) const
+    /// @param eps desired precision [default: NumericTraits<NumType>::comparisonTolerance()].
+    bool approxEq(const Vector6<NumType>& V,
+                  const NumType& eps = NumericTraits<NumType>::comparisonTolerance()) const
     {
       return (V._v0.approxEq(_v0, eps) && V._v1.approxEq(_v1, eps));
     }
@@ -276,17 +274,24 @@ namespace screws
     /// @return the norm of the vector.
     NumType norm() const
     {
-      return (NumType)sqrt(_v0(0)*_v0(0) + _v0(1)*_v0(1) + _v0(2)*_v0(2) +
-                           _v1(0)*_v1(0) + _v1(1)*_v1(1) + _v1(2)*_v1(2));
+      return (NumType)std::sqrt(squaredNorm());
+    }
+
+    /// @brief Calculate the squared norm2 of the vector, without taking the square root.
+    /// @return the squared norm of the vector.
+    NumType squaredNorm() const
+    {
+      return _v0.squaredNorm() + _v1.squaredNorm();
     }
 
     /// @brief Normalise the vector.
     /// @return the normalised vector.
     Vector6<NumType> normalised() const
     {
+      SCREWS_INSTRUMENT(NORMALISED);
       NumType n = norm();
 
-      if (fabs(n) < 1e-10)
+      if (n < NumericTraits<NumType>::zeroTolerance())
       {
         ScrewException s("Cannot normalise when norm is zero.", __FILE__, __FUNCTION__, __LINE__);
         throw s;
@@ -0,0 +1,115 @@
+//  Copyright (c) 2015  Christos Bergeles and Imperial College London
+
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef WRENCH_HPP
+#define WRENCH_HPP
+
+#include "screwsInitLibrary.hpp"
+#include "translation.hpp"
+#include "homogeneousTransform.hpp"
+#include "vector6.hpp"
+#include "adjoint.hpp"
+
+namespace screws
+{
+  /*!
+   * \class Wrench
+   * \ingroup libScrews
+   * \brief A force and moment pair F = (f; m), the dual of TwistCoordinates.
+   *
+   * The ordering follows TwistCoordinates: the linear part first, so that the power of a wrench
+   * acting on a twist (v; w) of the same frame is f.v + m.w. Wrenches change frame with the
+   * transposed adjoint: with g the pose of frame a in frame b, F_a = Ad_g^T F_b, which keeps the
+   * power on a twist unchanged, F_a.V_a = F_b.V_b.
+   */
+  template<class NumType>
+  class SCREWS_EXPORT Wrench : public Vector6<NumType>
+  {
+  public:
+    /// @brief Zero wrench.
+    Wrench()
+    {
+
+    }
+
+    /// @brief Create a wrench from a force and a moment.
+    /// @param f the force.
+    /// @param m the moment about the frame origin.
+    explicit Wrench(const Translation<NumType>& f, const Translation<NumType>& m)
+      : Vector6<NumType>(f, m)
+    {
+
+    }
+
+    /// @brief Create a wrench from its 6 coordinates, force first.
+    explicit Wrench(const NumType& f0, const NumType& f1, const NumType& f2,
+                    const NumType& m0, const NumType& m1, const NumType& m2)
+      : Vector6<NumType>(f0, f1, f2, m0, m1, m2)
+    {
+
+    }
+
+    /// @brief Reinterpret a 6x1 vector as a wrench.
+    explicit Wrench(const Vector6<NumType>& V)
+      : Vector6<NumType>(V)
+    {
+
+    }
+
+    /// @return the force.
+    const Translation<NumType>& force() const
+    {
+      return this->_v0;
+    }
+
+    /// @return the moment about the frame origin.
+    const Translation<NumType>& moment() const
+    {
+      return this->_v1;
+    }
+
+    /// @return the power f.v + m.w of the wrench on a twist in the same frame.
+    NumType power(const TwistCoordinates<NumType>& V) const
+    {
+      return this->_v0(0)*V(0) + this->_v0(1)*V(1) + this->_v0(2)*V(2) +
+             this->_v1(0)*V(3) + this->_v1(1)*V(4) + this->_v1(2)*V(5);
+    }
+
+    /// @brief The same wrench in another frame, Ad_g^T F.
+    /// @param g the pose of the new frame in the frame of this wrench.
+    Wrench<NumType> changeFrame(const HomogeneousTransform<NumType>& g) const
+    {
+      return Adjoint<NumType>(g).transposeTimes(*this);
+    }
+
+    /// @brief Change the frame of n wrenches through one pose, see changeFrame().
+    /// @param g the pose of the new frame in the frame of the wrenches.
+    /// @param F the wrenches.
+    /// @param n the number of wrenches.
+    /// @param out the results; may be F.
+    static void changeFrame(const HomogeneousTransform<NumType>& g, const Wrench<NumType>* F, const size_t& n,
+                            Wrench<NumType>* out)
+    {
+      Adjoint<NumType>(g).transposeTimes(F, n, out);
+    }
+  };
+
+  // Convenience names
+  using Wrenchd = Wrench < double >;
+  using Wrenchf = Wrench < float >;
+};
+
+#endif // WRENCH_HPP